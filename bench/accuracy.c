@@ -0,0 +1,137 @@
+/** @file accuracy.c
+ *  @brief Benchmarks the accuracy and speed of the element type
+ *  the libraries were compiled with.
+ *
+ *  The network of main.c is trained from a fixed seed, and then
+ *  tested against the test set. The predictions are saved, so that
+ *  a float32 build can be compared against the predictions of a
+ *  float64 build (and vice versa) on the same test set.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "../lib/headers/image_set.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/rng.h"
+#include "../lib/headers/ml.h"
+
+#define DEFAULT_EPOCHS 3
+#define PREDICTIONS_FILE "bench_accuracy_%s.txt"
+
+static const char *otherPrecision()
+{
+    return strcmp(REAL_NAME, "float64") == 0 ? "float32" : "float64";
+}
+
+static void savePredictions(const int predictions[], int size)
+{
+    char fileName[64];
+    FILE *fp;
+    int idx;
+
+    sprintf(fileName, PREDICTIONS_FILE, REAL_NAME);
+    if((fp = fopen(fileName, "w")) == NULL) return;
+
+    for(idx = 0; idx < size; idx++) {
+        fprintf(fp, "%d\n", predictions[idx]);
+    }
+
+    fclose(fp);
+}
+
+// Compares the predictions against the ones saved by a build of the
+// other precision, if there are any for the same test set.
+static void comparePredictions(const int predictions[], Image testImgs[], int size)
+{
+    char fileName[64];
+    FILE *fp;
+    int idx, other, agreed, otherCorrect;
+
+    sprintf(fileName, PREDICTIONS_FILE, otherPrecision());
+    if((fp = fopen(fileName, "r")) == NULL) {
+        printf("\nNo %s predictions to compare against. Build with the other\n", otherPrecision());
+        printf("PRECISION, and run this benchmark again to compare them.\n");
+        return;
+    }
+
+    agreed = 0;
+    otherCorrect = 0;
+    for(idx = 0; idx < size && fscanf(fp, "%d", &other) == 1; idx++) {
+        agreed += other == predictions[idx];
+        otherCorrect += other == testImgs[idx].expVal;
+    }
+    fclose(fp);
+
+    if(idx != size) {
+        printf("\nThe %s predictions are for a different test set.\n", otherPrecision());
+        return;
+    }
+
+    printf("\n%-10s %10.2lf percent\n", otherPrecision(), 100.0 * otherCorrect / size);
+    printf("%-10s %10.2lf percent of the predictions\n", "agreement", 100.0 * agreed / size);
+}
+
+int main(int argc, char **argv)
+{
+    int epochs = argc > 1 ? atoi(argv[1]) : DEFAULT_EPOCHS;
+    int epoch, idx, trainSize, testSize, correct, *predictions;
+    double start, trainTime, testTime;
+    Image *trainImgs, *testImgs;
+    Matrix buffers[2];
+
+    if(epochs <= 0) {
+        fprintf(stderr, "Usage: %s [epochs]\n", argv[0]);
+        return 1;
+    }
+
+    // the same seed gives both precisions the same initial weights
+    setRngSeed(1);
+
+    NeuralNetwork nn = benchCreateNet(benchHiddenSize(0));
+
+    trainSize = getMetadata(TRAINING).noOfImages;
+    testSize = getMetadata(TESTING).noOfImages;
+    trainImgs = benchLoadImageSet(TRAINING, nn.options.nodeOrient, trainSize);
+    testImgs = benchLoadImageSet(TESTING, nn.options.nodeOrient, testSize);
+    predictions = (int *) malloc(testSize * sizeof(int));
+
+    start = benchNow();
+    for(epoch = 1; epoch <= epochs; epoch++) {
+        networkTrain(nn, reLU, 20, trainImgs, trainSize);
+    }
+    trainTime = benchNow() - start;
+
+    buffers[0] = createActivationBuffer(nn);
+    buffers[1] = createActivationBuffer(nn);
+
+    correct = 0;
+    start = benchNow();
+    for(idx = 0; idx < testSize; idx++) {
+        predictions[idx] = evalResult(forwardPropagateInto(testImgs[idx], nn, reLU, buffers));
+        correct += predictions[idx] == testImgs[idx].expVal;
+    }
+    testTime = benchNow() - start;
+
+    printf("Precision: %s, %d epoch(s)\n\n", REAL_NAME, epochs);
+    printf("%-10s %10.2lf percent\n", REAL_NAME, 100.0 * correct / testSize);
+    printf("%-10s %10.3lf s\n", "training", trainTime);
+    printf("%-10s %10.1lf us per image\n", "inference", testTime * 1e6 / testSize);
+
+    savePredictions(predictions, testSize);
+    comparePredictions(predictions, testImgs, testSize);
+
+    freeMatrix(buffers);
+    freeMatrix(buffers+1);
+    freeImageSet(trainImgs, trainSize);
+    freeImageSet(testImgs, testSize);
+    free(trainImgs);
+    free(testImgs);
+    free(predictions);
+    freeNeuralNet(&nn);
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+/** @file activation.c
+ *  @brief Benchmarks the activation kernels of the simd library.
+ *
+ *  Each activation and its derivative is measured on every
+ *  instruction set the CPU supports, and compared against
+ *  calling the activation functions of the ml library on every
+ *  entry, which is what mapping a matrix with them does.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+#include "../lib/headers/simd.h"
+#include "../lib/headers/ml.h"
+
+static const char *activationNames[] = { "identity", "relu", "sigmoid", "tanh" };
+static double (*const activationFuncs[])(double) = { NULL, reLU, sigmoid, tanh };
+static double (*const primeFuncs[])(double) = { NULL, reLUPrime, sigmoidPrime, tanhPrime };
+
+// The layer widths of main.c, followed by wider layers fed with batches.
+static const int sizes[] = { 16, 10 * 64, 16 * 64, 256 * 64, 1024 * 64 };
+
+static void runMapped(double (*func)(double), const Real *in, Real *out, int size)
+{
+    int idx;
+
+    for(idx = 0; idx < size; idx++) {
+        out[idx] = func(in[idx]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int shape, rep, reps, size, isPrime;
+    Real *in, *out;
+    double start, mappedTime, simdTime;
+    double (*func)(double);
+    Activation activation;
+    SimdIsa isa, detected;
+
+    detected = getSimdIsa();
+    printf("Detected instruction set: %s\n\n", getSimdIsaName(detected));
+    printf("%-8s %-14s %-8s %12s %12s %9s\n", "size", "kernel", "isa", "mapped ns", "simd ns", "speedup");
+
+    for(shape = 0; shape < (int) (sizeof(sizes) / sizeof(sizes[0])); shape++) {
+        size = sizes[shape];
+        reps = benchReps(size) / 8 + 1;
+
+        in = (Real *) malloc(size * sizeof(Real));
+        out = (Real *) malloc(size * sizeof(Real));
+        benchFillRandom(in, size);
+        // spread the inputs over the range that the saturating activations bend in
+        vecScale(in, 6, in, size);
+
+        for(activation = RELU; activation <= TANH; activation++) {
+            for(isPrime = 0; isPrime <= 1; isPrime++) {
+                func = isPrime ? primeFuncs[activation] : activationFuncs[activation];
+
+                start = benchNow();
+                for(rep = 0; rep < reps; rep++) {
+                    runMapped(func, in, out, size);
+                }
+                mappedTime = (benchNow() - start) / reps;
+
+                for(isa = SCALAR; isa <= AVX512; isa++) {
+                    if(!isSimdIsaSupported(isa)) continue;
+                    setSimdIsa(isa);
+
+                    start = benchNow();
+                    for(rep = 0; rep < reps; rep++) {
+                        if(isPrime) vecActivatePrime(activation, in, out, size);
+                        else vecActivate(activation, in, out, size);
+                    }
+                    simdTime = (benchNow() - start) / reps;
+
+                    printf("%-8d %-8s%-6s %-8s %12.1lf %12.1lf %8.2lfx\n", size, activationNames[activation],
+                        isPrime ? "prime" : "", getSimdIsaName(isa), mappedTime * 1e9, simdTime * 1e9, mappedTime / simdTime);
+                }
+            }
+        }
+
+        free(in);
+        free(out);
+    }
+
+    setSimdIsa(detected);
+
+    return 0;
+}
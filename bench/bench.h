@@ -0,0 +1,135 @@
+/** @file bench.h
+ *  @brief Helpers shared by the benchmarks.
+ *
+ *  This contains the timing, data generating, and data
+ *  loading helpers that the benchmarks use to measure the
+ *  libraries.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lib/headers/real.h"
+#include "../lib/headers/image_set.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/ml.h"
+
+/** @brief Returns the current wall-clock time in seconds. */
+static inline double benchNow()
+{
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** @brief Returns how many times an operation over a given number of
+ *  entries should be repeated, so that each measurement moves roughly
+ *  the same amount of memory regardless of the size.
+ */
+static inline int benchReps(long entries)
+{
+    long reps = 50000000 / (entries > 0 ? entries : 1);
+
+    return reps < 5 ? 5 : (int) reps;
+}
+
+/** @brief Fills an array with random values within [-1, 1]. */
+static inline void benchFillRandom(Real arr[], long size)
+{
+    long idx;
+
+    for(idx = 0; idx < size; idx++) {
+        arr[idx] = 2.0 * rand() / RAND_MAX - 1;
+    }
+}
+
+/** @brief Reads the first images of a set, and prepares them for the
+ *  nodes of a given orientation, with their pixels normalized.
+ *
+ *  @param type The set to read from (TRAINING, TESTING).
+ *  @param orient The orientation of the nodes (ROW, COL).
+ *  @param size The number of images to read, at most the number of
+ *  images of the set, e.g. getMetadata(type).noOfImages for all of them.
+ *  @return The images, which are freed with freeImageSet and free.
+ */
+static inline Image *benchLoadImageSet(DatasetType type, NodeOrientation orient, int size)
+{
+    ImageSetMetadata metadata = getMetadata(type);
+    Image *imgs = (Image *) malloc(size * sizeof(Image));
+
+    if(imgs == NULL) {
+        fprintf(stderr, "Memory Allocation Failed.");
+        exit(1);
+    }
+
+    readImageSet(imgs, size, metadata);
+    prepDataset(imgs, size, orient, normalize);
+
+    return imgs;
+}
+
+/** @brief Returns the bytes that the weights and biases of a Neural
+ *  Network take up, without the padding of their rows.
+ */
+static inline long benchGetNetBytes(NeuralNetwork nn)
+{
+    int pos;
+    long bytes = 0;
+    Layer layer;
+
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        layer = getLayer(nn, pos);
+        bytes += (long) (layer.weights.row * layer.weights.col + layer.nodes) * sizeof(Real);
+    }
+
+    return bytes;
+}
+
+/** @brief The number of network shapes that the benchmarks can run, the
+ *  network of main.c first, followed by wider ones.
+ */
+#define BENCH_SHAPES 4
+
+/** @brief Returns the size of both hidden layers of a network shape,
+ *  where shape 0 is the network of main.c, and each one after is wider.
+ */
+static inline int benchHiddenSize(int shape)
+{
+    static const int hiddenSizes[BENCH_SHAPES] = { 16, 256, 1024, 4096 };
+
+    return hiddenSizes[shape];
+}
+
+/** @brief Creates a Neural Network shaped like the one of main.c,
+ *  IMG_SIZE x hidden x hidden x 10, with the given options.
+ *
+ *  @param opt The options of the network, whose layers are replaced.
+ *  @param hidden The size of both hidden layers.
+ *  @return The Neural Network, which is freed with freeNeuralNet.
+ */
+static inline NeuralNetwork benchCreateNetWith(NeuralNetOpt opt, int hidden)
+{
+    int layerSizes[] = { IMG_SIZE, hidden, hidden, 10 };
+    NeuralNetwork nn;
+
+    opt.layerSizes = layerSizes;
+    opt.neuralNetSize = sizeof(layerSizes) / sizeof(int);
+    nn = createNeuralNet(opt);
+    // the sizes are only read while the network is created, and are gone after
+    nn.options.layerSizes = NULL;
+
+    return nn;
+}
+
+/** @brief Creates a Neural Network shaped like the one of main.c,
+ *  IMG_SIZE x hidden x hidden x 10, with the default options.
+ */
+static inline NeuralNetwork benchCreateNet(int hidden)
+{
+    return benchCreateNetWith(getDefaultOptions(), hidden);
+}
@@ -0,0 +1,137 @@
+/** @file elementwise.c
+ *  @brief Benchmarks the elementwise kernels of the simd library.
+ *
+ *  Each kernel is measured on every instruction set the CPU
+ *  supports, and compared against the scalar loops over rows
+ *  of separately allocated arrays that the matrix library used
+ *  before its entries were stored in one block.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "../lib/headers/simd.h"
+
+typedef enum Kernel { ADD, SUBTRACT, SCALE, FILL } Kernel;
+
+static const char *kernelNames[] = { "add", "subtract", "scale", "fill" };
+
+// The layer shapes of main.c, followed by wider ones.
+static const int shapes[][2] = {
+    { 1, 10 }, { 1, 16 }, { 16, 10 }, { 16, 16 }, { 784, 16 },
+    { 784, 256 }, { 784, 1024 }, { 4096, 4096 }
+};
+
+static Real **createRows(int row, int col)
+{
+    Real **rows = (Real **) malloc(row * sizeof(Real *));
+    int idx;
+
+    for(idx = 0; idx < row; idx++) {
+        rows[idx] = (Real *) malloc(col * sizeof(Real));
+        benchFillRandom(rows[idx], col);
+    }
+
+    return rows;
+}
+
+static void freeRows(Real **rows, int row)
+{
+    int idx;
+
+    for(idx = 0; idx < row; idx++) {
+        free(rows[idx]);
+    }
+    free(rows);
+}
+
+static void runLegacy(Kernel kernel, Real **a, Real **b, Real **out, int row, int col)
+{
+    int r, c;
+
+    for(r = 0; r < row; r++) {
+        for(c = 0; c < col; c++) {
+            switch(kernel) {
+                case ADD: out[r][c] = a[r][c] + b[r][c]; break;
+                case SUBTRACT: out[r][c] = a[r][c] - b[r][c]; break;
+                case SCALE: out[r][c] = 0.5 * a[r][c]; break;
+                case FILL: out[r][c] = 0.5; break;
+            }
+        }
+    }
+}
+
+static void runSimd(Kernel kernel, Real *a, Real *b, Real *out, int size)
+{
+    switch(kernel) {
+        case ADD: vecAdd(a, b, out, size); break;
+        case SUBTRACT: vecSubtract(a, b, out, size); break;
+        case SCALE: vecScale(a, 0.5, out, size); break;
+        case FILL: vecFill(out, 0.5, size); break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int shape, rep, reps, row, col, size;
+    Real **legacyA, **legacyB, **legacyOut;
+    Real *a, *b, *out;
+    double start, legacyTime, simdTime;
+    Kernel kernel;
+    SimdIsa isa, detected;
+
+    detected = getSimdIsa();
+    printf("Detected instruction set: %s\n\n", getSimdIsaName(detected));
+    printf("%-10s %-10s %-8s %12s %12s %9s\n", "shape", "kernel", "isa", "legacy ns", "simd ns", "speedup");
+
+    for(shape = 0; shape < (int) (sizeof(shapes) / sizeof(shapes[0])); shape++) {
+        row = shapes[shape][0];
+        col = shapes[shape][1];
+        size = row * col;
+        reps = benchReps(size);
+
+        legacyA = createRows(row, col);
+        legacyB = createRows(row, col);
+        legacyOut = createRows(row, col);
+        a = (Real *) malloc(size * sizeof(Real));
+        b = (Real *) malloc(size * sizeof(Real));
+        out = (Real *) malloc(size * sizeof(Real));
+        benchFillRandom(a, size);
+        benchFillRandom(b, size);
+
+        for(kernel = ADD; kernel <= FILL; kernel++) {
+            start = benchNow();
+            for(rep = 0; rep < reps; rep++) {
+                runLegacy(kernel, legacyA, legacyB, legacyOut, row, col);
+            }
+            legacyTime = (benchNow() - start) / reps;
+
+            for(isa = SCALAR; isa <= AVX512; isa++) {
+                if(!isSimdIsaSupported(isa)) continue;
+                setSimdIsa(isa);
+
+                start = benchNow();
+                for(rep = 0; rep < reps; rep++) {
+                    runSimd(kernel, a, b, out, size);
+                }
+                simdTime = (benchNow() - start) / reps;
+
+                printf("%4dx%-5d %-10s %-8s %12.1lf %12.1lf %8.2lfx\n", row, col, kernelNames[kernel],
+                    getSimdIsaName(isa), legacyTime * 1e9, simdTime * 1e9, legacyTime / simdTime);
+            }
+        }
+
+        freeRows(legacyA, row);
+        freeRows(legacyB, row);
+        freeRows(legacyOut, row);
+        free(a);
+        free(b);
+        free(out);
+    }
+
+    setSimdIsa(detected);
+
+    return 0;
+}
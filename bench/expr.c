@@ -0,0 +1,136 @@
+/** @file expr.c
+ *  @brief Benchmarks the lazy expressions of the matrix library.
+ *
+ *  Chains of elementwise operations are measured when they are
+ *  evaluated by a single expression, against running each step
+ *  on its own into a new matrix, as the training code used to.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "../lib/headers/matrix.h"
+
+typedef enum Chain { UPDATE, LOSS, DELTA } Chain;
+
+static const char *chainNames[] = { "w -= lr*g", "o += 2*(y-t)", "d = e*f'(z)" };
+
+// The layer shapes of main.c, followed by wider ones.
+static const int shapes[][2] = {
+    { 1, 10 }, { 16, 10 }, { 784, 16 }, { 784, 256 }, { 784, 1024 }, { 4096, 4096 }
+};
+
+static void fillRandom(Matrix m)
+{
+    int row;
+
+    for(row = 0; row < m.row; row++) {
+        benchFillRandom(MATRIX_ROW(m, row), m.col);
+    }
+}
+
+// Runs each step of a chain into a new matrix, and copies the last one back.
+static void runSteps(Chain chain, Matrix a, Matrix b, Matrix c)
+{
+    Matrix step, res;
+
+    switch(chain) {
+        case UPDATE:
+            step = scale(b, 0.01);
+            res = subtract(a, step);
+            break;
+        case LOSS:
+            step = subtract(b, c);
+            scaleInPlace(step, 2.0);
+            res = add(a, step);
+            break;
+        case DELTA:
+            step = createMatrix(c.row, c.col);
+            activatePrimeInto(c, SIGMOID, step);
+            res = createMatrix(c.row, c.col);
+            vecMultiply(b.entries, step.entries, res.entries, c.row * c.stride);
+            break;
+    }
+
+    copyMatrix(res, a);
+    freeMatrix(&step);
+    freeMatrix(&res);
+}
+
+static void runExpr(Chain chain, Matrix a, Matrix b, Matrix c)
+{
+    MatrixExpr expr = { 0 };
+
+    switch(chain) {
+        case UPDATE:
+            exprLoad(&expr, a);
+            exprLoad(&expr, b);
+            exprScale(&expr, 0.01);
+            exprSubtract(&expr);
+            break;
+        case LOSS:
+            exprLoad(&expr, a);
+            exprLoad(&expr, b);
+            exprLoad(&expr, c);
+            exprSubtract(&expr);
+            exprScale(&expr, 2.0);
+            exprAdd(&expr);
+            break;
+        case DELTA:
+            exprLoad(&expr, b);
+            exprLoad(&expr, c);
+            exprActivatePrime(&expr, SIGMOID);
+            exprMultiply(&expr);
+            break;
+    }
+
+    evalExprInto(&expr, a);
+}
+
+int main(int argc, char **argv)
+{
+    int shape, rep, reps, row, col;
+    double start, stepsTime, exprTime;
+    Matrix a, b, c;
+    Chain chain;
+
+    printf("%-10s %-14s %12s %12s %9s\n", "shape", "chain", "steps ns", "expr ns", "speedup");
+
+    for(shape = 0; shape < (int) (sizeof(shapes) / sizeof(shapes[0])); shape++) {
+        row = shapes[shape][0];
+        col = shapes[shape][1];
+        reps = benchReps((long) row * col);
+
+        a = createMatrix(row, col);
+        b = createMatrix(row, col);
+        c = createMatrix(row, col);
+        fillRandom(a);
+        fillRandom(b);
+        fillRandom(c);
+
+        for(chain = UPDATE; chain <= DELTA; chain++) {
+            start = benchNow();
+            for(rep = 0; rep < reps; rep++) {
+                runSteps(chain, a, b, c);
+            }
+            stepsTime = (benchNow() - start) / reps;
+
+            start = benchNow();
+            for(rep = 0; rep < reps; rep++) {
+                runExpr(chain, a, b, c);
+            }
+            exprTime = (benchNow() - start) / reps;
+
+            printf("%4dx%-5d %-14s %12.1lf %12.1lf %8.2lfx\n", row, col, chainNames[chain],
+                stepsTime * 1e9, exprTime * 1e9, stepsTime / exprTime);
+        }
+
+        freeMatrix(&a);
+        freeMatrix(&b);
+        freeMatrix(&c);
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+/** @file model_file.c
+ *  @brief Benchmarks loading networks from model files, by mapping
+ *  them with and without verifying their parameters, against copying
+ *  every parameter into memory.
+ *
+ *  Randomly initialized networks with the input size of MNIST are saved
+ *  into a model file in the working directory, which is removed after.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "../lib/headers/matrix.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/model_file.h"
+
+#define BENCH_FILE "bench_model_file.model"
+
+int main(int argc, char **argv)
+{
+    int shape, rep, reps;
+    double start, saveTime, mapTime, verifyTime, copyTime;
+    MappedNeuralNet model;
+    NeuralNetwork copy;
+
+    printf("Precision: %s\n\n", REAL_NAME);
+    printf("%-16s %9s %10s %10s %12s %10s\n", "network", "size MB", "save ms", "map us", "verified us", "copy us");
+
+    for(shape = 0; shape < BENCH_SHAPES; shape++) {
+        NeuralNetwork nn = benchCreateNet(benchHiddenSize(shape));
+
+        reps = benchReps(nn.params.col) + 1;
+
+        start = benchNow();
+        saveNeuralNet(nn, BENCH_FILE);
+        saveTime = benchNow() - start;
+
+        // the parameters are touched once, so that every load runs off of the page cache
+        model = mapNeuralNet(BENCH_FILE, 1);
+        unmapNeuralNet(&model);
+
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            model = mapNeuralNet(BENCH_FILE, 0);
+            unmapNeuralNet(&model);
+        }
+        mapTime = (benchNow() - start) / reps;
+
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            model = mapNeuralNet(BENCH_FILE, 1);
+            unmapNeuralNet(&model);
+        }
+        verifyTime = (benchNow() - start) / reps;
+
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            copy = copyNeuralNet(nn);
+            freeNeuralNet(&copy);
+        }
+        copyTime = (benchNow() - start) / reps;
+
+        printf("784x%-4dx%-4dx10 %9.2lf %10.2lf %10.2lf %12.2lf %10.2lf\n", benchHiddenSize(shape), benchHiddenSize(shape),
+            nn.params.col * sizeof(Real) / 1e6, saveTime * 1e3, mapTime * 1e6, verifyTime * 1e6, copyTime * 1e6);
+
+        freeNeuralNet(&nn);
+    }
+
+    remove(BENCH_FILE);
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+/** @file optim.c
+ *  @brief Benchmarks the fused steps of the optimizer library against
+ *  running each update as separate passes over the parameters.
+ *
+ *  The parameters of networks as wide as main.c and wider ones are
+ *  stepped by each optimizer on every instruction set the CPU supports,
+ *  against the same update run as a pass per operation, and the network
+ *  of main.c is trained with each optimizer, reporting the accuracy it
+ *  reaches on the testing set after each epoch.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+#include "../lib/headers/simd.h"
+#include "../lib/headers/image_set.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/rng.h"
+#include "../lib/headers/optim.h"
+#include "../lib/headers/ml.h"
+
+#define DEFAULT_SAMPLES 6000
+#define TEST_SAMPLES 2000
+#define EPOCHS 5
+#define BATCH_SIZE 20
+#define LR 0.01
+#define ADAM_LR 0.001
+#define BETA1 0.9
+#define BETA2 0.999
+#define EPSILON 1e-8
+// The shapes of bench.h that are run, the network of main.c followed by wider ones.
+#define SHAPES 3
+
+static const char *names[] = { "sgd", "momentum", "nesterov", "adam" };
+
+// The update of each optimizer, as it would be written with a pass per operation.
+static void unfusedStep(OptimizerType type, long steps, Real *params, const Real *grad, Real *velocity, Real *variance, Real *tmp, int size)
+{
+    double correction1, correction2;
+    int idx;
+
+    switch(type) {
+        case SGD:
+            vecAxpy(-LR, grad, params, size);
+            break;
+        case MOMENTUM:
+            vecScale(velocity, BETA1, velocity, size);
+            vecAdd(velocity, grad, velocity, size);
+            vecAxpy(-LR, velocity, params, size);
+            break;
+        case NESTEROV:
+            vecScale(velocity, BETA1, velocity, size);
+            vecAdd(velocity, grad, velocity, size);
+            vecScale(velocity, BETA1, tmp, size);
+            vecAdd(tmp, grad, tmp, size);
+            vecAxpy(-LR, tmp, params, size);
+            break;
+        case ADAM:
+            correction1 = 1 - pow(BETA1, steps);
+            correction2 = 1 - pow(BETA2, steps);
+            vecScale(velocity, BETA1, velocity, size);
+            vecAxpy(1 - BETA1, grad, velocity, size);
+            vecMultiply(grad, grad, tmp, size);
+            vecScale(variance, BETA2, variance, size);
+            vecAxpy(1 - BETA2, tmp, variance, size);
+            for(idx = 0; idx < size; idx++) {
+                tmp[idx] = velocity[idx] / correction1 / (sqrt(variance[idx] / correction2) + EPSILON);
+            }
+            vecAxpy(-ADAM_LR, tmp, params, size);
+            break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int samples = argc > 1 ? atoi(argv[1]) : DEFAULT_SAMPLES;
+    int shape, type, isa, rep, reps, epoch;
+    double start, unfusedTime, fusedTime;
+    Real *velocity, *variance, *tmp;
+    Matrix grad;
+    Image *imgs, *testImgs;
+    NeuralNetOpt opt;
+    SimdIsa detected = getSimdIsa();
+
+    if(samples <= 0 || samples > getMetadata(TRAINING).noOfImages) {
+        fprintf(stderr, "Usage: %s [samples]\n", argv[0]);
+        return 1;
+    }
+
+    setRngSeed(1);
+    // the options are taken after the seed is set, as they carry it
+    opt = getDefaultOptions();
+    opt.lr = LR;
+    printf("Precision: %s, detected instruction set: %s\n\n", REAL_NAME, getSimdIsaName(detected));
+    printf("%-16s %-10s %-8s %-8s %12s %12s %9s\n", "network", "entries", "step", "isa", "unfused us", "fused us", "speedup");
+
+    for(shape = 0; shape < SHAPES; shape++) {
+        NeuralNetwork nn = benchCreateNetWith(opt, benchHiddenSize(shape));
+
+        grad = createMatrix(1, nn.params.col);
+        benchFillRandom(grad.entries, grad.col);
+        // the gradients are scaled down, so that the parameters stay finite over every repetition
+        vecScale(grad.entries, 1e-3, grad.entries, grad.col);
+        velocity = (Real *) calloc(grad.col, sizeof(Real));
+        variance = (Real *) calloc(grad.col, sizeof(Real));
+        tmp = (Real *) malloc(grad.col * sizeof(Real));
+        reps = benchReps(grad.col);
+
+        for(type = SGD; type <= ADAM; type++) {
+            start = benchNow();
+            for(rep = 0; rep < reps; rep++) unfusedStep((OptimizerType) type, rep + 1, nn.params.entries, grad.entries, velocity, variance, tmp, grad.col);
+            unfusedTime = (benchNow() - start) / reps;
+
+            for(isa = SCALAR; isa <= AVX512; isa++) {
+                if(!isSimdIsaSupported((SimdIsa) isa)) continue;
+                setSimdIsa((SimdIsa) isa);
+
+                Optimizer optimizer = createOptimizer((OptimizerType) type, nn);
+                if(type == ADAM) optimizer.lr = ADAM_LR;
+
+                start = benchNow();
+                for(rep = 0; rep < reps; rep++) optimizerStep(&optimizer, nn.params, grad);
+                fusedTime = (benchNow() - start) / reps;
+
+                printf("784x%-4dx%-4dx10 %-10d %-8s %-8s %12.2lf %12.2lf %8.2lfx\n", benchHiddenSize(shape), benchHiddenSize(shape), grad.col,
+                    names[type], getSimdIsaName((SimdIsa) isa), unfusedTime * 1e6, fusedTime * 1e6, unfusedTime / fusedTime);
+
+                freeOptimizer(&optimizer);
+            }
+            setSimdIsa(detected);
+        }
+
+        free(velocity);
+        free(variance);
+        free(tmp);
+        freeMatrix(&grad);
+        freeNeuralNet(&nn);
+    }
+
+    printf("\nTest accuracy %% of the network of main.c after each epoch, %d samples per epoch\n", samples);
+    printf("%-10s", "optimizer");
+    for(epoch = 1; epoch <= EPOCHS; epoch++) printf(" %8d", epoch);
+    printf("\n");
+
+    // the network of main.c is trained with tanh, which unlike reLU never
+    // leaves dead nodes behind when the steps of an optimizer overshoot
+    imgs = benchLoadImageSet(TRAINING, ROW, samples);
+    testImgs = benchLoadImageSet(TESTING, ROW, TEST_SAMPLES);
+    for(type = SGD; type <= ADAM; type++) {
+        NeuralNetwork nn = benchCreateNetWith(opt, benchHiddenSize(0));
+        Optimizer optimizer = createOptimizer((OptimizerType) type, nn);
+        if(type == ADAM) optimizer.lr = ADAM_LR;
+
+        printf("%-10s", names[type]);
+        for(epoch = 1; epoch <= EPOCHS; epoch++) {
+            networkTrainWithOptimizer(nn, tanh, BATCH_SIZE, imgs, samples, &optimizer);
+            printf(" %8.2lf", networkTest(nn, tanh, testImgs, TEST_SAMPLES) * 100);
+            fflush(stdout);
+        }
+        printf("\n");
+
+        freeOptimizer(&optimizer);
+        freeNeuralNet(&nn);
+    }
+
+    freeImageSet(imgs, samples);
+    freeImageSet(testImgs, TEST_SAMPLES);
+    free(imgs);
+    free(testImgs);
+
+    return 0;
+}
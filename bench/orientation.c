@@ -0,0 +1,129 @@
+/** @file orientation.c
+ *  @brief Benchmarks the two node orientations of the Neural Network
+ *  against each other, along with the transposes of the matrix library.
+ *
+ *  Randomly initialized networks with the input size of MNIST are fed
+ *  random images, which are prepared for either orientation, thus both
+ *  the preparation and the forward propagation are measured.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+#include "../lib/headers/matrix.h"
+#include "../lib/headers/stats.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/ml.h"
+
+#define IMAGES 64
+
+// The shapes of the transposed matrices, square and otherwise.
+static const int transposeShapes[][2] = { { 784, 16 }, { 1024, 1024 }, { 784, 4096 } };
+
+// Measures how long it takes to prepare an image for, and forward propagate it 
+// through, a network with the given orientation. Returns the time in seconds.
+static double benchOrientation(NodeOrientation orient, int hidden, Data images[], double *prepTime)
+{
+    int idx, rep, reps;
+    double start, forwardTime;
+    Matrix buffers[2];
+
+    reps = benchReps((long) IMG_SIZE * hidden + (long) hidden * hidden) / IMAGES + 1;
+
+    NeuralNetOpt opt = getDefaultOptions();
+    opt.nodeOrient = orient;
+    NeuralNetwork nn = benchCreateNetWith(opt, hidden);
+    Data prepared[IMAGES];
+
+    start = benchNow();
+    for(idx = 0; idx < IMAGES; idx++) {
+        prepared[idx] = (Data) { .expVal = images[idx].expVal, .inputValues = createMatrix(IMG_HEIGHT, IMG_WIDTH) };
+        copyMatrix(images[idx].inputValues, prepared[idx].inputValues);
+        prepData(prepared + idx, orient, normalize);
+    }
+    *prepTime = (benchNow() - start) / IMAGES;
+
+    buffers[0] = createActivationBuffer(nn);
+    buffers[1] = createActivationBuffer(nn);
+
+    start = benchNow();
+    for(rep = 0; rep < reps; rep++) {
+        for(idx = 0; idx < IMAGES; idx++) {
+            forwardPropagateInto(prepared[idx], nn, tanh, buffers);
+        }
+    }
+    forwardTime = (benchNow() - start) / reps / IMAGES;
+
+    for(idx = 0; idx < IMAGES; idx++) {
+        freeMatrix(&prepared[idx].inputValues);
+        freeSparseMatrix(&prepared[idx].sparseInputs);
+    }
+    freeMatrix(buffers);
+    freeMatrix(buffers+1);
+    freeNeuralNet(&nn);
+
+    return forwardTime;
+}
+
+int main(int argc, char **argv)
+{
+    int shape, idx, rep, reps, row, col;
+    double start, rowTime, colTime, rowPrep, colPrep, naiveTime, blockedTime;
+    Data images[IMAGES];
+    Matrix src, dest;
+
+    printf("Precision: %s\n\n", REAL_NAME);
+    printf("%-16s %12s %12s %12s %12s %9s\n", "network", "row prep us", "col prep us", "row us", "col us", "col/row");
+
+    for(idx = 0; idx < IMAGES; idx++) {
+        images[idx] = (Data) { .expVal = 0, .inputValues = createMatrix(IMG_HEIGHT, IMG_WIDTH) };
+        benchFillRandom(images[idx].inputValues.entries, (long) IMG_HEIGHT * images[idx].inputValues.stride);
+    }
+
+    for(shape = 0; shape < BENCH_SHAPES; shape++) {
+        rowTime = benchOrientation(ROW, benchHiddenSize(shape), images, &rowPrep);
+        colTime = benchOrientation(COL, benchHiddenSize(shape), images, &colPrep);
+
+        printf("784x%-4dx%-4dx10 %12.2lf %12.2lf %12.2lf %12.2lf %8.2lfx\n", benchHiddenSize(shape), benchHiddenSize(shape),
+            rowPrep * 1e6, colPrep * 1e6, rowTime * 1e6, colTime * 1e6, colTime / rowTime);
+    }
+
+    printf("\n%-16s %12s %12s %9s\n", "transpose", "naive us", "blocked us", "speedup");
+
+    for(shape = 0; shape < (int) (sizeof(transposeShapes) / sizeof(transposeShapes[0])); shape++) {
+        src = createMatrix(transposeShapes[shape][0], transposeShapes[shape][1]);
+        dest = createMatrix(src.col, src.row);
+        benchFillRandom(src.entries, (long) src.row * src.stride);
+        reps = benchReps((long) src.row * src.col);
+
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            for(row = 0; row < src.row; row++) {
+                for(col = 0; col < src.col; col++) {
+                    MATRIX_AT(dest, col, row) = MATRIX_AT(src, row, col);
+                }
+            }
+        }
+        naiveTime = (benchNow() - start) / reps;
+
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            transposeInto(src, dest);
+        }
+        blockedTime = (benchNow() - start) / reps;
+
+        printf("%4dx%-11d %12.2lf %12.2lf %8.2lfx\n", src.row, src.col, naiveTime * 1e6, blockedTime * 1e6, naiveTime / blockedTime);
+
+        freeMatrix(&src);
+        freeMatrix(&dest);
+    }
+
+    for(idx = 0; idx < IMAGES; idx++) {
+        freeMatrix(&images[idx].inputValues);
+    }
+
+    return 0;
+}
@@ -0,0 +1,264 @@
+/** @file predict.c
+ *  @brief Benchmarks the batched predictions of the inference library
+ *  against preparing and forward propagating one image at a time, along
+ *  with serving a single model from 1 to N threads, the latency of a 
+ *  single prepared image run through a plan against forwardPropagate, 
+ *  and deployed models fed raw pixels against formatting them first.
+ *
+ *  Randomly initialized networks with the input size of MNIST are fed
+ *  random images, where most of the pixels are blank like in MNIST. N is
+ *  the number of online cores, unless it is given as an argument.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "bench.h"
+#include "../lib/headers/matrix.h"
+#include "../lib/headers/stats.h"
+#include "../lib/headers/thread_pool.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/ml.h"
+#include "../lib/headers/inference.h"
+
+#define IMAGES 256
+// The number of single images whose latencies are measured.
+#define REQUESTS 2000
+
+// The shapes of bench.h that are run, the network of main.c followed by wider ones.
+#define SHAPES 3
+
+/** @brief The work of a thread that serves the shared model. */
+typedef struct ServeTask {
+    const InferenceModel *model;
+    const uint8_t *pixels;
+    int reps;
+    int labels[IMAGES];
+} ServeTask;
+
+static void *serve(void *arg)
+{
+    ServeTask *task = (ServeTask *) arg;
+    InferenceContext ctx = createInferenceContext(task->model);
+    int rep;
+
+    for(rep = 0; rep < task->reps; rep++) {
+        predict(&ctx, task->pixels, IMAGES, task->labels);
+    }
+    freeInferenceContext(&ctx);
+
+    return NULL;
+}
+
+// Prepares, and forward propagates, each image on its own, the way a caller
+// of the ml library would. Returns the time per image in seconds.
+static double benchSingle(NeuralNetwork nn, const uint8_t *pixels, int reps, int labels[])
+{
+    int rep, idx, pixel;
+    double start;
+    Matrix buffers[2];
+    Data data;
+
+    buffers[0] = createActivationBuffer(nn);
+    buffers[1] = createActivationBuffer(nn);
+
+    start = benchNow();
+    for(rep = 0; rep < reps; rep++) {
+        for(idx = 0; idx < IMAGES; idx++) {
+            data = (Data) { .expVal = 0, .inputValues = createMatrix(IMG_HEIGHT, IMG_WIDTH) };
+            for(pixel = 0; pixel < IMG_SIZE; pixel++) {
+                MATRIX_AT(data.inputValues, pixel / IMG_WIDTH, pixel % IMG_WIDTH) = pixels[idx * IMG_SIZE + pixel];
+            }
+            prepData(&data, nn.options.nodeOrient, normalize);
+            labels[idx] = evalResult(forwardPropagateInto(data, nn, reLU, buffers));
+
+            freeMatrix(&data.inputValues);
+            freeSparseMatrix(&data.sparseInputs);
+        }
+    }
+
+    freeMatrix(buffers);
+    freeMatrix(buffers+1);
+
+    return (benchNow() - start) / reps / IMAGES;
+}
+
+static int compareTimes(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+// Measures the latency of each of the requests, where a prepared image is
+// either forward propagated into a new matrix, or run through a plan. The
+// median, and 99th percentile, latencies are stored in seconds.
+static void benchLatency(NeuralNetwork nn, const uint8_t *pixels, int usePlan, double *median, double *tail)
+{
+    static double times[REQUESTS];
+    InferencePlan plan;
+    Matrix res;
+    Data data;
+    double start;
+    int req, pixel;
+
+    data = (Data) { .expVal = 0, .inputValues = createMatrix(IMG_HEIGHT, IMG_WIDTH) };
+    for(pixel = 0; pixel < IMG_SIZE; pixel++) {
+        MATRIX_AT(data.inputValues, pixel / IMG_WIDTH, pixel % IMG_WIDTH) = pixels[pixel];
+    }
+    prepData(&data, nn.options.nodeOrient, normalize);
+    plan = compileInferencePlan(nn, reLU, 1);
+
+    for(req = 0; req < REQUESTS; req++) {
+        start = benchNow();
+        if(usePlan) {
+            runInferencePlan(&plan, data.inputValues, isSparseMatrix(data.sparseInputs) ? &data.sparseInputs : NULL);
+        } else {
+            res = forwardPropagate(data, nn, reLU);
+            freeMatrix(&res);
+        }
+        times[req] = benchNow() - start;
+    }
+
+    qsort(times, REQUESTS, sizeof(double), compareTimes);
+    *median = times[REQUESTS / 2];
+    *tail = times[REQUESTS * 99 / 100];
+
+    freeInferencePlan(&plan);
+    freeMatrix(&data.inputValues);
+    freeSparseMatrix(&data.sparseInputs);
+}
+
+// Predicts every image with a model on a single thread. Returns the time 
+// per image in seconds.
+static double benchModel(const InferenceModel *model, const uint8_t *pixels, int reps, int labels[])
+{
+    ServeTask task = { .model = model, .pixels = pixels, .reps = reps };
+    double start;
+    int idx;
+
+    start = benchNow();
+    serve(&task);
+    for(idx = 0; idx < IMAGES; idx++) {
+        labels[idx] = task.labels[idx];
+    }
+
+    return (benchNow() - start) / reps / IMAGES;
+}
+
+int main(int argc, char **argv)
+{
+    int shape, idx, threads, maxThreads, reps, mismatches;
+    int singleLabels[IMAGES], deployLabels[IMAGES];
+    double start, singleTime, batchTime, serveTime, propMedian, propTail, planMedian, planTail, deployTime;
+    uint8_t pixels[IMAGES * IMG_SIZE];
+    NeuralNetwork nets[SHAPES];
+    ServeTask tasks[64];
+    pthread_t workers[64];
+
+    maxThreads = argc > 1 ? atoi(argv[1]) : getThreadCount();
+    if(maxThreads <= 0) maxThreads = 1;
+    if(maxThreads > 64) maxThreads = 64;
+
+    // each thread of the benchmark serves on its own, rather than splitting
+    // the multiplications of one prediction across the pool
+    setThreadCount(1);
+
+    for(idx = 0; idx < IMAGES * IMG_SIZE; idx++) {
+        pixels[idx] = rand() % 4 == 0 ? rand() % 256 : 0;
+    }
+
+    for(shape = 0; shape < SHAPES; shape++) {
+        nets[shape] = benchCreateNet(benchHiddenSize(shape));
+    }
+
+    printf("Precision: %s, threads: 1 to %d\n\n", REAL_NAME, maxThreads);
+    printf("%-16s %12s %12s %9s %8s\n", "network", "single us", "batched us", "speedup", "labels");
+
+    for(shape = 0; shape < SHAPES; shape++) {
+        NeuralNetwork nn = nets[shape];
+        InferenceModel model = createInferenceModel(nn, reLU, normalize);
+
+        reps = benchReps((long) IMAGES * IMG_SIZE * benchHiddenSize(shape) / 64) + 1;
+        singleTime = benchSingle(nn, pixels, reps, singleLabels);
+
+        tasks[0] = (ServeTask) { .model = &model, .pixels = pixels, .reps = reps };
+        start = benchNow();
+        serve(tasks);
+        batchTime = (benchNow() - start) / reps / IMAGES;
+
+        mismatches = 0;
+        for(idx = 0; idx < IMAGES; idx++) {
+            if(tasks[0].labels[idx] != singleLabels[idx]) mismatches++;
+        }
+
+        printf("784x%-4dx%-4dx10 %12.3lf %12.3lf %8.2lfx %8s\n", benchHiddenSize(shape), benchHiddenSize(shape),
+            singleTime * 1e6, batchTime * 1e6, singleTime / batchTime, mismatches == 0 ? "same" : "differ");
+
+        for(threads = 1; threads <= maxThreads; threads++) {
+            for(idx = 0; idx < threads; idx++) {
+                tasks[idx] = (ServeTask) { .model = &model, .pixels = pixels, .reps = reps };
+            }
+
+            start = benchNow();
+            for(idx = 0; idx < threads; idx++) {
+                pthread_create(workers + idx, NULL, serve, tasks + idx);
+            }
+            for(idx = 0; idx < threads; idx++) {
+                pthread_join(workers[idx], NULL);
+            }
+            serveTime = benchNow() - start;
+
+            printf("%16s %3d threads %10.0lf images/s\n", "", threads, (double) threads * reps * IMAGES / serveTime);
+        }
+
+        freeInferenceModel(&model);
+    }
+
+    printf("\n%-16s %12s %12s %12s %12s\n", "latency", "prop p50 us", "prop p99 us", "plan p50 us", "plan p99 us");
+
+    for(shape = 0; shape < SHAPES; shape++) {
+        NeuralNetwork nn = nets[shape];
+
+        benchLatency(nn, pixels, 0, &propMedian, &propTail);
+        benchLatency(nn, pixels, 1, &planMedian, &planTail);
+
+        printf("784x%-4dx%-4dx10 %12.3lf %12.3lf %12.3lf %12.3lf\n", benchHiddenSize(shape), benchHiddenSize(shape),
+            propMedian * 1e6, propTail * 1e6, planMedian * 1e6, planTail * 1e6);
+
+    }
+
+    printf("\n%-16s %12s %12s %9s %8s\n", "raw pixels", "formatted us", "deployed us", "speedup", "labels");
+
+    for(shape = 0; shape < SHAPES; shape++) {
+        NeuralNetwork nn = nets[shape];
+        // normalize can't be folded into the weights, thus both are served as if trained on scalePixels
+        InferenceModel model = createInferenceModel(nn, reLU, scalePixels);
+        InferenceModel deployed = createDeployModel(nn, reLU, 1.0 / PIXEL_MAX, 0);
+
+        reps = benchReps((long) IMAGES * IMG_SIZE * benchHiddenSize(shape) / 64) + 1;
+        batchTime = benchModel(&model, pixels, reps, singleLabels);
+        deployTime = benchModel(&deployed, pixels, reps, deployLabels);
+
+        mismatches = 0;
+        for(idx = 0; idx < IMAGES; idx++) {
+            if(deployLabels[idx] != singleLabels[idx]) mismatches++;
+        }
+
+        printf("784x%-4dx%-4dx10 %12.3lf %12.3lf %8.2lfx %8s\n", benchHiddenSize(shape), benchHiddenSize(shape),
+            batchTime * 1e6, deployTime * 1e6, batchTime / deployTime, mismatches == 0 ? "same" : "differ");
+
+        freeInferenceModel(&deployed);
+        freeInferenceModel(&model);
+    }
+
+    for(shape = 0; shape < SHAPES; shape++) {
+        freeNeuralNet(nets + shape);
+    }
+    freeThreadPool();
+
+    return 0;
+}
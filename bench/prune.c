@@ -0,0 +1,102 @@
+/** @file prune.c
+ *  @brief Benchmarks the accuracy, speed, and size of networks whose
+ *  first layer is pruned, and run on sparse weights, against the
+ *  dense networks they were pruned from.
+ *
+ *  The network of main.c, and a wider one, are trained on the training
+ *  set, and their first layer is pruned to each sparsity. Each pruned
+ *  network is tested before and after it is fine-tuned, and the tuned
+ *  one is tested again on the sparse kernels of the prune library.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "../lib/headers/image_set.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/rng.h"
+#include "../lib/headers/ml.h"
+#include "../lib/headers/prune.h"
+
+#define DEFAULT_EPOCHS 1
+#define FINE_TUNE_ROUNDS 1
+#define BATCH_SIZE 20
+// The shapes of bench.h that are run, the network of main.c followed by a wider one.
+#define SHAPES 2
+
+// The fractions of the weights of the first layer that are pruned.
+static const double sparsities[] = { 0.5, 0.8, 0.9 };
+
+int main(int argc, char **argv)
+{
+    int epochs = argc > 1 ? atoi(argv[1]) : DEFAULT_EPOCHS;
+    int shape, level, epoch, trainSize, testSize;
+    double start, denseAcc, denseTime, prunedAcc, tunedAcc, sparseAcc, sparseTime;
+    double layerSparsities[] = { 0, 0, 0 };
+    Image *trainImgs, *testImgs;
+
+    if(epochs <= 0) {
+        fprintf(stderr, "Usage: %s [epochs]\n", argv[0]);
+        return 1;
+    }
+
+    setRngSeed(1);
+    NeuralNetOpt opt = getDefaultOptions();
+    trainSize = getMetadata(TRAINING).noOfImages;
+    testSize = getMetadata(TESTING).noOfImages;
+    trainImgs = benchLoadImageSet(TRAINING, opt.nodeOrient, trainSize);
+    testImgs = benchLoadImageSet(TESTING, opt.nodeOrient, testSize);
+
+    printf("Precision: %s, %d epoch(s), %d fine-tuning round(s)\n\n", REAL_NAME, epochs, FINE_TUNE_ROUNDS);
+    printf("%-16s %8s %9s %9s %9s %9s %10s %10s %8s %10s %10s\n", "network", "sparsity", "dense %", "pruned %", "tuned %",
+        "sparse %", "dense us", "sparse us", "speedup", "dense KiB", "sparse KiB");
+
+    for(shape = 0; shape < SHAPES; shape++) {
+        NeuralNetwork nn = benchCreateNetWith(opt, benchHiddenSize(shape));
+
+        for(epoch = 1; epoch <= epochs; epoch++) {
+            networkTrain(nn, reLU, BATCH_SIZE, trainImgs, trainSize);
+        }
+
+        start = benchNow();
+        denseAcc = networkTest(nn, reLU, testImgs, testSize);
+        denseTime = (benchNow() - start) / testSize;
+
+        for(level = 0; level < (int) (sizeof(sparsities) / sizeof(sparsities[0])); level++) {
+            NeuralNetwork pruned = copyNeuralNet(nn);
+
+            // the output layer is left dense, since each of its few weights decides a label
+            layerSparsities[0] = sparsities[level];
+            layerSparsities[1] = sparsities[level];
+            pruneNeuralNet(pruned, 0, layerSparsities);
+            prunedAcc = networkTest(pruned, reLU, testImgs, testSize);
+
+            fineTunePrunedNet(pruned, reLU, BATCH_SIZE, trainImgs, trainSize, FINE_TUNE_ROUNDS);
+            tunedAcc = networkTest(pruned, reLU, testImgs, testSize);
+
+            PrunedNetwork pnn = createPrunedNet(pruned, reLU);
+            start = benchNow();
+            sparseAcc = prunedNetworkTest(pnn, testImgs, testSize);
+            sparseTime = (benchNow() - start) / testSize;
+
+            printf("784x%-4dx%-4dx10 %7.0lf%% %9.2lf %9.2lf %9.2lf %9.2lf %10.2lf %10.2lf %7.2lfx %10.1lf %10.1lf\n",
+                benchHiddenSize(shape), benchHiddenSize(shape), sparsities[level] * 100, denseAcc * 100, prunedAcc * 100,
+                tunedAcc * 100, sparseAcc * 100, denseTime * 1e6, sparseTime * 1e6, denseTime / sparseTime,
+                benchGetNetBytes(nn) / 1024.0, getPrunedNetBytes(pnn) / 1024.0);
+
+            freePrunedNet(&pnn);
+            freeNeuralNet(&pruned);
+        }
+
+        freeNeuralNet(&nn);
+    }
+
+    freeImageSet(trainImgs, trainSize);
+    freeImageSet(testImgs, testSize);
+    free(trainImgs);
+    free(testImgs);
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+/** @file quant.c
+ *  @brief Benchmarks int8 inference of the quant library against
+ *  the full precision forward propagation.
+ *
+ *  Randomly initialized networks with the input size of MNIST are
+ *  quantized, and fed random images one at a time. The int8 path is
+ *  measured on every instruction set the CPU supports.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+#include "../lib/headers/simd.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/ml.h"
+#include "../lib/headers/quant.h"
+
+#define IMAGES 64
+
+int main(int argc, char **argv)
+{
+    int shape, idx, rep, reps, hidden;
+    double start, floatTime, quantTime;
+    Data images[IMAGES];
+    Matrix buffers[2];
+    SimdIsa isa, detected;
+
+    detected = getSimdIsa();
+    printf("Precision: %s, detected instruction set: %s\n\n", REAL_NAME, getSimdIsaName(detected));
+    printf("%-16s %-8s %12s %12s %9s %12s %12s\n", "network", "isa", "float us", "int8 us", "speedup", "float KiB", "int8 KiB");
+
+    for(idx = 0; idx < IMAGES; idx++) {
+        images[idx] = (Data) { .expVal = 0, .inputValues = createMatrix(1, IMG_SIZE) };
+        benchFillRandom(images[idx].inputValues.entries, IMG_SIZE);
+        mapMatrix(images[idx].inputValues, fabs);
+    }
+
+    for(shape = 0; shape < BENCH_SHAPES; shape++) {
+        hidden = benchHiddenSize(shape);
+        reps = benchReps((long) IMG_SIZE * hidden + (long) hidden * hidden) / IMAGES + 1;
+
+        NeuralNetwork nn = benchCreateNet(hidden);
+        QuantizedNetwork qnn = quantizeNeuralNet(nn, tanh, PER_CHANNEL, images, IMAGES);
+        QuantBuffers quantBuffers = createQuantBuffers(qnn);
+
+        buffers[0] = createActivationBuffer(nn);
+        buffers[1] = createActivationBuffer(nn);
+
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            for(idx = 0; idx < IMAGES; idx++) {
+                forwardPropagateInto(images[idx], nn, tanh, buffers);
+            }
+        }
+        floatTime = (benchNow() - start) / reps / IMAGES;
+
+        for(isa = SCALAR; isa <= AVX512; isa++) {
+            if(!isSimdIsaSupported(isa)) continue;
+            setSimdIsa(isa);
+
+            start = benchNow();
+            for(rep = 0; rep < reps; rep++) {
+                for(idx = 0; idx < IMAGES; idx++) {
+                    quantizedForwardPropagateInto(images[idx], qnn, quantBuffers);
+                }
+            }
+            quantTime = (benchNow() - start) / reps / IMAGES;
+
+            printf("784x%-4dx%-4dx10 %-8s %12.2lf %12.2lf %8.2lfx %12.1lf %12.1lf\n", hidden, hidden, getSimdIsaName(isa),
+                floatTime * 1e6, quantTime * 1e6, floatTime / quantTime, benchGetNetBytes(nn) / 1024.0, getQuantizedNetBytes(qnn) / 1024.0);
+        }
+        setSimdIsa(detected);
+
+        freeMatrix(buffers);
+        freeMatrix(buffers+1);
+        freeQuantBuffers(&quantBuffers);
+        freeQuantizedNet(&qnn);
+        freeNeuralNet(&nn);
+    }
+
+    for(idx = 0; idx < IMAGES; idx++) {
+        freeMatrix(&images[idx].inputValues);
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+/** @file rng.c
+ *  @brief Benchmarks the bulk generation of the rng library against
+ *  drawing from rand() one number at a time.
+ *
+ *  Arrays as big as the layers of main.c and wider ones are filled with
+ *  uniform and normal numbers on every instruction set the CPU supports,
+ *  each checked to draw the same numbers as the scalar kernel, and the
+ *  weights of whole networks are initialized from their seed.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "../lib/headers/simd.h"
+#include "../lib/headers/rng.h"
+#include "../lib/headers/neural_net.h"
+
+#define SEED 1
+// The shapes of bench.h that are run, the network of main.c followed by wider ones.
+#define SHAPES 3
+
+static void fillRand(Real arr[], long size)
+{
+    long idx;
+
+    for(idx = 0; idx < size; idx++) {
+        arr[idx] = -1 + 2.0 * rand() / RAND_MAX;
+    }
+}
+
+int main()
+{
+    int shape, rep, reps, isa, same, row;
+    long size;
+    double start, randTime, uniformTime, normalTime, initTime;
+    Real *arr, *expected;
+    Rng rng;
+    SimdIsa detected = getSimdIsa();
+
+    printf("Precision: %s, detected instruction set: %s\n\n", REAL_NAME, getSimdIsaName(detected));
+    printf("%-10s %-8s %12s %12s %12s %9s %6s\n", "entries", "isa", "rand() us", "uniform us", "normal us", "speedup", "same");
+
+    for(shape = 0; shape < SHAPES; shape++) {
+        // the size of the first layer of the shape
+        size = (long) IMG_SIZE * benchHiddenSize(shape);
+        reps = benchReps(size) / 10 + 1;
+        arr = (Real *) malloc(size * sizeof(Real));
+        expected = (Real *) malloc(size * sizeof(Real));
+
+        srand(SEED);
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) fillRand(arr, size);
+        randTime = (benchNow() - start) / reps;
+
+        for(isa = SCALAR; isa <= AVX512; isa++) {
+            if(!isSimdIsaSupported((SimdIsa) isa)) continue;
+            setSimdIsa((SimdIsa) isa);
+
+            start = benchNow();
+            for(rep = 0; rep < reps; rep++) {
+                rng = createRng(SEED, RNG_WEIGHTS_STREAM(rep));
+                rngUniformArr(&rng, arr, size, -1, 1);
+            }
+            uniformTime = (benchNow() - start) / reps;
+
+            start = benchNow();
+            for(rep = 0; rep < reps; rep++) {
+                rng = createRng(SEED, RNG_WEIGHTS_STREAM(rep));
+                rngNormalArr(&rng, arr, size, 0, 1);
+            }
+            normalTime = (benchNow() - start) / reps;
+
+            // every kernel should draw the numbers the scalar one draws
+            rng = createRng(SEED, RNG_WEIGHTS_STREAM(0));
+            rngUniformArr(&rng, arr, size, -1, 1);
+            if(isa == SCALAR) memcpy(expected, arr, size * sizeof(Real));
+            same = memcmp(expected, arr, size * sizeof(Real)) == 0;
+
+            printf("%-10ld %-8s %12.2lf %12.2lf %12.2lf %8.2lfx %6s\n", size, getSimdIsaName((SimdIsa) isa), randTime * 1e6,
+                uniformTime * 1e6, normalTime * 1e6, randTime / uniformTime, same ? "yes" : "no");
+        }
+        setSimdIsa(detected);
+
+        free(arr);
+        free(expected);
+    }
+
+    printf("\n%-16s %14s %12s\n", "network", "init us", "same seed");
+    for(shape = 0; shape < SHAPES; shape++) {
+        NeuralNetOpt opt = getDefaultOptions();
+        opt.seed = SEED;
+
+        reps = 10;
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            NeuralNetwork nn = benchCreateNetWith(opt, benchHiddenSize(shape));
+            freeNeuralNet(&nn);
+        }
+        initTime = (benchNow() - start) / reps;
+
+        // networks of the same seed should start with the same weights
+        NeuralNetwork first = benchCreateNetWith(opt, benchHiddenSize(shape));
+        NeuralNetwork second = benchCreateNetWith(opt, benchHiddenSize(shape));
+        Layer a = getLayer(first, 2), b = getLayer(second, 2);
+        for(same = 1, row = 0; row < a.weights.row; row++) {
+            same &= memcmp(MATRIX_ROW(a.weights, row), MATRIX_ROW(b.weights, row), a.weights.col * sizeof(Real)) == 0;
+        }
+
+        printf("784x%-4dx%-4dx10 %14.2lf %12s\n", benchHiddenSize(shape), benchHiddenSize(shape), initTime * 1e6, same ? "yes" : "no");
+
+        freeNeuralNet(&first);
+        freeNeuralNet(&second);
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/** @file sparse.c
+ *  @brief Benchmarks the sparse first layer of the ml library
+ *  against the dense one.
+ *
+ *  Random images are made as sparse as MNIST, where about one in
+ *  five pixels is not zero, and are fed through the first layer
+ *  of either orientation, with and without their sparse inputs.
+ *  The gradient of the weights of the layer is measured as well.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+#include "../lib/headers/matrix.h"
+#include "../lib/headers/sparse.h"
+#include "../lib/headers/stats.h"
+#include "../lib/headers/ml.h"
+
+#define IMAGES 64
+// One in this many pixels is not zero.
+#define NONZERO_EVERY 5
+
+static void fillImage(Matrix m)
+{
+    int col;
+
+    for(col = 0; col < m.col; col++) {
+        MATRIX_AT(m, 0, col) = rand() % NONZERO_EVERY == 0 ? 1 + rand() % 255 : 0;
+    }
+}
+
+// Measures how long it takes to feed the images through a layer, with their
+// sparse inputs or without them. Returns the time per image in seconds.
+static double benchForward(Data images[], Layer layer, NodeOrientation orient, int isSparse, int reps)
+{
+    int idx, rep;
+    double start;
+    Matrix out = orient == COL ? createMatrix(layer.nodes, 1) : createMatrix(1, layer.nodes);
+
+    start = benchNow();
+    for(rep = 0; rep < reps; rep++) {
+        for(idx = 0; idx < IMAGES; idx++) {
+            if(isSparse) {
+                sparseForwardInto(images[idx].sparseInputs, layer, tanh, orient, out);
+            } else {
+                denseForwardInto(images[idx].inputValues, layer, tanh, orient, out);
+            }
+        }
+    }
+
+    freeMatrix(&out);
+
+    return (benchNow() - start) / reps / IMAGES;
+}
+
+int main(int argc, char **argv)
+{
+    int shape, idx, rep, reps, hidden, nnz;
+    double start, denseTime, sparseTime;
+    Data images[IMAGES];
+    NodeOrientation orient;
+    Layer layer;
+    Matrix delta, grad, outer;
+
+    for(idx = 0, nnz = 0; idx < IMAGES; idx++) {
+        images[idx] = (Data) { .expVal = 0, .inputValues = createMatrix(1, IMG_SIZE) };
+        fillImage(images[idx].inputValues);
+        prepData(images + idx, ROW, normalize);
+        nnz += images[idx].sparseInputs.nnz;
+    }
+
+    printf("Precision: %s, nonzero inputs: %.1lf%%\n\n", REAL_NAME, 100.0 * nnz / ((double) IMAGES * IMG_SIZE));
+    printf("%-10s %-6s %12s %12s %9s %10s\n", "layer", "orient", "dense us", "sparse us", "speedup", "flops cut");
+
+    for(shape = 0; shape < BENCH_SHAPES; shape++) {
+        hidden = benchHiddenSize(shape);
+        reps = benchReps((long) IMG_SIZE * hidden) / IMAGES + 1;
+
+        for(orient = ROW; orient <= COL; orient++) {
+            // the sparse inputs are a row either way, thus only the dense ones are flipped
+            for(idx = 0; idx < IMAGES; idx++) {
+                if(orient == COL) transpose(&images[idx].inputValues);
+            }
+
+            layer.nodes = hidden;
+            layer.weights = orient == COL ? createMatrix(hidden, IMG_SIZE) : createMatrix(IMG_SIZE, hidden);
+            layer.bias = orient == COL ? createMatrix(hidden, 1) : createMatrix(1, hidden);
+            benchFillRandom(layer.weights.entries, (long) layer.weights.row * layer.weights.stride);
+            fillMatrix(layer.bias, 0);
+
+            denseTime = benchForward(images, layer, orient, 0, reps);
+            sparseTime = benchForward(images, layer, orient, 1, reps);
+
+            printf("784x%-6d %-6s %12.2lf %12.2lf %8.2lfx %9.2lfx\n", hidden, orient == COL ? "col" : "row",
+                denseTime * 1e6, sparseTime * 1e6, denseTime / sparseTime, (double) IMG_SIZE * IMAGES / nnz);
+
+            for(idx = 0; idx < IMAGES; idx++) {
+                if(orient == COL) transpose(&images[idx].inputValues);
+            }
+            freeMatrix(&layer.weights);
+            freeMatrix(&layer.bias);
+        }
+    }
+
+    printf("\n%-10s %12s %12s %9s\n", "gradient", "dense us", "sparse us", "speedup");
+
+    for(shape = 0; shape < BENCH_SHAPES; shape++) {
+        hidden = benchHiddenSize(shape);
+        reps = benchReps((long) IMG_SIZE * hidden) / IMAGES + 1;
+        delta = createMatrix(1, hidden);
+        grad = createMatrix(IMG_SIZE, hidden);
+        outer = createMatrix(IMG_SIZE, hidden);
+        benchFillRandom(delta.entries, hidden);
+        fillMatrix(grad, 0);
+
+        // the gradient of the weights of row nodes is transpose(input) . delta
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            for(idx = 0; idx < IMAGES; idx++) {
+                dotInto(images[idx].inputValues, delta, TRANS, NO_TRANS, outer);
+                axpy(1, outer, grad);
+            }
+        }
+        denseTime = (benchNow() - start) / reps / IMAGES;
+
+        start = benchNow();
+        for(rep = 0; rep < reps; rep++) {
+            for(idx = 0; idx < IMAGES; idx++) {
+                sparseTransDotAxpy(1, images[idx].sparseInputs, delta, grad);
+            }
+        }
+        sparseTime = (benchNow() - start) / reps / IMAGES;
+
+        printf("784x%-6d %12.2lf %12.2lf %8.2lfx\n", hidden, denseTime * 1e6, sparseTime * 1e6, denseTime / sparseTime);
+
+        freeMatrix(&delta);
+        freeMatrix(&grad);
+        freeMatrix(&outer);
+    }
+
+    for(idx = 0; idx < IMAGES; idx++) {
+        freeMatrix(&images[idx].inputValues);
+        freeSparseMatrix(&images[idx].sparseInputs);
+    }
+
+    return 0;
+}
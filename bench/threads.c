@@ -0,0 +1,71 @@
+/** @file threads.c
+ *  @brief Benchmarks how the matrix multiplication of the gemm
+ *  library scales across the threads of the thread pool.
+ *
+ *  The weights of a layer with the input size of MNIST are multiplied
+ *  with a single image, and with a batch of images, on 1 to N threads.
+ *  N is the number of online cores, unless it is given as an argument.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "../lib/headers/thread_pool.h"
+#include "../lib/headers/gemm.h"
+
+// The number of images multiplied with the weights at once.
+static const int batchSizes[] = { 1, 64 };
+
+int main(int argc, char **argv)
+{
+    int shape, batch, threads, maxThreads, rep, reps, hidden, rows;
+    double start, elapsed, serialTime;
+    Real *inputs, *weights, *out;
+
+    maxThreads = argc > 1 ? atoi(argv[1]) : getThreadCount();
+    if(maxThreads <= 0) maxThreads = 1;
+
+    printf("Precision: %s, threads: 1 to %d\n\n", REAL_NAME, maxThreads);
+    printf("%-16s %8s %12s %10s %9s %11s\n", "product", "threads", "us", "GFLOP/s", "speedup", "efficiency");
+
+    for(shape = 0; shape < BENCH_SHAPES; shape++) {
+        for(batch = 0; batch < (int) (sizeof(batchSizes) / sizeof(batchSizes[0])); batch++) {
+            hidden = benchHiddenSize(shape);
+            rows = batchSizes[batch];
+            reps = benchReps((long) rows * IMG_SIZE * hidden / 8);
+
+            inputs = (Real *) malloc((size_t) rows * IMG_SIZE * sizeof(Real));
+            weights = (Real *) malloc((size_t) IMG_SIZE * hidden * sizeof(Real));
+            out = (Real *) malloc((size_t) rows * hidden * sizeof(Real));
+            benchFillRandom(inputs, (long) rows * IMG_SIZE);
+            benchFillRandom(weights, (long) IMG_SIZE * hidden);
+            serialTime = 0;
+
+            for(threads = 1; threads <= maxThreads; threads++) {
+                setThreadCount(threads);
+                // warms up the pool, and the packing buffers of each thread
+                gemm(NO_TRANS, NO_TRANS, rows, hidden, IMG_SIZE, inputs, IMG_SIZE, weights, hidden, out, hidden);
+
+                start = benchNow();
+                for(rep = 0; rep < reps; rep++) {
+                    gemm(NO_TRANS, NO_TRANS, rows, hidden, IMG_SIZE, inputs, IMG_SIZE, weights, hidden, out, hidden);
+                }
+                elapsed = (benchNow() - start) / reps;
+                if(threads == 1) serialTime = elapsed;
+
+                printf("%4dx%-4dx%-6d %8d %12.2lf %10.2lf %8.2lfx %10.0lf%%\n", rows, IMG_SIZE, hidden, threads, elapsed * 1e6,
+                    2.0 * rows * IMG_SIZE * hidden / elapsed * 1e-9, serialTime / elapsed, serialTime / elapsed / threads * 100);
+            }
+
+            free(inputs);
+            free(weights);
+            free(out);
+        }
+    }
+
+    freeThreadPool();
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+/** @file train.c
+ *  @brief Benchmarks the throughput of training with mini-batches of
+ *  different sizes.
+ *
+ *  Networks as wide as main.c and wider ones are trained on the training
+ *  set with each batch size on a single thread, for both orientations,
+ *  where each batch is fed forward and backward as a whole. A batch of 1
+ *  is the cost of training on one sample at a time. The batches are then
+ *  split across 1 to N threads, where N is the number of online cores,
+ *  unless it is given as the second argument, and the synchronous
+ *  training is compared against the asynchronous (Hogwild) one, by the
+ *  throughput and the accuracy they reach after an epoch.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+#include "../lib/headers/thread_pool.h"
+#include "../lib/headers/image_set.h"
+#include "../lib/headers/neural_net.h"
+#include "../lib/headers/rng.h"
+#include "../lib/headers/ml.h"
+
+#define DEFAULT_SAMPLES 6000
+// The shapes of bench.h that are run, the network of main.c followed by a wider one.
+#define SHAPES 2
+
+static const int batchSizes[] = { 1, 8, 32, 128, 512 };
+// The batch that is split across the threads.
+#define THREADED_BATCH_SIZE 128
+// The batch that each thread trains on at once, for either mode, thus
+// each synchronous batch is split into a shard of it per thread.
+#define HOGWILD_BATCH_SIZE 8
+#define TEST_SAMPLES 2000
+
+int main(int argc, char **argv)
+{
+    int samples = argc > 1 ? atoi(argv[1]) : DEFAULT_SAMPLES;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : getThreadCount();
+    int shape, orient, batch, threads, mode;
+    double start, elapsed, baseline;
+    long stale;
+    Image *imgs, *testImgs;
+
+    if(samples <= 0 || samples > getMetadata(TRAINING).noOfImages || maxThreads <= 0) {
+        fprintf(stderr, "Usage: %s [samples] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    setRngSeed(1);
+    setThreadCount(1);
+    printf("Precision: %s, %d samples per epoch\n\n", REAL_NAME, samples);
+    printf("%-16s %-6s %6s %14s %12s %9s\n", "network", "orient", "batch", "samples/s", "epoch ms", "speedup");
+
+    for(orient = ROW; orient <= COL; orient++) {
+        imgs = benchLoadImageSet(TRAINING, orient, samples);
+
+        for(shape = 0; shape < SHAPES; shape++) {
+            NeuralNetOpt opt = getDefaultOptions();
+            opt.nodeOrient = orient;
+
+            for(batch = 0; batch < (int) (sizeof(batchSizes) / sizeof(batchSizes[0])); batch++) {
+                NeuralNetwork nn = benchCreateNetWith(opt, benchHiddenSize(shape));
+
+                start = benchNow();
+                networkTrain(nn, reLU, batchSizes[batch], imgs, samples);
+                elapsed = benchNow() - start;
+                if(batch == 0) baseline = elapsed;
+
+                printf("784x%-4dx%-4dx10 %-6s %6d %14.0lf %12.2lf %8.2lfx\n", benchHiddenSize(shape), benchHiddenSize(shape),
+                    orient == COL ? "col" : "row", batchSizes[batch], samples / elapsed, elapsed * 1e3, baseline / elapsed);
+
+                freeNeuralNet(&nn);
+            }
+        }
+
+        freeImageSet(imgs, samples);
+        free(imgs);
+    }
+
+    printf("\n%-16s %8s %6s %14s %9s %11s\n", "network", "threads", "batch", "samples/s", "speedup", "efficiency");
+    imgs = benchLoadImageSet(TRAINING, ROW, samples);
+    testImgs = benchLoadImageSet(TESTING, ROW, TEST_SAMPLES);
+    for(shape = 0; shape < SHAPES; shape++) {
+        for(threads = 1; threads <= maxThreads; threads++) {
+            setThreadCount(threads);
+            NeuralNetwork nn = benchCreateNet(benchHiddenSize(shape));
+
+            start = benchNow();
+            networkTrain(nn, reLU, THREADED_BATCH_SIZE, imgs, samples);
+            elapsed = benchNow() - start;
+            if(threads == 1) baseline = elapsed;
+
+            printf("784x%-4dx%-4dx10 %8d %6d %14.0lf %8.2lfx %10.0lf%%\n", benchHiddenSize(shape), benchHiddenSize(shape), threads,
+                THREADED_BATCH_SIZE, samples / elapsed, baseline / elapsed, baseline / elapsed / threads * 100);
+
+            freeNeuralNet(&nn);
+        }
+    }
+
+    // the network of main.c is trained with tanh, which unlike reLU never
+    // leaves dead nodes behind, thus the accuracy of the modes is comparable
+    printf("\n%-8s %8s %6s %10s %14s %12s %10s\n", "mode", "threads", "batch", "staleness", "samples/s", "accuracy %", "stale");
+    for(threads = 1; threads <= maxThreads; threads++) {
+        setThreadCount(threads);
+
+        for(mode = 0; mode < 3; mode++) {
+            NeuralNetwork nn = benchCreateNet(benchHiddenSize(0));
+
+            // synchronous, and then asynchronous without and with a bound
+            stale = 0;
+            start = benchNow();
+            if(mode == 0) {
+                networkTrain(nn, tanh, HOGWILD_BATCH_SIZE * threads, imgs, samples);
+            } else {
+                stale = networkTrainHogwild(nn, tanh, HOGWILD_BATCH_SIZE, imgs, samples, mode == 1 ? 0 : threads);
+            }
+            elapsed = benchNow() - start;
+
+            printf("%-8s %8d %6d %10d %14.0lf %12.2lf %10ld\n", mode == 0 ? "sync" : "hogwild", threads,
+                mode == 0 ? HOGWILD_BATCH_SIZE * threads : HOGWILD_BATCH_SIZE, mode == 2 ? threads : 0, samples / elapsed,
+                networkTest(nn, tanh, testImgs, TEST_SAMPLES) * 100, stale);
+
+            freeNeuralNet(&nn);
+        }
+    }
+
+    freeImageSet(imgs, samples);
+    freeImageSet(testImgs, TEST_SAMPLES);
+    free(imgs);
+    free(testImgs);
+    freeThreadPool();
+
+    return 0;
+}
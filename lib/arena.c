@@ -0,0 +1,124 @@
+/** @file arena.c
+ *  @brief A library made for allocating short-lived memory.
+ *
+ *  This library contains an arena allocator, which carves
+ *  allocations out of big chunks by bumping an offset, and
+ *  frees all of them in constant time by resetting it. The
+ *  chunks are kept after a reset, thus an arena that is reset
+ *  after every step of a loop stops touching the heap once it
+ *  has grown to the size of a step.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "headers/arena.h"
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwMallocFailed() { fprintf(stderr, "Memory Allocation Failed."); exit(1); }
+
+Arena createArena(size_t chunkSize)
+{
+    Arena arena = { NULL, NULL, 0, chunkSize };
+    return arena;
+}
+
+// Returns the offset in a chunk that an allocation would start at,
+// or -1 if the chunk has no room for it.
+static long fitInChunk(ArenaChunk *chunk, size_t used, size_t size, size_t alignment)
+{
+    uintptr_t start = (uintptr_t) chunk->data + used;
+    size_t offset = ((start + alignment - 1) & ~((uintptr_t) alignment - 1)) - (uintptr_t) chunk->data;
+
+    return offset + size <= chunk->size ? (long) offset : -1;
+}
+
+static ArenaChunk *createChunk(size_t size)
+{
+    ArenaChunk *chunk = (ArenaChunk *) malloc(sizeof(ArenaChunk) + size);
+    if(chunk == NULL) throwMallocFailed();
+
+    chunk->next = NULL;
+    chunk->size = size;
+
+    return chunk;
+}
+
+void *arenaAlloc(Arena *arena, size_t size, size_t alignment)
+{
+    if(arena == NULL) throwInvalidArgs("arena", "It should not be null.");
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0) throwInvalidArgs("alignment", "It should be a power of two.");
+
+    long offset;
+    size_t chunkSize;
+    ArenaChunk *chunk;
+
+    // try the current chunk, and then the ones kept from before a reset
+    while(arena->current != NULL) {
+        offset = fitInChunk(arena->current, arena->used, size, alignment);
+        if(offset >= 0) {
+            arena->used = offset + size;
+            return arena->current->data + offset;
+        }
+
+        if(arena->current->next == NULL) break;
+        arena->current = arena->current->next;
+        arena->used = 0;
+    }
+
+    chunkSize = arena->chunkSize > 0 ? arena->chunkSize : ARENA_CHUNK_SIZE;
+    if(chunkSize < size + alignment - 1) {
+        chunkSize = size + alignment - 1;
+    }
+
+    chunk = createChunk(chunkSize);
+    if(arena->current == NULL) {
+        arena->first = chunk;
+    } else {
+        arena->current->next = chunk;
+    }
+    arena->current = chunk;
+
+    offset = fitInChunk(chunk, 0, size, alignment);
+    arena->used = offset + size;
+
+    return chunk->data + offset;
+}
+
+void resetArena(Arena *arena)
+{
+    if(arena == NULL) throwInvalidArgs("arena", "It should not be null.");
+
+    arena->current = arena->first;
+    arena->used = 0;
+}
+
+size_t getArenaCapacity(Arena arena)
+{
+    size_t capacity = 0;
+    ArenaChunk *chunk;
+
+    for(chunk = arena.first; chunk != NULL; chunk = chunk->next) {
+        capacity += chunk->size;
+    }
+
+    return capacity;
+}
+
+void freeArena(Arena *arena)
+{
+    if(arena == NULL) throwInvalidArgs("arena", "It should not be null.");
+
+    ArenaChunk *chunk, *next;
+
+    for(chunk = arena->first; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->used = 0;
+}
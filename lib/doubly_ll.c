@@ -91,11 +91,11 @@ void deleteFromList(DoublyLinkedList *ll, int index, CleanupFunc cleanup)
 
 void clearList(DoublyLinkedList *ll, CleanupFunc cleanup)
 {
-    List *trav, temp;   
+    List trav, temp;   
     
-    for(trav = &ll->list; *trav != NULL;) {
-        temp = *trav;
-        trav = &(*trav)->next;
+    for(trav = ll->list; trav != NULL;) {
+        temp = trav;
+        trav = trav->next;
 
         if(cleanup != NULL) {
             cleanup(temp->item);
@@ -121,43 +121,44 @@ void *getItemByIndex(DoublyLinkedList ll, int index)
     return trav->item;
 }
 
-void *getItem(DoublyLinkedList *ll, NavDirection dir)
+ListCursor createListCursor(DoublyLinkedList ll)
+{
+    ListCursor cursor = { ll.list, 0, 1 };
+
+    return cursor;
+}
+
+void *getItem(ListCursor *cursor, NavDirection dir)
 {
+    if(cursor == NULL) throwInvalidArgs("cursor", "It should not be null.");
+
     void *item = NULL;
-    static List list = NULL;
-    static int beyondLast = 0;
-    static int isFirst = 1;
-
-    if(ll != NULL) {
-        list = ll->list;
-        beyondLast = 0;
-        isFirst = 1;
-    }
+    List list = cursor->node;
 
     if(list != NULL) {
         switch(dir) {
             case NEXT:
                 if(list->next == NULL) {
-                    beyondLast = 1;
-                } else if (isFirst == 1) {
-                    isFirst = 0;
+                    cursor->beyondLast = 1;
+                } else if (cursor->isFirst == 1) {
+                    cursor->isFirst = 0;
                 } else {
                     list = list->next;
                 }
 
-                item = beyondLast == 1 ? NULL : list->item;
+                item = cursor->beyondLast == 1 ? NULL : list->item;
                 break;
             case PREV:
                 if(list->prev != NULL) {
-                    if(beyondLast == 1) {
-                        beyondLast = 0;
+                    if(cursor->beyondLast == 1) {
+                        cursor->beyondLast = 0;
                     } else {
                         list = list->prev;
                     }
 
                     item = list->item;
                 } else {
-                    isFirst = 1;
+                    cursor->isFirst = 1;
                 }
                 break;
             default:
@@ -165,6 +166,8 @@ void *getItem(DoublyLinkedList *ll, NavDirection dir)
         }
     }
 
+    cursor->node = list;
+
     return item;
 }
 
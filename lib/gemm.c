@@ -0,0 +1,403 @@
+/** @file gemm.c
+ *  @brief A library made for multiplying matrices fast.
+ *
+ *  This library contains a cache-blocked general matrix
+ *  multiplication engine. The operands are split into blocks
+ *  that stay in the L1/L2/L3 caches, which are packed into
+ *  contiguous panels, and multiplied by a register-blocked
+ *  micro-kernel. Big products are split into tiles of the
+ *  result, which are multiplied across the thread pool.
+ *
+ *  The kernels are compiled once per instruction set of the
+ *  simd library, and the ones of the selected instruction set
+ *  are run, thus the micro-kernel is as wide as its vectors.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "headers/simd.h"
+#include "headers/thread_pool.h"
+#include "headers/gemm.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS 1
+#endif
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwMallocFailed() { fprintf(stderr, "Memory Allocation Failed."); exit(1); }
+#define SHOULD_BE_POSITIVE "It should be a positive integer."
+#define SHOULD_NOT_BE_NULL "It should not be null."
+
+// Register blocking, the micro-kernel computes an MR x NR tile of C,
+// which is kept in two vectors per row of the tile, thus NR is twice
+// the entries of a vector of the instruction set the kernels run on.
+#define MR 4
+
+// Cache blocking, an MC x KC block of A is kept in the L2 cache,
+// a KC x NR micro-panel of B in the L1 cache, and a KC x NC panel
+// of B in the L3 cache.
+#define MC 96
+#define KC 256
+#define NC 2048
+
+#define PACK_ALIGNMENT 64
+
+// The multiply-adds each thread should get at the least, since smaller
+// products are done before the workers of the pool would even wake up.
+#define PARALLEL_MIN_WORK (1L << 17)
+
+// Leaving AVX code with dirty upper halves of the vector registers slows
+// down the SSE code that runs after it, thus they are cleared explicitly.
+#define AVX_LEAVE() __builtin_ia32_vzeroupper()
+#define NO_LEAVE() ((void) 0)
+
+// The kernels that a product can be computed with.
+typedef enum GemmPath { COLUMN_PATH, ROWS_PATH, BLOCKED_PATH } GemmPath;
+
+// The kernels of a single instruction set.
+typedef struct GemmKernels {
+    // The columns of a micro-panel of B, which the tiles of C are split on.
+    int nr;
+    void (*rows)(int m, int n, int k, const Real *a, long rsA, long csA, const Real *b, int ldb, Real *c, int ldc, const GemmEpilogue *ep);
+    void (*column)(int m, int k, const Real *a, int lda, const Real *b, long rsB, Real *c, int ldc, const GemmEpilogue *ep);
+    void (*blocked)(int m, int n, int k, const Real *a, long rsA, long csA, const Real *b, long rsB, long csB, Real *c, int ldc, const GemmEpilogue *ep);
+} GemmKernels;
+
+// A product whose C is split into a grid of tiles, where each tile
+// is multiplied by a task of the thread pool.
+typedef struct GemmTiles {
+    const GemmKernels *kernels;
+    GemmPath path;
+    int m, n, k;
+    const Real *a;
+    long rsA, csA;
+    const Real *b;
+    long rsB, csB;
+    Real *c;
+    int ldc;
+    const GemmEpilogue *ep;
+    int rowParts, colParts;
+} GemmTiles;
+
+typedef struct PackBuffer {
+    void *block;
+    Real *entries;
+    size_t size;
+} PackBuffer;
+
+// Each thread packs into its own buffers, which are reused across calls,
+// and freed when the thread exits through the destructor of the key.
+static __thread PackBuffer packedA, packedB;
+static pthread_key_t packKey;
+static pthread_once_t packKeyOnce = PTHREAD_ONCE_INIT;
+
+static void freePackBuffers(void *arg)
+{
+    free(packedA.block);
+    free(packedB.block);
+    packedA = (PackBuffer) { NULL, NULL, 0 };
+    packedB = (PackBuffer) { NULL, NULL, 0 };
+}
+
+static void createPackKey()
+{
+    pthread_key_create(&packKey, freePackBuffers);
+}
+
+static Real *reservePackBuffer(PackBuffer *buf, size_t size)
+{
+    if(buf->size < size) {
+        if(packedA.block == NULL && packedB.block == NULL) {
+            pthread_once(&packKeyOnce, createPackKey);
+            pthread_setspecific(packKey, &packedA);
+        }
+
+        free(buf->block);
+        buf->block = malloc(size * sizeof(Real) + PACK_ALIGNMENT - 1);
+        if(buf->block == NULL) throwMallocFailed();
+
+        buf->entries = (Real *) (((uintptr_t) buf->block + PACK_ALIGNMENT - 1) & ~((uintptr_t) PACK_ALIGNMENT - 1));
+        buf->size = size;
+    }
+
+    return buf->entries;
+}
+
+// Packs an mc x kc block of A into micro-panels of MR rows, where the
+// MR entries of each column are stored next to each other. Rows past
+// the edge of A are padded with 0s. The entry at row i and column p of
+// A is read from a[i * rs + p * cs], which covers both layouts of A.
+static void packA(int mc, int kc, const Real *a, long rs, long cs, Real *dest)
+{
+    int ir, p, i, mr;
+
+    for(ir = 0; ir < mc; ir += MR) {
+        mr = mc - ir < MR ? mc - ir : MR;
+        for(p = 0; p < kc; p++) {
+            for(i = 0; i < mr; i++) {
+                dest[i] = a[(ir + i) * rs + p * cs];
+            }
+            for(; i < MR; i++) {
+                dest[i] = 0;
+            }
+            dest += MR;
+        }
+    }
+}
+
+// Sigmoid and tanh are left out of the registers of the epilogue, and are
+// applied onto whole rows of C by the vector kernels once they are finished.
+static int isActivatedByRows(const GemmEpilogue *ep)
+{
+    return ep != NULL && (ep->activation == GEMM_SIGMOID || ep->activation == GEMM_TANH) ? 1 : 0;
+}
+
+// Activates an m x n block of C, if its activation is applied by rows.
+static void activateRows(int m, int n, Real *c, int ldc, const GemmEpilogue *ep)
+{
+    Activation activation;
+    int i;
+
+    if(!isActivatedByRows(ep)) return;
+
+    activation = ep->activation == GEMM_SIGMOID ? SIGMOID : TANH;
+    if(ldc == n) {
+        vecActivate(activation, c, c, m * n);
+        return;
+    }
+
+    for(i = 0; i < m; i++) {
+        vecActivate(activation, c + (long) i * ldc, c + (long) i * ldc, n);
+    }
+}
+
+// The custom activations are computed in double precision, like the MapFunc.
+static Real activateEntry(Real val, const GemmEpilogue *ep)
+{
+    switch(ep->activation) {
+        case GEMM_RELU: return val > 0 ? val : 0;
+        case GEMM_CUSTOM: return ep->map(val);
+        default: return val;
+    }
+}
+
+// Adds the bias to, and activates an entry of C at row i and column j.
+static Real finishEntry(Real val, const GemmEpilogue *ep, int i, int j)
+{
+    if(ep->rowBias != NULL) val += ep->rowBias[j];
+    if(ep->colBias != NULL) val += ep->colBias[i];
+
+    return activateEntry(val, ep);
+}
+
+// The portable kernels keep the 16 byte vectors of the original kernels,
+// which every target lowers on its own, e.g. into NEON, or pairs of scalars.
+#define GEMM_WIDTH 16
+#define GEMM_NAME(name) portable##name
+#define GEMM_LEAVE NO_LEAVE
+#include "gemm_kernels.inc"
+#undef GEMM_LEAVE
+#undef GEMM_NAME
+#undef GEMM_WIDTH
+
+#ifdef HAS_X86_KERNELS
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#define GEMM_WIDTH 16
+#define GEMM_NAME(name) sse2##name
+#define GEMM_LEAVE NO_LEAVE
+#include "gemm_kernels.inc"
+#undef GEMM_LEAVE
+#undef GEMM_NAME
+#undef GEMM_WIDTH
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#define GEMM_WIDTH 32
+#define GEMM_NAME(name) avx2##name
+#define GEMM_LEAVE AVX_LEAVE
+#include "gemm_kernels.inc"
+#undef GEMM_LEAVE
+#undef GEMM_NAME
+#undef GEMM_WIDTH
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#define GEMM_WIDTH 64
+#define GEMM_NAME(name) avx512##name
+#define GEMM_LEAVE AVX_LEAVE
+#include "gemm_kernels.inc"
+#undef GEMM_LEAVE
+#undef GEMM_NAME
+#undef GEMM_WIDTH
+#pragma GCC pop_options
+#endif
+
+static const GemmKernels *kernelsByIsa[] = {
+    [SCALAR] = &portableKernels,
+#ifdef HAS_X86_KERNELS
+    [SSE2] = &sse2Kernels,
+    [AVX2] = &avx2Kernels,
+    [AVX512] = &avx512Kernels
+#endif
+};
+
+// Gets the kernels of the instruction set selected by the simd library.
+static const GemmKernels *getGemmKernels()
+{
+    SimdIsa isa = getSimdIsa();
+
+#ifdef HAS_X86_KERNELS
+    // the AVX2 kernels multiply-add with FMA, which is a separate extension
+    if(isa == AVX2) {
+        __builtin_cpu_init();
+        if(!__builtin_cpu_supports("fma")) isa = SSE2;
+    }
+#endif
+
+    return kernelsByIsa[isa];
+}
+
+// Multiplies with the kernel of a given path, where the row of A and the
+// column of B are taken from the steps of whichever one is not transposed.
+static void runGemm(const GemmKernels *kernels, GemmPath path, int m, int n, int k, const Real *a, long rsA, long csA, const Real *b, long rsB, long csB, Real *c, int ldc, const GemmEpilogue *ep)
+{
+    switch(path) {
+        case COLUMN_PATH:
+            kernels->column(m, k, a, rsA, b, rsB, c, ldc, ep);
+            break;
+        case ROWS_PATH:
+            kernels->rows(m, n, k, a, rsA, csA, b, rsB, c, ldc, ep);
+            break;
+        default:
+            kernels->blocked(m, n, k, a, rsA, csA, b, rsB, csB, c, ldc, ep);
+    }
+}
+
+// Gets the range of a part of a dimension split into the given number of
+// parts, whose bounds are kept on multiples of the unit.
+static void getPartRange(int size, int parts, int unit, int part, int *start, int *end)
+{
+    long units = (size + unit - 1) / unit;
+
+    *start = (int) (units * part / parts * unit);
+    *end = (int) (units * (part + 1) / parts * unit);
+    if(*end > size) *end = size;
+}
+
+// Splits C into a grid with as many tiles as threads, but no thinner than a
+// tile of the micro-kernel. Out of the grids that keep the most threads busy,
+// the one with the squarest tiles is picked, since those read the least of A
+// and B per entry of C.
+static void splitTiles(int m, int n, int nr, int threads, int *rowParts, int *colParts)
+{
+    int rows, cols, maxRows, maxCols;
+    double perimeter, bestPerimeter = 0;
+
+    maxRows = (m + MR - 1) / MR;
+    maxCols = (n + nr - 1) / nr;
+    *rowParts = 1;
+    *colParts = 1;
+
+    for(rows = 1; rows <= threads && rows <= maxRows; rows++) {
+        cols = threads / rows < maxCols ? threads / rows : maxCols;
+        perimeter = (double) m / rows + (double) n / cols;
+
+        if(rows * cols > *rowParts * *colParts || (rows * cols == *rowParts * *colParts && perimeter < bestPerimeter)) {
+            *rowParts = rows;
+            *colParts = cols;
+            bestPerimeter = perimeter;
+        }
+    }
+}
+
+static void multiplyTile(void *arg, int task)
+{
+    const GemmTiles *t = (const GemmTiles *) arg;
+    GemmEpilogue ep;
+    int i0, i1, j0, j1;
+
+    getPartRange(t->m, t->rowParts, MR, task / t->colParts, &i0, &i1);
+    getPartRange(t->n, t->colParts, t->kernels->nr, task % t->colParts, &j0, &j1);
+    if(i0 >= i1 || j0 >= j1) return;
+
+    // the kernels index the biases from the corner of the tile
+    if(t->ep != NULL) {
+        ep = *t->ep;
+        if(ep.rowBias != NULL) ep.rowBias += j0;
+        if(ep.colBias != NULL) ep.colBias += i0;
+    }
+
+    runGemm(t->kernels, t->path, i1 - i0, j1 - j0, t->k, t->a + i0 * t->rsA, t->rsA, t->csA, t->b + j0 * t->csB, t->rsB, t->csB,
+        t->c + (long) i0 * t->ldc + j0, t->ldc, t->ep != NULL ? &ep : NULL);
+}
+
+void gemm(GemmTranspose transA, GemmTranspose transB, int m, int n, int k, const Real *a, int lda, const Real *b, int ldb, Real *c, int ldc)
+{
+    GemmEpilogue epilogue = { NULL, NULL, GEMM_IDENTITY, NULL };
+
+    gemmFused(transA, transB, m, n, k, a, lda, b, ldb, c, ldc, epilogue);
+}
+
+void gemmFused(GemmTranspose transA, GemmTranspose transB, int m, int n, int k, const Real *a, int lda, const Real *b, int ldb, Real *c, int ldc, GemmEpilogue epilogue)
+{
+    const GemmEpilogue *ep = NULL;
+    const GemmKernels *kernels = getGemmKernels();
+    GemmTiles tiles;
+    GemmPath path;
+    long rsA, csA, rsB, csB, threads;
+
+    if(m <= 0) throwInvalidArgs("m", SHOULD_BE_POSITIVE);
+    if(n <= 0) throwInvalidArgs("n", SHOULD_BE_POSITIVE);
+    if(k <= 0) throwInvalidArgs("k", SHOULD_BE_POSITIVE);
+    if(a == NULL) throwInvalidArgs("a", SHOULD_NOT_BE_NULL);
+    if(b == NULL) throwInvalidArgs("b", SHOULD_NOT_BE_NULL);
+    if(c == NULL) throwInvalidArgs("c", SHOULD_NOT_BE_NULL);
+    if(transA != NO_TRANS && transA != TRANS) throwInvalidArgs("transA", "");
+    if(transB != NO_TRANS && transB != TRANS) throwInvalidArgs("transB", "");
+    if(lda < (transA == TRANS ? m : k)) throwInvalidArgs("lda", "It should not be less than the columns of a.");
+    if(ldb < (transB == TRANS ? k : n)) throwInvalidArgs("ldb", "It should not be less than the columns of b.");
+    if(ldc < n) throwInvalidArgs("ldc", "It should not be less than n.");
+    if(epilogue.activation == GEMM_CUSTOM && epilogue.map == NULL) throwInvalidArgs("epilogue map", SHOULD_NOT_BE_NULL);
+
+    // an epilogue that leaves the entries as they are is skipped entirely
+    if(epilogue.rowBias != NULL || epilogue.colBias != NULL || epilogue.activation != GEMM_IDENTITY) {
+        ep = &epilogue;
+    }
+
+    // a transposed operand is read with its row and column steps swapped,
+    // instead of being transposed into a copy
+    rsA = transA == TRANS ? 1 : lda;
+    csA = transA == TRANS ? lda : 1;
+    rsB = transB == TRANS ? 1 : ldb;
+    csB = transB == TRANS ? ldb : 1;
+
+    if(n == 1 && transA == NO_TRANS) {
+        path = COLUMN_PATH;
+    } else if(m < MR && transB == NO_TRANS) {
+        path = ROWS_PATH;
+    } else {
+        path = BLOCKED_PATH;
+    }
+
+    threads = (long) m * n * k / PARALLEL_MIN_WORK;
+    if(threads > getThreadCount()) threads = getThreadCount();
+
+    if(threads < 2) {
+        runGemm(kernels, path, m, n, k, a, rsA, csA, b, rsB, csB, c, ldc, ep);
+        return;
+    }
+
+    // every tile goes down the path of the whole product, thus each entry
+    // is summed in the same order no matter how many threads there are
+    tiles = (GemmTiles) { kernels, path, m, n, k, a, rsA, csA, b, rsB, csB, c, ldc, ep, 1, 1 };
+    splitTiles(m, n, kernels->nr, (int) threads, &tiles.rowParts, &tiles.colParts);
+    parallelFor(tiles.rowParts * tiles.colParts, multiplyTile, &tiles);
+}
@@ -0,0 +1,79 @@
+/** @file arena.h
+ *  @brief Function prototypes for the arena library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the arena allocator library.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include <stddef.h>
+
+/** @brief The size of the chunks of an arena, when none is given. */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+/** @brief A chunk of memory that allocations are carved out of. */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;
+    char data[];
+} ArenaChunk;
+
+/** @brief Structure of an arena, which hands out memory by bumping
+ *  an offset, and takes all of it back at once.
+ *
+ *  A zeroed arena is valid, and uses chunks of ARENA_CHUNK_SIZE.
+ *  An arena is not thread-safe, thus each thread should have its own.
+ */
+typedef struct Arena {
+    // The chunks of the arena, which are kept when it is reset.
+    ArenaChunk *first;
+    // The chunk that is currently being allocated from.
+    ArenaChunk *current;
+    // The bytes used in the current chunk.
+    size_t used;
+    // The minimum size of a new chunk.
+    size_t chunkSize;
+} Arena;
+
+/** @brief Creates an empty arena.
+ *
+ *  @param chunkSize The minimum size of the chunks the arena
+ *  allocates from the heap, or 0 for ARENA_CHUNK_SIZE.
+ *  @return An empty arena.
+ */
+Arena createArena(size_t chunkSize);
+/** @brief Allocates memory from an arena, which stays valid
+ *  until the arena is reset or freed.
+ *
+ *  A new chunk is only allocated from the heap when none of
+ *  the chunks after the current one have room for it.
+ *
+ *  @param arena A pointer to the arena.
+ *  @param size The number of bytes to be allocated.
+ *  @param alignment The alignment of the memory, which should be
+ *  a power of two.
+ *  @return A pointer to the allocated memory.
+ */
+void *arenaAlloc(Arena *arena, size_t size, size_t alignment);
+/** @brief Takes back every allocation of an arena at once, while
+ *  keeping its chunks for the allocations after it.
+ *
+ *  @param arena A pointer to the arena to be reset.
+ *  @return Void.
+ */
+void resetArena(Arena *arena);
+/** @brief Returns the total size of the chunks of an arena.
+ *
+ *  @param arena The arena.
+ *  @return The size of the chunks in bytes.
+ */
+size_t getArenaCapacity(Arena arena);
+/** @brief Frees the chunks of an arena from memory.
+ *
+ *  @param arena A pointer to the arena to be freed.
+ *  @return Void.
+ */
+void freeArena(Arena *arena);
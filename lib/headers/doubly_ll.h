@@ -27,6 +27,19 @@ typedef struct DoublyLinkedList {
     List list;
 } DoublyLinkedList;
 
+/** @brief Structure of a position in a list, which is navigated
+ *  by getItem. Each cursor keeps its own position, thus a list can
+ *  be navigated by many cursors at once.
+ */
+typedef struct ListCursor {
+    // The node of the item returned last.
+    List node;
+    // Whether the cursor went past the last item.
+    int beyondLast;
+    // Whether no item has been returned yet.
+    int isFirst;
+} ListCursor;
+
 /** @brief A callback for cleaning up the item inside of node in the list. */
 typedef void (*CleanupFunc)(void *item);
 
@@ -81,28 +94,33 @@ void clearList(DoublyLinkedList *ll, CleanupFunc cleanup);
  *  @return A pointer to the item of the list.
  */
 void* getItemByIndex(DoublyLinkedList ll, int index);
+/** @brief Creates a cursor on the start of a list.
+ *  
+ *  @param ll The list to be navigated.
+ *  @return A cursor, which is before the first item.
+ */
+ListCursor createListCursor(DoublyLinkedList ll);
 /** @brief Navigates through the items of a list in order,
  *  based on a given direction, and the item in the 
  *  current position is returned.
  *  
- *  Only the first call to this function should the list
- *  be passed, since it maintains a static pointer to the
- *  contents of the list. Thus, the next calls should
- *  have a NULL value passed, if you want to get more
- *  items from the list.
+ *  The position is kept in the cursor rather than in the
+ *  function, thus lists can be navigated from many threads,
+ *  or in nested loops, at once.
  * 
  *  @example
- *  getItem(&ll, NEXT);
- *  getItem(NULL, PREV);
+ *  ListCursor cursor = createListCursor(ll);
+ *  getItem(&cursor, NEXT);
+ *  getItem(&cursor, PREV);
  *  
- *  @param ll A pointer to the list to be navigated.
+ *  @param cursor A pointer to the cursor on the list to be navigated.
  *  @param dir The direction used to navigate the list
  *  at a given step, NEXT or PREV.
  *  @return A pointer to the data contained in the 
  *  current position of the navigation, else a NULL
  *  is returned.
  */ 
-void *getItem(DoublyLinkedList *ll, NavDirection dir);
+void *getItem(ListCursor *cursor, NavDirection dir);
 /** @brief Checks if a list is empty.
  *  
  *  @param ll The list to be checked.
@@ -0,0 +1,103 @@
+/** @file gemm.h
+ *  @brief Function prototypes for the gemm library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the general matrix
+ *  multiplication library.
+ *
+ *  DEPENDENCIES: simd, thread_pool
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include "real.h"
+
+/** @brief Whether an operand is read as it is stored, or as its transpose. */
+typedef enum GemmTranspose { NO_TRANS, TRANS } GemmTranspose;
+
+/** @brief The activations that can be applied to the entries of C,
+ *  as part of the epilogue of a multiplication.
+ */
+typedef enum GemmActivation { GEMM_IDENTITY, GEMM_RELU, GEMM_SIGMOID, GEMM_TANH, GEMM_CUSTOM } GemmActivation;
+
+/** @brief Structure of the work done on the entries of C right after
+ *  they are computed, while they are still in registers.
+ */
+typedef struct GemmEpilogue {
+    // A row vector (one entry per column of C) added to every row of C,
+    // or NULL for none.
+    const Real *rowBias;
+    // A column vector (one entry per row of C) added to every column of C,
+    // or NULL for none.
+    const Real *colBias;
+    // The activation applied after the biases are added.
+    GemmActivation activation;
+    // The function applied to each entry, if the activation is GEMM_CUSTOM.
+    double (*map)(double val);
+} GemmEpilogue;
+
+/** @brief Multiplies two row-first matrices, C = op(A) . op(B),
+ *  where op either leaves an operand as it is or transposes it.
+ *
+ *  Products with only a few rows in op(A) (e.g., a single row vector
+ *  fed to a layer) or a single column in op(B) are computed directly
+ *  off of the operands. Bigger products are split into blocks that
+ *  fit the L1/L2/L3 caches, whose panels are packed into contiguous
+ *  buffers and multiplied by a register-blocked micro-kernel. A
+ *  transposed operand is read in its stored layout while packing,
+ *  thus it is never materialized.
+ *
+ *  The kernels run on the instruction set selected by the simd
+ *  library (see getSimdIsa). The micro-kernel computes 4 rows by
+ *  two vectors of C, i.e. 4 x 16 doubles with FMA on AVX-512,
+ *  4 x 8 doubles with FMA on AVX2, and 4 x 4 doubles on SSE2, as
+ *  well as on the scalar selection, which keeps portable 16 byte
+ *  vectors. Thus the last bits of C may differ between them.
+ *
+ *  Products with enough multiply-adds to keep more than one thread
+ *  busy are split into blocks of the rows and columns of C, which
+ *  are multiplied across the threads of the thread pool. The split
+ *  does not change the order that each entry is summed in, thus
+ *  the result does not depend on the number of threads.
+ *
+ *  @param transA Whether A is transposed.
+ *  @param transB Whether B is transposed.
+ *  @param m Number of rows of op(A) and C.
+ *  @param n Number of columns of op(B) and C.
+ *  @param k Number of columns of op(A) and rows of op(B).
+ *  @param a The entries of A (m x k, or k x m if transposed).
+ *  @param lda The row stride of A.
+ *  @param b The entries of B (k x n, or n x k if transposed).
+ *  @param ldb The row stride of B.
+ *  @param c The entries of C (m x n), which are overwritten.
+ *  @param ldc The row stride of C.
+ *  @return Void.
+ */
+void gemm(GemmTranspose transA, GemmTranspose transB, int m, int n, int k, const Real *a, int lda, const Real *b, int ldb, Real *c, int ldc);
+/** @brief Multiplies two row-first matrices, adds the biases, and
+ *  applies an activation in one pass, C = act(op(A) . op(B) + bias).
+ *
+ *  The biases and the activation are applied by the epilogue of
+ *  the kernels, when the entries of C are finished, thus C is
+ *  never read back from memory just to be activated. ReLU is
+ *  applied in registers, while sigmoid and tanh are applied onto
+ *  the finished rows of a block by the vector kernels of the simd
+ *  library, while the block is still in the cache.
+ *
+ *  @param transA Whether A is transposed.
+ *  @param transB Whether B is transposed.
+ *  @param m Number of rows of op(A) and C.
+ *  @param n Number of columns of op(B) and C.
+ *  @param k Number of columns of op(A) and rows of op(B).
+ *  @param a The entries of A (m x k, or k x m if transposed).
+ *  @param lda The row stride of A.
+ *  @param b The entries of B (k x n, or n x k if transposed).
+ *  @param ldb The row stride of B.
+ *  @param c The entries of C (m x n), which are overwritten.
+ *  @param ldc The row stride of C.
+ *  @param epilogue The biases and activation to be applied.
+ *  @return Void.
+ */
+void gemmFused(GemmTranspose transA, GemmTranspose transB, int m, int n, int k, const Real *a, int lda, const Real *b, int ldb, Real *c, int ldc, GemmEpilogue epilogue);
@@ -4,7 +4,7 @@
  *  This contains the prototypes, type definitions,
  *  constants, and globals for the image set library.
  * 
- *  DEPENDENCIES: matrix, ml
+ *  DEPENDENCIES: matrix, sparse, ml
  * 
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No known bugs.
@@ -0,0 +1,248 @@
+/** @file inference.h
+ *  @brief Function prototypes for the inference library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the inference library.
+ *
+ *  DEPENDENCIES: simd, matrix, sparse, stats, neural_net, ml
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "matrix.h"
+#include "sparse.h"
+#include "stats.h"
+#include "neural_net.h"
+#include "ml.h"
+
+/** @brief The number of images that are fed through the layers of
+ *  a model at once, as the rows (or columns) of a single matrix.
+ */
+#define PREDICT_BATCH 64
+
+/** @brief Structure of a trained Neural Network that is served for
+ *  inference.
+ *
+ *  A model holds its own copy of the parameters, and nothing in it
+ *  is changed after it is created, thus a single model can be shared
+ *  by any number of threads, each with its own inference context.
+ */
+typedef struct InferenceModel {
+    // The copy of the Neural Network that is served.
+    NeuralNetwork nn;
+    // The activation function the Neural Network was trained with.
+    ActivationFunc activate;
+    // The function the pixels of each image are formatted with,
+    // as they were when the Neural Network was trained, or NULL
+    // for none.
+    TransformFunc transform;
+    // Whether the model owns its copy of the Neural Network, rather
+    // than sharing the one it was created with.
+    int ownsNet;
+    // Whether the formatting of the pixels is folded into the first
+    // layer, which is then fed the raw pixels.
+    int feedsPixels;
+} InferenceModel;
+
+/** @brief The kernels that a layer of a plan can be run on. */
+typedef enum PlanKernel { 
+    // The fused kernel of the gemm library, which adds the bias, and
+    // applies the activation, while the results are still in registers.
+    PLAN_DENSE, 
+    // The sparse kernel, which only multiplies the weights of the nonzero
+    // inputs when they are given, or else the dense one.
+    PLAN_SPARSE 
+} PlanKernel;
+
+/** @brief Structure of a layer of a plan, with everything that running 
+ *  it needs resolved ahead of time.
+ */
+typedef struct PlanStep {
+    // The nodes of the previous layer, and of this layer.
+    int inputs;
+    int nodes;
+    // The layer, whose weights and bias are run.
+    Layer layer;
+    PlanKernel kernel;
+    // The bias and activation that the fused kernel applies.
+    GemmEpilogue epilogue;
+} PlanStep;
+
+/** @brief Structure of a Neural Network compiled for running batches
+ *  of up to a given size, without allocating, nor traversing, anything.
+ */
+typedef struct InferencePlan {
+    // The layers that are run, starting from the first hidden layer.
+    PlanStep *steps;
+    int size;
+    // The largest batch the plan can run at once.
+    int maxBatch;
+    NodeOrientation nodeOrient;
+    ActivationFunc activate;
+    // Two buffers that the layers alternate between writing into,
+    // each big enough for the results of the widest layer for a batch.
+    Matrix buffers[2];
+} InferencePlan;
+
+/** @brief Structure of the scratch memory of a thread that runs a
+ *  model. A context should only be used by one thread at a time.
+ */
+typedef struct InferenceContext {
+    // The model that is run.
+    const InferenceModel *model;
+    // The inputs of a batch of images, as rows for row nodes, or
+    // as columns for column nodes.
+    Matrix inputs;
+    // The nonzero inputs of a batch of images, as rows, which are fed
+    // to the first layer instead if few enough of them are nonzero. It
+    // is empty for column nodes, which are always fed the dense inputs.
+    SparseMatrix sparseInputs;
+    // The pixels of a single image, as they are formatted.
+    Matrix pixels;
+    // The model, compiled for batches of PREDICT_BATCH images.
+    InferencePlan plan;
+} InferenceContext;
+
+/** @brief Creates a model out of a trained Neural Network.
+ *
+ *  @param nn The Neural Network to be served, which is copied, thus
+ *  it can keep on being trained, or be freed, after.
+ *  @param activate The activation function the Neural Network was
+ *  trained with (sigmoid, reLU, tanh).
+ *  @param transform The function the inputs were formatted with
+ *  by prepData (e.g. normalize), or NULL for none.
+ *  @return A model.
+ */
+InferenceModel createInferenceModel(NeuralNetwork nn, ActivationFunc activate, TransformFunc transform);
+/** @brief Creates a model for deployment, where the affine formatting
+ *  of the pixels, pixel * scale + offset (e.g. a scale of 1 / 255), is
+ *  folded into the weights and biases of the first layer.
+ * 
+ *  Since W . (x * scale + offset) + b = (W * scale) . x + (b + offset * 
+ *  sum(W)), the first layer of the copy is fed the raw pixels, which 
+ *  are neither converted, nor formatted, before they are multiplied.
+ *
+ *  @param nn The Neural Network to be served, which is copied, thus
+ *  it can keep on being trained, or be freed, after.
+ *  @param activate The activation function the Neural Network was
+ *  trained with (sigmoid, reLU, tanh).
+ *  @param scale The factor each pixel was scaled by when the Neural 
+ *  Network was trained.
+ *  @param offset The value added to each pixel after it was scaled.
+ *  @return A model.
+ */
+InferenceModel createDeployModel(NeuralNetwork nn, ActivationFunc activate, double scale, double offset);
+/** @brief Creates a model that shares the layers and parameters of
+ *  a trained Neural Network, rather than copying them. 
+ * 
+ *  This is meant for Neural Networks that are not trained anymore, 
+ *  e.g. ones mapped from a model file, whose parameters are then 
+ *  shared with every other process that maps the same file.
+ *
+ *  @param nn The Neural Network to be served, which should not be
+ *  changed, nor freed, while the model is in use.
+ *  @param activate The activation function the Neural Network was
+ *  trained with (sigmoid, reLU, tanh).
+ *  @param transform The function the inputs were formatted with
+ *  by prepData (e.g. normalize), or NULL for none.
+ *  @return A model.
+ */
+InferenceModel shareInferenceModel(NeuralNetwork nn, ActivationFunc activate, TransformFunc transform);
+/** @brief Compiles a Neural Network into a plan, which runs batches
+ *  of inputs through it with everything but the multiplications
+ *  resolved ahead of time.
+ * 
+ *  The shapes, biases, and activation of every layer are resolved,
+ *  along with the kernel that runs it, and the buffers the layers 
+ *  write into are allocated for the largest batch. The plan views 
+ *  the layers of the Neural Network, thus it should not be changed, 
+ *  nor freed, while the plan is in use, although its parameters can
+ *  be trained in place.
+ * 
+ *  @param nn The Neural Network to be compiled, which should have
+ *  at least one layer after the input layer.
+ *  @param activate The activation function to activate the neurons 
+ *  in the Neural Network (sigmoid, reLU, tanh).
+ *  @param maxBatch The largest number of inputs run at once.
+ *  @return A plan.
+ */
+InferencePlan compileInferencePlan(NeuralNetwork nn, ActivationFunc activate, int maxBatch);
+/** @brief Runs a batch of inputs through a plan.
+ * 
+ *  @param plan A pointer to the plan, whose buffers are written to, 
+ *  thus it should only be run by one thread at a time.
+ *  @param inputs The inputs, one per row for row nodes (batch x inputs),
+ *  or one per column for column nodes (inputs x batch).
+ *  @param sparseInputs The nonzero inputs, one per row, which the first
+ *  layer is fed instead if it runs on PLAN_SPARSE, or NULL for none.
+ *  @return A view of the results of the output layer, shaped like
+ *  the inputs, which is valid until the plan is run again.
+ */
+Matrix runInferencePlan(InferencePlan *plan, Matrix inputs, const SparseMatrix *sparseInputs);
+/** @brief Runs a batch of raw pixels through a plan, whose first 
+ *  layer multiplies them as they are, without converting them first.
+ * 
+ *  Only the weights of the nonzero pixels are read, thus blank pixels
+ *  cost nothing. This is meant for the plans of deployed models, whose
+ *  first layer has the formatting of the pixels folded into it.
+ * 
+ *  @param plan A pointer to the plan, whose buffers are written to, 
+ *  thus it should only be run by one thread at a time.
+ *  @param pixels The pixels of the images, stored one image after
+ *  another, with as many pixels per image as the input layer has nodes.
+ *  @param batch The number of images, up to the largest batch of the plan.
+ *  @return A view of the results of the output layer, one per row for 
+ *  row nodes, or one per column for column nodes, which is valid until
+ *  the plan is run again.
+ */
+Matrix runInferencePlanOnPixels(InferencePlan *plan, const uint8_t *pixels, int batch);
+/** @brief Frees the buffers, and the layers, of a plan.
+ *
+ *  @param plan A pointer to the plan to be freed.
+ *  @return Void.
+ */
+void freeInferencePlan(InferencePlan *plan);
+/** @brief Creates the scratch memory for running a model from a
+ *  single thread.
+ *
+ *  @param model A pointer to the model, which should outlive the context.
+ *  @return A context.
+ */
+InferenceContext createInferenceContext(const InferenceModel *model);
+/** @brief Predicts the labels of a number of images.
+ *
+ *  The pixels are formatted into the inputs of the context as they
+ *  are read, up to PREDICT_BATCH images at a time, and each batch is
+ *  run through the plan of the context. Like forwardPropagate, the
+ *  first layer of row nodes is fed the nonzero inputs alone, if at 
+ *  most SPARSE_INPUT_MAX_DENSITY of them are. Deployed models are fed
+ *  the raw pixels instead, which are never formatted. Only the context 
+ *  is written to, thus threads with their own contexts can predict on
+ *  the same model at once.
+ *
+ *  @param ctx A pointer to the context of the calling thread.
+ *  @param pixels The pixels of the images, stored one image after
+ *  another, with as many pixels per image as the input layer has nodes.
+ *  @param n The number of images.
+ *  @param labels The destination array, where the predicted label of
+ *  each image is stored.
+ *  @return Void.
+ */
+void predict(InferenceContext *ctx, const uint8_t *pixels, int n, int *labels);
+/** @brief Frees the scratch memory of a context.
+ *
+ *  @param ctx A pointer to the context to be freed.
+ *  @return Void.
+ */
+void freeInferenceContext(InferenceContext *ctx);
+/** @brief Frees a model from memory, along with its copy of the
+ *  Neural Network, if it has one. Every context of the model should
+ *  no longer be used.
+ *
+ *  @param model A pointer to the model to be freed.
+ *  @return Void.
+ */
+void freeInferenceModel(InferenceModel *model);
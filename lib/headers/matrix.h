@@ -4,21 +4,110 @@
  *  This contains the prototypes, type definitions,
  *  constants, and globals for the matrix library.
  * 
+ *  DEPENDENCIES: arena, gemm, simd, rng
+ * 
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No known bugs.
  */
 
 #pragma once
 
+#include "real.h"
+#include "arena.h"
+#include "simd.h"
+#include "gemm.h"
+
+/** @brief The byte alignment of the storage allocated for a matrix. */
+#define MATRIX_ALIGNMENT 64
+
+/** @brief Accesses the entry of a matrix at a given row and column. */
+#define MATRIX_AT(m, r, c) ((m).entries[(long) (r) * (m).stride + (c)])
+/** @brief Returns a pointer to the first entry of a given row of a matrix. */
+#define MATRIX_ROW(m, r) ((m).entries + (long) (r) * (m).stride)
+
 /** @brief Structure of the Matrix which contains its 
  *  entries, and dimensions (rows, columns).
+ * 
+ *  The entries are stored row-first as Real (double, or float 
+ *  in float32 builds) in a single allocation,
+ *  where each row starts stride entries after the previous one.
+ *  Views share the entries of another matrix or array, and have
+ *  no block of their own.
  */
 typedef struct Matrix {
-    double **entries;
+    Real *entries;
     int row;
     int col;
+    // Distance (in entries) between the starts of two adjacent rows.
+    int stride;
+    // The allocation that owns the entries, NULL for views, and
+    // matrices allocated from an arena.
+    void *block;
 } Matrix;
 
+/** @brief A matrix kept in a pool, while it is not in use. */
+typedef struct PoolNode {
+    Matrix m;
+    struct PoolNode *next;
+} PoolNode;
+
+/** @brief The matrices of a single shape kept in a pool. */
+typedef struct PoolShape {
+    int row;
+    int col;
+    // The free matrices of this shape.
+    PoolNode *free;
+    struct PoolShape *next;
+} PoolShape;
+
+/** @brief Structure of a pool of matrices, which keeps released
+ *  matrices in free-lists keyed by their shape, so that buffers
+ *  which outlive a step can be reused instead of reallocated.
+ * 
+ *  A zeroed pool is valid. A pool is not thread-safe, thus each
+ *  thread should have its own.
+ */
+typedef struct MatrixPool {
+    PoolShape *shapes;
+    // Nodes of matrices that were acquired, kept for reuse.
+    PoolNode *spareNodes;
+} MatrixPool;
+
+/** @brief The largest number of operations an expression can hold. */
+#define MATRIX_EXPR_MAX_OPS 16
+
+/** @brief The operations that an expression is recorded as. */
+typedef enum ExprOp { EXPR_LOAD, EXPR_ADD, EXPR_SUBTRACT, EXPR_MULTIPLY, EXPR_SCALE, EXPR_ACTIVATE, EXPR_ACTIVATE_PRIME } ExprOp;
+
+/** @brief A single operation of an expression. */
+typedef struct ExprNode {
+    ExprOp op;
+    // Only the argument of the operation is stored.
+    union {
+        // The matrix loaded, if the operation is EXPR_LOAD.
+        Matrix m;
+        // The factor, if the operation is EXPR_SCALE.
+        double val;
+        // The activation, if the operation is EXPR_ACTIVATE or EXPR_ACTIVATE_PRIME.
+        Activation activation;
+    };
+} ExprNode;
+
+/** @brief Structure of a lazy elementwise expression over matrices.
+ * 
+ *  The operations are only recorded, in postfix order, where each 
+ *  operation takes its operands off of the results of the ones 
+ *  recorded before it. Nothing is computed until the expression is 
+ *  evaluated, thus a chain of operations needs no temporary matrices.
+ *  A zeroed expression is empty.
+ */
+typedef struct MatrixExpr {
+    int size;
+    // The number of results left by the operations recorded so far.
+    int depth;
+    ExprNode ops[MATRIX_EXPR_MAX_OPS];
+} MatrixExpr;
+
 /** @brief A function that maps a double to another double value */
 typedef double (*MapFunc)(double val);
 
@@ -37,6 +126,78 @@ Matrix createMatrix(int row, int col);
  *  @return A Matrix with dimensions 0 x 0.
  */
 Matrix createZeroMatrix();
+/** @brief Returns a Matrix struct whose entries are allocated 
+ *  from an arena, instead of the heap.
+ * 
+ *  The entries stay valid until the arena is reset or freed, 
+ *  which takes them back along with everything else allocated 
+ *  from the arena. Freeing the matrix itself only clears it.
+ * 
+ *  @param arena A pointer to the arena to be allocated from.
+ *  @param row Number of rows in the matrix. 
+ *  @param col Number of columns in the matrix.
+ *  @return A Matrix with dimensions row x col.
+ */
+Matrix createArenaMatrix(Arena *arena, int row, int col);
+/** @brief Takes a matrix of a given shape from a pool, or creates
+ *  one if the pool has none of that shape.
+ * 
+ *  The entries of the matrix are left as they are.
+ * 
+ *  @param pool A pointer to the pool.
+ *  @param row Number of rows in the matrix. 
+ *  @param col Number of columns in the matrix.
+ *  @return A Matrix with dimensions row x col.
+ */
+Matrix acquireMatrix(MatrixPool *pool, int row, int col);
+/** @brief Gives a matrix back to a pool, for it to be acquired
+ *  again later. The matrix is cleared afterwards.
+ * 
+ *  @param pool A pointer to the pool.
+ *  @param m A pointer to a matrix created by createMatrix, 
+ *  or acquired from a pool.
+ *  @return Void.
+ */
+void releaseMatrix(MatrixPool *pool, Matrix *m);
+/** @brief Frees a pool, and every matrix kept in it from memory.
+ * 
+ *  @param pool A pointer to the pool to be freed.
+ *  @return Void.
+ */
+void freeMatrixPool(MatrixPool *pool);
+/** @brief Returns a view over an existing array of entries.
+ * 
+ *  The view does not own the entries, thus freeing the view 
+ *  leaves the array untouched.
+ * 
+ *  @param entries The array that holds the entries row-first.
+ *  @param row Number of rows in the view. 
+ *  @param col Number of columns in the view.
+ *  @param stride The distance (in entries) between the start
+ *  of two adjacent rows in the array. 
+ *  @return A Matrix view with dimensions row x col.
+ */
+Matrix createMatrixView(Real *entries, int row, int col, int stride);
+/** @brief Returns a view over a block of a matrix, without
+ *  copying its entries.
+ * 
+ *  @param m The matrix to be viewed. 
+ *  @param rowStart The first row of the block (starting at 0). 
+ *  @param colStart The first column of the block (starting at 0). 
+ *  @param row Number of rows in the block. 
+ *  @param col Number of columns in the block.
+ *  @return A Matrix view with dimensions row x col.
+ */
+Matrix getSubMatrix(Matrix m, int rowStart, int colStart, int row, int col);
+/** @brief Returns a view over a range of rows of a matrix, 
+ *  without copying its entries (e.g., a mini-batch window).
+ * 
+ *  @param m The matrix to be viewed. 
+ *  @param rowStart The first row of the range (starting at 0). 
+ *  @param row Number of rows in the range.
+ *  @return A Matrix view with dimensions row x m.col.
+ */
+Matrix getRowRange(Matrix m, int rowStart, int row);
 /** @brief Fills all of the entries of matrix m, with the given value.
  * 
  *  @param m The matrix to be filled with a value. 
@@ -45,7 +206,7 @@ Matrix createZeroMatrix();
  */
 void fillMatrix(Matrix m, double val);
 /** @brief Fills all of the entries of matrix m, with a randomly generated
- *  value.
+ *  value, drawn from the generator of the calling thread (see rng.h).
  * 
  *  @param m The matrix to be filled with a value. 
  *  @param min The minimum possible value to be randomly generated. 
@@ -67,6 +228,8 @@ void mapMatrix(Matrix m, MapFunc map);
 /** @brief Frees the dynamically stored entries of the matrix,
  *  and sets the matrix's dimensions to 0x0.
  * 
+ *  Views are only reset, since they do not own their entries.
+ * 
  *  @param m A pointer to the matrix to be freed. 
  *  @return Void.
  */
@@ -110,6 +273,22 @@ int isRowMatrix(Matrix m);
  *  0 - If it is not.
  */
 int isZeroMatrix(Matrix m);
+/** @brief Checks if the matrix supplied is
+ *  a view over the entries of another matrix or array. 
+ * 
+ *  @param m The matrix to be checked. 
+ *  @return 1 - If matrix is a view. 
+ *  0 - If it is not.
+ */
+int isMatrixView(Matrix m);
+/** @brief Checks if the entries of the matrix supplied
+ *  are stored back to back, without gaps between rows. 
+ * 
+ *  @param m The matrix to be checked. 
+ *  @return 1 - If matrix is contiguous. 
+ *  0 - If it is not.
+ */
+int isContiguousMatrix(Matrix m);
 
 /** @brief Adds two matrices together.
  * 
@@ -119,6 +298,9 @@ int isZeroMatrix(Matrix m);
  *  matrix that contains the added result of the two
  *  matrices.
  * 
+ *  A row matrix b with as many columns as a is broadcasted,
+ *  and added to every row of a.
+ * 
  *  @param a Addend matrix. 
  *  @param b Addend matrix. 
  *  @return A Matrix that is the sum of a and b.
@@ -132,6 +314,9 @@ Matrix add(Matrix a, Matrix b);
  *  matrix that contains the subtracted result of the two
  *  matrices.
  * 
+ *  A row matrix sub with as many columns as min is broadcasted,
+ *  and subtracted from every row of min.
+ * 
  *  @param min Minuend matrix. 
  *  @param sub Subtrahend matrix. 
  *  @return A Matrix that is the difference of a and b.
@@ -144,19 +329,27 @@ Matrix subtract(Matrix min, Matrix sub);
  *  @return A Matrix that has been scaled by a factor val.
  */
 Matrix scale(Matrix a, double val); 
-/** @brief Dot multiplies two matrices.
+/** @brief Dot multiplies two matrices, op(a) . op(b), where op
+ *  either leaves a factor as it is or transposes it.
  * 
- *  The two matrices should have a row and column that are equal.
- *  If there is no row in one matrix that equals the column of the
- *  other matrix, then the function throws an error. Else, it
- *  returns the resulting matrix of the dot operation.
+ *  The columns of op(a) should be equal to the rows of op(b), 
+ *  otherwise the function throws an error. A transposed factor
+ *  is read in its stored layout, thus it is never copied.
  * 
  *  @param a Factor matrix. 
  *  @param b Factor matrix. 
+ *  @param transA Whether a is transposed [NO_TRANS, TRANS].
+ *  @param transB Whether b is transposed [NO_TRANS, TRANS].
  *  @return A Matrix that contains the values of the dot operation.
  */
-Matrix dot(Matrix a, Matrix b); 
+Matrix dot(Matrix a, Matrix b, GemmTranspose transA, GemmTranspose transB); 
 /** @brief Flips the matrix's row and columns.
+ * 
+ *  A unit row or unit column matrix with contiguous entries is 
+ *  only reshaped, and a square matrix that owns its entries is
+ *  transposed in place. Any other matrix is copied into a new 
+ *  one tile by tile, so that both matrices are walked in blocks
+ *  that fit the cache.
  * 
  *  @param a A pointer to the matrix to be transposed. 
  *  @return Void.
@@ -170,6 +363,205 @@ void transpose(Matrix* a);
  */
 void flatten(Matrix* a, MatrixAxis axis); 
 
+/** @brief Adds two matrices together, and stores the 
+ *  result in a destination matrix instead of allocating one.
+ * 
+ *  Follows the same rules as add. The destination matrix
+ *  should have the same dimensions as a, and may be one
+ *  of the addends.
+ * 
+ *  @param a Addend matrix. 
+ *  @param b Addend matrix. 
+ *  @param out The destination matrix. 
+ *  @return Void.
+ */
+void addInto(Matrix a, Matrix b, Matrix out);
+/** @brief Subtracts two matrices, and stores the result
+ *  in a destination matrix instead of allocating one.
+ * 
+ *  Follows the same rules as subtract. The destination 
+ *  matrix should have the same dimensions as min, and may
+ *  be the minuend or the subtrahend.
+ * 
+ *  @param min Minuend matrix. 
+ *  @param sub Subtrahend matrix. 
+ *  @param out The destination matrix. 
+ *  @return Void.
+ */
+void subtractInto(Matrix min, Matrix sub, Matrix out);
+/** @brief Scales the values of a matrix a by a factor val,
+ *  and stores the result in a destination matrix instead of
+ *  allocating one.
+ * 
+ *  @param a The matrix to be scaled. 
+ *  @param val The factor the matrix should be scaled by. 
+ *  @param out The destination matrix, with the same dimensions
+ *  as a, which may be a itself.
+ *  @return Void.
+ */
+void scaleInto(Matrix a, double val, Matrix out);
+/** @brief Scales the values of a matrix by a factor val,
+ *  overwriting its entries.
+ * 
+ *  @param a The matrix to be scaled. 
+ *  @param val The factor the matrix should be scaled by. 
+ *  @return Void.
+ */
+void scaleInPlace(Matrix a, double val);
+/** @brief Accumulates a scaled matrix onto another matrix,
+ *  y = alpha * x + y.
+ * 
+ *  @param alpha The factor x is scaled by. 
+ *  @param x The matrix to be accumulated. 
+ *  @param y The matrix accumulated onto, with the same
+ *  dimensions as x.
+ *  @return Void.
+ */
+void axpy(double alpha, Matrix x, Matrix y);
+/** @brief Dot multiplies two matrices, and stores the result
+ *  in a destination matrix instead of allocating one.
+ * 
+ *  Follows the same rules as dot. The destination matrix 
+ *  should have the dimensions of the result, and should not
+ *  share entries with either of the factors.
+ * 
+ *  @param a Factor matrix. 
+ *  @param b Factor matrix. 
+ *  @param transA Whether a is transposed [NO_TRANS, TRANS].
+ *  @param transB Whether b is transposed [NO_TRANS, TRANS].
+ *  @param out The destination matrix. 
+ *  @return Void.
+ */
+void dotInto(Matrix a, Matrix b, GemmTranspose transA, GemmTranspose transB, Matrix out);
+/** @brief Dot multiplies two matrices, adds a bias, and applies 
+ *  an activation in one pass, out = activation(op(a) . op(b) + bias).
+ * 
+ *  Follows the same rules as dot. The bias is applied while the
+ *  entries of the result are still in registers, instead of in 
+ *  separate passes over the destination matrix.
+ * 
+ *  @param a Factor matrix. 
+ *  @param b Factor matrix. 
+ *  @param transA Whether a is transposed [NO_TRANS, TRANS].
+ *  @param transB Whether b is transposed [NO_TRANS, TRANS].
+ *  @param bias Either a row (1 x out.col) added to every row of the
+ *  result, or a contiguous column (out.row x 1) added to every column.
+ *  @param activation The activation applied to the entries.
+ *  @param map The function applied to the entries, if the activation
+ *  is GEMM_CUSTOM, otherwise it is ignored.
+ *  @param out The destination matrix, which should not share 
+ *  entries with either of the factors.
+ *  @return Void.
+ */
+void dotFusedInto(Matrix a, Matrix b, GemmTranspose transA, GemmTranspose transB, Matrix bias, GemmActivation activation, MapFunc map, Matrix out);
+/** @brief Stores the transpose of a matrix in a destination
+ *  matrix instead of allocating one.
+ * 
+ *  The matrices are walked in square tiles, so that the rows
+ *  of a tile that are read and written both stay in the cache.
+ * 
+ *  @param a The matrix to be transposed. 
+ *  @param out The destination matrix, with the flipped dimensions
+ *  of a, which should not share entries with a.
+ *  @return Void.
+ */
+void transposeInto(Matrix a, Matrix out);
+/** @brief Applies a built-in activation to the entries of a 
+ *  matrix with the vector kernels of the simd library, and 
+ *  stores the result in a destination matrix.
+ * 
+ *  Unlike mapMatrix, no function is called per entry. 
+ * 
+ *  @param a The matrix to be activated. 
+ *  @param activation The activation (IDENTITY, RELU, SIGMOID, TANH).
+ *  @param out The destination matrix, which may be a.
+ *  @return Void.
+ */
+void activateInto(Matrix a, Activation activation, Matrix out);
+/** @brief Applies the derivative of a built-in activation to the 
+ *  entries of a matrix, and stores the result in a destination matrix.
+ * 
+ *  @param a The matrix of the values before they were activated. 
+ *  @param activation The activation (IDENTITY, RELU, SIGMOID, TANH).
+ *  @param out The destination matrix, which may be a.
+ *  @return Void.
+ */
+void activatePrimeInto(Matrix a, Activation activation, Matrix out);
+
+/** @brief Records the loading of the entries of a matrix onto an 
+ *  expression, which leaves them as a result.
+ * 
+ *  The matrix is only read when the expression is evaluated.
+ * 
+ *  @param e A pointer to the expression. 
+ *  @param m The matrix to be loaded. 
+ *  @return Void.
+ */
+void exprLoad(MatrixExpr *e, Matrix m);
+/** @brief Records an addition onto an expression, which replaces 
+ *  the last two results a and b with a + b.
+ * 
+ *  @param e A pointer to the expression. 
+ *  @return Void.
+ */
+void exprAdd(MatrixExpr *e);
+/** @brief Records a subtraction onto an expression, which replaces 
+ *  the last two results min and sub with min - sub.
+ * 
+ *  @param e A pointer to the expression. 
+ *  @return Void.
+ */
+void exprSubtract(MatrixExpr *e);
+/** @brief Records an entry by entry multiplication onto an expression, 
+ *  which replaces the last two results a and b with a * b.
+ * 
+ *  @param e A pointer to the expression. 
+ *  @return Void.
+ */
+void exprMultiply(MatrixExpr *e);
+/** @brief Records a scaling onto an expression, which scales the last
+ *  result by a factor val.
+ * 
+ *  @param e A pointer to the expression. 
+ *  @param val The factor the result should be scaled by. 
+ *  @return Void.
+ */
+void exprScale(MatrixExpr *e, double val);
+/** @brief Records a built-in activation onto an expression, which is
+ *  applied to the last result.
+ * 
+ *  @param e A pointer to the expression. 
+ *  @param activation The activation (IDENTITY, RELU, SIGMOID, TANH).
+ *  @return Void.
+ */
+void exprActivate(MatrixExpr *e, Activation activation);
+/** @brief Records the derivative of a built-in activation onto an 
+ *  expression, which is applied to the last result.
+ * 
+ *  @param e A pointer to the expression. 
+ *  @param activation The activation (IDENTITY, RELU, SIGMOID, TANH).
+ *  @return Void.
+ */
+void exprActivatePrime(MatrixExpr *e, Activation activation);
+/** @brief Evaluates an expression, and stores its single result in a 
+ *  destination matrix, e.g. w = w - lr * g is evaluated from an 
+ *  expression recorded by exprLoad(w), exprLoad(g), exprScale(lr), 
+ *  and exprSubtract().
+ * 
+ *  The entries are evaluated in chunks that fit the L1 cache, where 
+ *  every operation runs over a chunk before the next chunk is taken, 
+ *  thus each matrix is read once and out is written once, however 
+ *  long the chain is. The matrices should have the dimensions of out, 
+ *  where a single row is broadcasted to every row of out like in add.
+ *  The expression is left as it is, thus it can be evaluated again.
+ * 
+ *  @param e A pointer to the expression to be evaluated. 
+ *  @param out The destination matrix, which may be one of the 
+ *  matrices of the expression.
+ *  @return Void.
+ */
+void evalExprInto(const MatrixExpr *e, Matrix out);
+
 /** @brief Copies the entries of a src matrix into
  *  the the entries of a destination matrix with similar
  *  size. If the src is smaller than the dest, then the 
@@ -199,7 +591,7 @@ void copyMatrix(Matrix src, Matrix dest);
  *  @param dest The matrix destination for the contents.
  *  @return Void.
  */
-void copyArrToMatrix(double src[], int size, Matrix dest);
+void copyArrToMatrix(Real src[], int size, Matrix dest);
 /** @brief Copies the contents of a matrix into an array
  *  following a row-first order.
  *  
@@ -213,4 +605,4 @@ void copyArrToMatrix(double src[], int size, Matrix dest);
  *  @param size The size of the destination array.
  *  @return Void.
  */ 
-void copyMatrixToArr(Matrix src, double dest[], int size);
\ No newline at end of file
+void copyMatrixToArr(Matrix src, Real dest[], int size);
\ No newline at end of file
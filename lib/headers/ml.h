@@ -6,7 +6,7 @@
  *  constants, and globals for the machine learning 
  *  library.
  * 
- *  DEPENDENCIES: matrix, stats, neural_net 
+ *  DEPENDENCIES: arena, simd, rng, thread_pool, matrix, sparse, stats, neural_net, optim 
  * 
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No known bugs.
@@ -15,7 +15,18 @@
 
 #include "stats.h"
 #include "matrix.h"
+#include "sparse.h"
 #include "neural_net.h"
+#include "optim.h"
+
+/** @brief The highest fraction of nonzero inputs that prepared data
+ *  keeps a sparse copy of its inputs for.
+ */
+#define SPARSE_INPUT_MAX_DENSITY 0.5
+/** @brief The fewest samples of a batch that each thread trains on,
+ *  thus smaller batches are split across fewer threads.
+ */
+#define TRAIN_MIN_SHARD_SIZE 8
 
 /** @brief A simple data structure. */
 typedef struct Data {
@@ -24,6 +35,9 @@ typedef struct Data {
     // Input values that are fed to a neural net
     // that should result into the expected value
     Matrix inputValues; 
+    // The nonzero input values, as a single row, which are
+    // fed to the first layer instead if the matrix is not empty
+    SparseMatrix sparseInputs;
 } Data;
 
 /** @brief The function called to activate the nodes of the layers of the Neural Network. */
@@ -34,6 +48,9 @@ typedef MapFunc ActivationFunc;
  * 
  *  The input values of the data is flattened based on an 
  *  axis, and then formatted based on a transform function.
+ *  If at most SPARSE_INPUT_MAX_DENSITY of the formatted values
+ *  are nonzero, a sparse copy of them is kept alongside, thus the
+ *  input values should not be changed after the data is prepared.
  * 
  *  @param data A pointer to the data to be prepared.
  *  @param axis The matrix axis that the input values should 
@@ -73,17 +90,153 @@ void prepDataset(Data dataset[], int size, MatrixAxis axis, TransformFunc transf
  *  propagation.
  */
 Matrix forwardPropagate(Data data, NeuralNetwork nn, ActivationFunc activate);
+/** @brief Creates a buffer that can hold the resulting matrix 
+ *  of any of the layers of the Network.
+ * 
+ *  @param nn The Neural Network the buffer is for.
+ *  @return A matrix as big as the widest layer of the Network.
+ */
+Matrix createActivationBuffer(NeuralNetwork nn);
+/** @brief Forward propagates the data through the layers of the 
+ *  Network, without allocating any memory. 
+ * 
+ *  The layers alternate between writing into either of the two 
+ *  buffers, thus the resulting matrix is only valid until the 
+ *  buffers are reused.
+ * 
+ *  @param data The data to be propagated through the Neural Network.
+ *  @param nn The Neural Network which the data would be 
+ *  propagated through.
+ *  @param activate The activation function to activate the neurons 
+ *  in the Neural Network (sigmoid, reLU, tanh).
+ *  @param buffers Two buffers created by createActivationBuffer.
+ *  @return A view of the resulting matrix from the output layer, 
+ *  stored in one of the buffers.
+ */
+Matrix forwardPropagateInto(Data data, NeuralNetwork nn, ActivationFunc activate, Matrix buffers[2]);
+/** @brief Finds the built-in activation that an activation function 
+ *  computes, if any, which the vector kernels of the simd library run.
+ * 
+ *  @param activate The activation function.
+ *  @param activation A pointer to where the activation is stored.
+ *  @return 1 - If the function is sigmoid, reLU, or tanh. 0 - If it 
+ *  is not, where the activation is left as it is.
+ */
+int toActivation(ActivationFunc activate, Activation *activation);
+/** @brief Finds the activation that the fused kernel of the gemm
+ *  library applies on its own for an activation function.
+ * 
+ *  @param activate The activation function.
+ *  @return GEMM_RELU, GEMM_SIGMOID, or GEMM_TANH for the built-in
+ *  functions, else GEMM_CUSTOM, where the function is called on
+ *  each entry.
+ */
+GemmActivation toGemmActivation(ActivationFunc activate);
+/** @brief Feeds an input through a single dense layer, computing
+ *  the weighted sum, the bias, and the activation in one pass.
+ * 
+ *  The activations sigmoid, reLU, and tanh are applied by the 
+ *  fused kernel itself, while any other function is called on 
+ *  each entry as it is computed.
+ * 
+ *  @param input The activations of the previous layer.
+ *  @param layer The layer the input is fed through.
+ *  @param activate The activation function to activate the neurons 
+ *  of the layer (sigmoid, reLU, tanh).
+ *  @param orient The orientation of the nodes of the layer.
+ *  @param out The destination matrix, with one entry per node, 
+ *  which should not share entries with the input.
+ *  @return Void.
+ */
+void denseForwardInto(Matrix input, Layer layer, ActivationFunc activate, NodeOrientation orient, Matrix out);
+/** @brief Feeds a sparse input through a single dense layer, where
+ *  only the weights of the nonzero inputs are multiplied.
+ * 
+ *  @param input The nonzero inputs, as a single row.
+ *  @param layer The layer the input is fed through.
+ *  @param activate The activation function to activate the neurons 
+ *  of the layer (sigmoid, reLU, tanh).
+ *  @param orient The orientation of the nodes of the layer.
+ *  @param out The destination matrix, with one entry per node.
+ *  @return Void.
+ */
+void sparseForwardInto(SparseMatrix input, Layer layer, ActivationFunc activate, NodeOrientation orient, Matrix out);
 /** @brief Trains a Neural Network based on a given dataset.
+ *  
+ *  The samples are drawn in a new random order on every call, from 
+ *  the next generator of createShuffleRng, thus the orders only 
+ *  depend on the seed set with setRngSeed, and on the number of 
+ *  epochs trained since. The batches are split in that order, and 
+ *  the inputs of each batch are gathered from wherever its samples 
+ *  are in the dataset, which is never moved, stacked into a single 
+ *  matrix, one sample per row, and fed forward and backward through 
+ *  every layer as a whole. The gradients of the weights and the 
+ *  biases are computed with a single multiplication per layer, 
+ *  summed over the samples of the batch, and the parameters are 
+ *  updated by gradient descent on the sum of squared residuals after 
+ *  every batch. The samples past the last full batch are skipped, 
+ *  which are different ones on every call.
+ *  
+ *  Each batch is split into a shard per thread of the thread pool, 
+ *  of at least TRAIN_MIN_SHARD_SIZE samples, whose gradients are 
+ *  computed into buffers of their own, and summed pairwise in a fixed 
+ *  order before the update. Thus the result only depends on the number 
+ *  of threads, and not on which thread trained on which shard.
  *  
  *  @param nn The Neural Network to be trained.
  *  @param activate The activation function to activate the neurons 
- *  in the Neural Network (sigmoid, reLU, tanh).
+ *  in the Neural Network (sigmoid, reLU, tanh), whose derivative is
+ *  known, thus no other function is allowed.
  *  @param batchSize The size of each batch to be used for back propagation.
  *  @param dataset The dataset that the Neural Network has to learn.
  *  @param size The size of the dataset.
  *  @return Void. 
  */
 void networkTrain(NeuralNetwork nn, ActivationFunc activate, int batchSize, Data dataset[], int size);
+/** @brief Trains a Neural Network based on a given dataset, like
+ *  networkTrain, where the parameters are updated by an optimizer
+ *  after every batch, instead of by plain gradient descent.
+ *  
+ *  The state of the optimizer carries over between calls, thus the 
+ *  same optimizer should be passed for every epoch.
+ *  
+ *  @param nn The Neural Network to be trained.
+ *  @param activate The activation function to activate the neurons 
+ *  in the Neural Network (sigmoid, reLU, tanh).
+ *  @param batchSize The size of each batch to be used for back propagation.
+ *  @param dataset The dataset that the Neural Network has to learn.
+ *  @param size The size of the dataset.
+ *  @param optimizer A pointer to the optimizer, created for the 
+ *  Neural Network.
+ *  @return Void. 
+ */
+void networkTrainWithOptimizer(NeuralNetwork nn, ActivationFunc activate, int batchSize, Data dataset[], int size, Optimizer *optimizer);
+/** @brief Trains a Neural Network based on a given dataset, where
+ *  the threads train asynchronously, without locks (Hogwild).
+ *  
+ *  The samples are drawn in a new random order on every call, like 
+ *  networkTrain. Each thread of the thread pool takes the next batch 
+ *  that is left, computes its gradients against the parameters as 
+ *  they are, and applies them straight onto the shared parameters, 
+ *  while the other threads are reading and writing them. The weights of the first 
+ *  layer are only written for the inputs that are nonzero in a batch 
+ *  of sparse inputs, thus threads rarely write onto the same entries, 
+ *  and the updates they overwrite of each other are few. Thus the 
+ *  result is not reproducible on more than one thread.
+ *  
+ *  @param nn The Neural Network to be trained.
+ *  @param activate The activation function to activate the neurons 
+ *  in the Neural Network (sigmoid, reLU, tanh).
+ *  @param batchSize The size of the batch each thread trains on at once.
+ *  @param dataset The dataset that the Neural Network has to learn.
+ *  @param size The size of the dataset.
+ *  @param maxStaleness The most updates that other threads can apply
+ *  while a gradient is computed, past which it is computed again, 
+ *  or 0 for no bound.
+ *  @return The number of gradients that were computed again, since 
+ *  they were too stale.
+ */
+long networkTrainHogwild(NeuralNetwork nn, ActivationFunc activate, int batchSize, Data dataset[], int size, int maxStaleness);
 /** @brief Tests a Neural Network based on a given dataset.
  *  
  *  @param nn The Neural Network to be tested.
@@ -147,4 +300,16 @@ double tanhPrime(double val);
  *  @param size Size of the two arrays.
  *  @return A matrix.
  */
-Matrix ssrPrime(Matrix obs[], Matrix exp[], int size);
\ No newline at end of file
+Matrix ssrPrime(Matrix obs[], Matrix exp[], int size);
+/** @brief Derivative of Sum of Square residuals
+ *  of matrices, stored in a destination matrix instead of
+ *  allocating one.
+ * 
+ *  @param obs Array of observed Matrix values.
+ *  @param exp Array of expected Matrix values.
+ *  @param size Size of the two arrays.
+ *  @param out The destination matrix, with the same dimensions
+ *  as the observed values.
+ *  @return Void.
+ */
+void ssrPrimeInto(Matrix obs[], Matrix exp[], int size, Matrix out);
\ No newline at end of file
@@ -0,0 +1,110 @@
+/** @file model_file.h
+ *  @brief Function prototypes for the model file library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the model file library.
+ *
+ *  DEPENDENCIES: matrix, neural_net
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "matrix.h"
+#include "neural_net.h"
+
+/** @brief The version of the model files that are saved, which is
+ *  bumped whenever their layout changes.
+ */
+#define MODEL_FILE_VERSION 2
+
+/** @brief Structure of the header at the start of a model file.
+ *
+ *  The header is followed by the node sizes of each layer (int32),
+ *  and then by the parameters of the Neural Network, exactly as they
+ *  are laid out in memory, starting at an offset that is a multiple
+ *  of MATRIX_ALIGNMENT. Everything is stored in the byte order of the
+ *  machine that saved it.
+ */
+typedef struct ModelFileHeader {
+    // "MNISTNN" followed by a null character.
+    char magic[8];
+    uint32_t version;
+    // 0x01020304 as stored by the machine that saved the file.
+    uint32_t byteOrder;
+    // The size of an entry of the parameters (4 for float32, 8 for float64).
+    uint32_t realSize;
+    // The options of the Neural Network.
+    uint32_t nodeOrient;
+    uint32_t distStrat;
+    uint32_t layerCount;
+    double distSize;
+    double initialBias;
+    double lr;
+    // The seed that the weights of the layers added to it are drawn from.
+    uint64_t seed;
+    // The offset of the parameters from the start of the file.
+    uint64_t paramsOffset;
+    // The number of entries of the parameters.
+    uint64_t paramCount;
+    // The CRC-32C of the header (with this field as 0) and the node sizes.
+    uint32_t headerChecksum;
+    // The CRC-32C of the parameters.
+    uint32_t paramsChecksum;
+} ModelFileHeader;
+
+/** @brief Structure of a Neural Network that is mapped from a model file. */
+typedef struct MappedNeuralNet {
+    // The Neural Network, whose layer sizes and parameters view the file.
+    NeuralNetwork nn;
+    // The address, and size, of the mapping of the file.
+    void *addr;
+    size_t size;
+} MappedNeuralNet;
+
+/** @brief Saves a Neural Network into a model file.
+ *
+ *  The file is written under a temporary name first, and renamed
+ *  once it is complete, thus processes that map the file it replaces
+ *  never see a partly written one.
+ *
+ *  @param nn The Neural Network to be saved.
+ *  @param fileName The path of the model file.
+ *  @return Void.
+ */
+void saveNeuralNet(NeuralNetwork nn, const char *fileName);
+/** @brief Maps a model file into memory, and creates a Neural Network
+ *  whose layers point directly at the parameters in the mapping.
+ *
+ *  Nothing but the header is read when the file is mapped, thus the
+ *  parameters are only paged in as they are used, and processes that
+ *  map the same file share them through the page cache. The mapping
+ *  is private, thus training the Neural Network copies the pages it
+ *  writes to, and leaves the file as it is.
+ *
+ *  @param fileName The path of the model file.
+ *  @param verifyParams Whether the checksum of the parameters should
+ *  be verified as well, which reads every one of them. The header is
+ *  always verified.
+ *  @return The mapped Neural Network.
+ */
+MappedNeuralNet mapNeuralNet(const char *fileName, int verifyParams);
+/** @brief Frees a mapped Neural Network, and unmaps its model file.
+ *
+ *  @param model A pointer to the mapped Neural Network.
+ *  @return Void.
+ */
+void unmapNeuralNet(MappedNeuralNet *model);
+/** @brief Computes the CRC-32C (Castagnoli) checksum of a block of
+ *  memory, on the CRC32 instructions of SSE4.2 if the CPU supports
+ *  them.
+ *
+ *  @param crc The checksum of the blocks before this one, or 0.
+ *  @param data The block of memory.
+ *  @param size The size of the block in bytes.
+ *  @return The checksum of all the blocks so far.
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t size);
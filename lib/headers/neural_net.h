@@ -4,7 +4,7 @@
  *  This contains the prototypes, type definitions,
  *  constants, and globals for the nueral net library.
  *
- *  DEPENDENCIES: matrix, doubly_ll
+ *  DEPENDENCIES: matrix, rng
  *  
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No known bugs.
@@ -12,8 +12,8 @@
 
 #pragma once   
 
+#include <stdint.h>
 #include "matrix.h"
-#include "doubly_ll.h"
 
 /** @brief The different weight initialization strategies that can be utilized for the neural net.
  * https://towardsdatascience.com/weight-initialization-techniques-in-neural-networks-26c649eb3b78
@@ -22,8 +22,9 @@ typedef enum DistStrategy { RANDOM, ZERO, HE, XAVIER, HE_XAVIER } DistStrategy;
 /** @brief The different possible direction of traversing a Neural Network. */
 typedef enum TravDirection { FORWARD, BACKWARD } TravDirection;
 /** @brief Specifies the orientation of the nodes in the Neural Network.
- *  Row nodes lets the dataset take up less space and calculations becomes more performant.
- *  Column nodes are more semantic, and in-line with visualizations in the Internet.
+ *  Row nodes multiply the data by the weights, while column nodes multiply the weights by 
+ *  the data, which is more semantic, and in-line with visualizations in the Internet.
+ *  Both run at the same speed.
  */
 typedef MatrixAxis NodeOrientation;
 
@@ -53,14 +54,54 @@ typedef struct NeuralNetOpt {
     int *layerSizes;
     // The number of layers in the neural net.
     int neuralNetSize;
+    // The seed that the weights of each layer are drawn from,
+    // which defaults to the seed set with setRngSeed.
+    uint64_t seed;
 } NeuralNetOpt;
 
-/** @brief Stucture for the NeuralNetwork. */
+/** @brief Structure of the layers of a Neural Network, which are
+ *  stored back to back in a single array.
+ */
+typedef struct LayerArray {
+    // The layers, from the input layer down to the output layer.
+    Layer *items;
+    // The number of layers.
+    int size;
+    // The number of layers the array can hold before it is grown.
+    int capacity;
+} LayerArray;
+
+/** @brief Stucture for the NeuralNetwork. 
+ * 
+ *  The weights and biases of every layer are stored back to back in
+ *  a single buffer of parameters, where each matrix starts on an 
+ *  aligned address, and the gaps between them are zeroes. The weights
+ *  and biases of the layers are views into it, thus every parameter 
+ *  can be updated, copied, or reduced in a single sweep over it.
+ */
 typedef struct NeuralNetwork {
     NeuralNetOpt options;
-    DoublyLinkedList layers;
+    LayerArray layers;
+    // The parameters of every layer (1 x count), which the layers view.
+    Matrix params;
 } NeuralNetwork;
 
+/** @brief Structure of a traversal over the layers of a Neural 
+ *  Network, which is advanced by travNeuralNet. 
+ * 
+ *  Each iterator keeps its own position, thus a Neural Network
+ *  can be traversed from many threads at once. The layers should
+ *  not be added, inserted, or deleted while it is traversed.
+ */
+typedef struct LayerIterator {
+    // The layers being traversed.
+    Layer *items;
+    int size;
+    // The position of the layer returned last, where 0 is before the
+    // first one, and size + 1 is past the last one.
+    int pos;
+} LayerIterator;
+
 /** @brief Creates a Neural Network.
  *  
  *  @param opt Configured options in creating the
@@ -71,6 +112,37 @@ typedef struct NeuralNetwork {
  *  @return A Neural Network.
  */
 NeuralNetwork createNeuralNet(NeuralNetOpt opt);
+/** @brief Creates a copy of a Neural Network, with its own 
+ *  parameters, which are laid out the same way.
+ * 
+ *  @param nn The Neural Network to be copied.
+ *  @return A Neural Network, whose layers are views into 
+ *  its own parameters.
+ */
+NeuralNetwork copyNeuralNet(NeuralNetwork nn);
+/** @brief Creates a Neural Network whose layers view a buffer of
+ *  parameters, laid out the way createNeuralNet lays them out, 
+ *  instead of allocating and initializing their own.
+ * 
+ *  The layers can be trained in place, and adding, inserting, or 
+ *  deleting a layer moves the parameters into a buffer of their own.
+ *  The buffer is never freed by the Neural Network.
+ * 
+ *  @param opt The options the parameters were laid out with.
+ *  @param params The parameters (1 x getParamCount(opt)), whose 
+ *  entries should be aligned to MATRIX_ALIGNMENT.
+ *  @return A Neural Network, whose layers are views into params.
+ */
+NeuralNetwork viewNeuralNet(NeuralNetOpt opt, Matrix params);
+/** @brief Counts the entries of the buffer of parameters of a Neural
+ *  Network created with the given options, including the padding 
+ *  between its matrices.
+ * 
+ *  @param opt The options used for the creation of the 
+ *  Neural Network.
+ *  @return The number of entries.
+ */
+long getParamCount(NeuralNetOpt opt);
 /** @brief Gets the default options used for creating
  *  a neural network.
  * 
@@ -96,6 +168,9 @@ Matrix createEmptyWeights(int nodes, int prevNodes, NeuralNetOpt opt);
  */
 Matrix createEmptyBias(int nodes, NeuralNetOpt opt);
 /** @brief Appends a layer to the Neural Network.
+ * 
+ *  The parameters are laid out again to make room for the layer,
+ *  and the other layers keep their weights and biases.
  *  
  *  @param nn A pointer to the Neural Network where 
  *  the layer would be attached to.
@@ -103,8 +178,11 @@ Matrix createEmptyBias(int nodes, NeuralNetOpt opt);
  *  @return Void.
  */
 void addLayer(NeuralNetwork *nn, int nodes);
-/** @brief Removes a layer from the Neural Network,
- *  based on a given position.
+/** @brief Inserts a layer into the Neural Network,
+ *  at a given position.
+ * 
+ *  The layer after it is initialized again, since the
+ *  number of its inputs changes.
  * 
  *  @param nn A pointer to the Neural Network where 
  *  the layer would be attached to.
@@ -117,6 +195,9 @@ void insertLayer(NeuralNetwork *nn, int pos, int nodes);
 /** @brief Deletes a layer from the Neural Network,
  *  based on a given position.
  * 
+ *  The layer that takes its position is initialized again, 
+ *  since the number of its inputs changes.
+ * 
  *  @param nn A pointer to the Neural Network where 
  *  the layer would be attached to.
  *  @param pos The position of the layer in the
@@ -124,25 +205,34 @@ void insertLayer(NeuralNetwork *nn, int pos, int nodes);
  *  @return Void. 
  */
 void deleteLayer(NeuralNetwork *nn, int pos);
+/** @brief Creates an iterator over the layers of a Neural Network,
+ *  which starts on the side the traversal goes from.
+ * 
+ *  @param nn A pointer to the Neural Network to be traversed.
+ *  @param dir The direction the traversal starts in, where FORWARD 
+ *  starts before the input layer, and BACKWARD past the output layer.
+ *  @return An iterator that has not returned a layer yet.
+ */
+LayerIterator iterNeuralNet(const NeuralNetwork *nn, TravDirection dir);
 /** @brief Traverses a neural network in a given direction
  *  while returning the layer contained in each traversal.
  * 
- *  Only the first call of this function should the pointer to 
- *  the Neural Network be passed. Succeeding calls should have
- *  a NULL passed to nn, since it would reset the traversal back
- *  to the start. 
+ *  The direction may change between calls, e.g. an iterator
+ *  that went forward up to the output layer can go backward 
+ *  from there.
  * 
  *  @example
- *  travNeuralNet(&nn, FORWARD);
- *  travNeuralNet(&nn, BACKWARD); 
+ *  LayerIterator it = iterNeuralNet(&nn, FORWARD);
+ *  while((layer = travNeuralNet(&it, FORWARD))) { ... }
  *  
- *  @param nn A pointer to the Neural Network to be traversed. 
+ *  @param it A pointer to the iterator over the Neural Network. 
  *  @param dir The direction of traversal. 
  *  @return A pointer to the layer contained in the current 
  *  position of the traversal, else NULL is returned
  */
-Layer *travNeuralNet(NeuralNetwork *nn, TravDirection dir);
-/** @brief Gets the layer of a Neural Network on a given position.
+Layer *travNeuralNet(LayerIterator *it, TravDirection dir);
+/** @brief Gets the layer of a Neural Network on a given position,
+ *  in constant time.
  * 
  *  @param nn The Neural Network where the layer is a part of.
  *  @param pos The position of the layer in the Neural Network 
@@ -150,6 +240,18 @@ Layer *travNeuralNet(NeuralNetwork *nn, TravDirection dir);
  *  @return The layer. 
  */
 Layer getLayer(NeuralNetwork nn, int pos);
+/** @brief Gets the layer of a Neural Network on a given position,
+ *  with its weights and bias viewing a buffer laid out like the 
+ *  parameters of the Neural Network (e.g., their gradients), 
+ *  instead of the parameters themselves.
+ * 
+ *  @param nn The Neural Network where the layer is a part of.
+ *  @param params The buffer (1 x nn.params.col) to be viewed.
+ *  @param pos The position of the layer in the Neural Network 
+ *  (starting at 1).
+ *  @return The layer, whose weights and bias are views into params. 
+ */
+Layer viewLayerParams(NeuralNetwork nn, Matrix params, int pos);
 /** @brief Frees the Neural Network from memory.
  * 
  *  @param nn A pointer to the Neural Network to be freed. 
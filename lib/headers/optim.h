@@ -0,0 +1,97 @@
+/** @file optim.h
+ *  @brief Function prototypes for the optimizer library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the optimizer library.
+ *
+ *  DEPENDENCIES: simd, thread_pool, matrix, neural_net
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include "matrix.h"
+#include "neural_net.h"
+
+/** @brief The entries of the parameters that each task of a threaded
+ *  step updates, thus smaller networks are updated on a single thread.
+ */
+#define OPTIM_CHUNK_SIZE 32768
+
+/** @brief The rules that the parameters are updated by. */
+typedef enum OptimizerType {
+    // Plain gradient descent.
+    SGD,
+    // Gradient descent with momentum.
+    MOMENTUM,
+    // Nesterov's accelerated gradient.
+    NESTEROV,
+    // Adaptive moment estimation.
+    ADAM
+} OptimizerType;
+
+/** @brief Structure of an optimizer, whose state is kept in buffers
+ *  laid out like the parameters of the Neural Network it was created
+ *  for, thus the whole network is updated in a single pass.
+ */
+typedef struct Optimizer {
+    // The rule that the parameters are updated by.
+    OptimizerType type;
+    // The learning rate, which defaults to that of the Neural Network.
+    double lr;
+    // The decay of the velocity, or the first moment for Adam.
+    double momentum;
+    // The decay of the second moment for Adam.
+    double beta2;
+    // The term that guards the division of Adam.
+    double epsilon;
+    // The number of steps taken so far.
+    long steps;
+    // The velocity of the parameters, or the first moment of their
+    // gradients for Adam, or a zero matrix for SGD.
+    Matrix velocity;
+    // The second moment of the gradients for Adam, or a zero matrix.
+    Matrix variance;
+} Optimizer;
+
+/** @brief Creates an optimizer for the parameters of a Neural Network,
+ *  whose state starts at zero.
+ *
+ *  The momentum defaults to 0.9, the decay of the second moment to
+ *  0.999, and epsilon to 1e-8, which can be changed before the first
+ *  step.
+ *
+ *  @param type The rule that the parameters are updated by.
+ *  @param nn The Neural Network whose parameters are to be updated.
+ *  @return An optimizer.
+ */
+Optimizer createOptimizer(OptimizerType type, NeuralNetwork nn);
+/** @brief Takes a step on the parameters of a Neural Network against
+ *  their gradients.
+ *
+ *  The state and the parameters are updated together in a single pass
+ *  by the fused kernels of the simd library. Parameters of more than
+ *  OPTIM_CHUNK_SIZE entries are split into chunks across the threads of
+ *  the thread pool, and since every entry is updated on its own, the
+ *  result does not depend on the number of threads.
+ *
+ *  @param optimizer A pointer to the optimizer.
+ *  @param params The parameters, laid out like those of the Neural
+ *  Network the optimizer was created for, i.e. nn.params.
+ *  @param grad The gradients of the parameters, laid out the same.
+ *  @return Void.
+ */
+void optimizerStep(Optimizer *optimizer, Matrix params, Matrix grad);
+/** @brief Resets the state of an optimizer, as if no step was taken.
+ *
+ *  @param optimizer A pointer to the optimizer.
+ *  @return Void.
+ */
+void resetOptimizer(Optimizer *optimizer);
+/** @brief Frees the state of an optimizer from memory.
+ *
+ *  @param optimizer A pointer to the optimizer.
+ *  @return Void.
+ */
+void freeOptimizer(Optimizer *optimizer);
@@ -0,0 +1,153 @@
+/** @file prune.h
+ *  @brief Function prototypes for the prune library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the pruning library.
+ *
+ *  DEPENDENCIES: rng, matrix, sparse, neural_net, ml
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include "matrix.h"
+#include "sparse.h"
+#include "neural_net.h"
+#include "ml.h"
+
+/** @brief The largest fraction of nonzero weights that a layer is
+ *  compressed at, past which it is kept dense, since the index of
+ *  each weight would then cost more than skipping the zeroes saves.
+ */
+#define PRUNE_MAX_DENSITY 0.5
+
+/** @brief Structure of a Layer of a pruned Neural Network. */
+typedef struct PrunedLayer {
+    // The nodes of the previous layer.
+    int inputs;
+    int nodes;
+    // The nonzero weights of each input, one input per row, or empty
+    // if the layer is kept dense.
+    SparseMatrix weights;
+    // The copy of the layer, whose weights are a zero matrix if it
+    // is compressed, and whose bias is always kept.
+    Layer layer;
+} PrunedLayer;
+
+/** @brief Structure of a pruned Neural Network compiled for inference. */
+typedef struct PrunedNetwork {
+    // The layers, starting from the first hidden layer.
+    PrunedLayer *layers;
+    // The number of layers.
+    int size;
+    // The activation function the Neural Network was trained with.
+    ActivationFunc activate;
+    // The orientation of the nodes of the Neural Network.
+    NodeOrientation nodeOrient;
+} PrunedNetwork;
+
+/** @brief Zeroes the weights of a layer with the smallest magnitudes.
+ *
+ *  Every weight whose magnitude is below the threshold is zeroed,
+ *  and then the smallest of the rest, until at least the target
+ *  fraction of the weights are zero.
+ *
+ *  @param layer The layer, whose weights are pruned in place.
+ *  @param threshold The magnitude below which weights are zeroed,
+ *  or 0 for none.
+ *  @param sparsity The fraction of the weights that should be zero,
+ *  within [0, 1], or 0 to prune by the threshold alone.
+ *  @return The number of weights of the layer that are zero.
+ */
+long pruneLayer(Layer layer, double threshold, double sparsity);
+/** @brief Prunes the weights of every layer of a Neural Network.
+ *
+ *  @param nn The Neural Network, whose weights are pruned in place.
+ *  @param threshold The magnitude below which weights are zeroed,
+ *  or 0 for none.
+ *  @param sparsities The fraction of the weights of each layer that
+ *  should be zero, starting from the first hidden layer, or NULL to
+ *  prune by the threshold alone.
+ *  @return Void.
+ */
+void pruneNeuralNet(NeuralNetwork nn, double threshold, const double sparsities[]);
+/** @brief Returns the fraction of the weights of a layer that are zero.
+ *
+ *  @param layer The layer.
+ *  @return The sparsity, within [0, 1].
+ */
+double getLayerSparsity(Layer layer);
+/** @brief Trains a pruned Neural Network, such that the weights that
+ *  were pruned stay zero.
+ *
+ *  Every round draws a new random order of the samples from the next
+ *  generator of createShuffleRng, and the batches gathered in that
+ *  order are fed to networkTrain one at a time. The weights that were
+ *  zero before fine-tuning are zeroed again after every batch, thus
+ *  only the weights that were kept are trained.
+ *
+ *  @param nn The pruned Neural Network to be trained.
+ *  @param activate The activation function the Neural Network was
+ *  trained with (sigmoid, reLU, tanh).
+ *  @param batchSize The number of data per batch.
+ *  @param dataset The dataset to train the Network on.
+ *  @param size The size of the dataset.
+ *  @param rounds The number of times the dataset is trained on.
+ *  @return Void.
+ */
+void fineTunePrunedNet(NeuralNetwork nn, ActivationFunc activate, int batchSize, Data dataset[], int size, int rounds);
+/** @brief Compiles a pruned Neural Network for inference.
+ *
+ *  The weights of each layer with at most PRUNE_MAX_DENSITY of them
+ *  nonzero are compressed, and only the nonzero weights of the inputs
+ *  that are not zero are multiplied, e.g. the pixels that are not
+ *  blank for the first layer. Denser layers are copied as they are.
+ *
+ *  @param nn The pruned Neural Network, which is copied, thus it
+ *  can be freed after.
+ *  @param activate The activation function the Neural Network was
+ *  trained with (sigmoid, reLU, tanh).
+ *  @return The pruned Neural Network.
+ */
+PrunedNetwork createPrunedNet(NeuralNetwork nn, ActivationFunc activate);
+/** @brief Creates a matrix big enough for the results of any layer
+ *  of a pruned Network, for a single input.
+ *
+ *  @param pnn The pruned Neural Network.
+ *  @return A matrix for the results of the widest layer.
+ */
+Matrix createPrunedBuffer(PrunedNetwork pnn);
+/** @brief Forward propagates the data through the layers of the
+ *  pruned Network.
+ *
+ *  @param data The data to be propagated through the Network.
+ *  @param pnn The pruned Neural Network.
+ *  @param buffers Two matrices created by createPrunedBuffer, which
+ *  the layers alternate between writing into.
+ *  @return A view of the resulting matrix from the output layer,
+ *  stored in one of the buffers.
+ */
+Matrix prunedForwardPropagateInto(Data data, PrunedNetwork pnn, Matrix buffers[2]);
+/** @brief Tests a pruned Neural Network based on a given dataset.
+ *
+ *  @param pnn The pruned Neural Network to be tested.
+ *  @param dataset The dataset that the Network has to test against.
+ *  @param size The size of the dataset.
+ *  @return The accuracy of the pruned Network's prediction
+ *  in decimal.
+ */
+double prunedNetworkTest(PrunedNetwork pnn, Data dataset[], int size);
+/** @brief Returns the number of bytes the parameters of the pruned
+ *  Network take up.
+ *
+ *  @param pnn The pruned Neural Network.
+ *  @return The size of its weights, indices, and biases in bytes.
+ */
+long getPrunedNetBytes(PrunedNetwork pnn);
+/** @brief Frees the pruned Neural Network from memory.
+ *
+ *  @param pnn A pointer to the pruned Neural Network to be freed.
+ *  @return Void.
+ */
+void freePrunedNet(PrunedNetwork *pnn);
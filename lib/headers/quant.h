@@ -0,0 +1,159 @@
+/** @file quant.h
+ *  @brief Function prototypes for the quant library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the quantization library.
+ *
+ *  DEPENDENCIES: simd, matrix, neural_net, ml
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "matrix.h"
+#include "neural_net.h"
+#include "ml.h"
+
+/** @brief The number of weights that the weights of each node are
+ *  padded to a multiple of, so that the kernels need no remainder loop.
+ */
+#define QUANT_ALIGNMENT 64
+
+/** @brief The granularity of the scales the weights are quantized with. */
+typedef enum QuantGranularity { PER_LAYER, PER_CHANNEL } QuantGranularity;
+
+/** @brief Structure of a Layer whose weights are quantized to int8,
+ *  and whose inputs are quantized to uint8.
+ *
+ *  An input is represented as inputScale * (q - inputZero), and a
+ *  weight of a node as scales[node] * q.
+ */
+typedef struct QuantLayer {
+    // The nodes of the previous layer.
+    int inputs;
+    int nodes;
+    // Distance (in weights) between the weights of two adjacent nodes,
+    // padded to a multiple of QUANT_ALIGNMENT with zeros.
+    int stride;
+    // The weights of each node, stored one node after another.
+    int8_t *weights;
+    // The scale of the weights of each node. Every node shares the
+    // same scale if quantized per layer.
+    float *scales;
+    // The sum of the weights of each node, which cancels out the
+    // zero point of the inputs.
+    int32_t *weightSums;
+    // The biases of the layer, kept in full precision.
+    Real *bias;
+    // The scale, and zero point of the inputs, which are calibrated
+    // on the range the inputs took on the calibration set.
+    float inputScale;
+    int inputZero;
+} QuantLayer;
+
+/** @brief Structure of a Neural Network quantized for inference. */
+typedef struct QuantizedNetwork {
+    // The quantized layers, starting from the first hidden layer.
+    QuantLayer *layers;
+    // The number of quantized layers.
+    int size;
+    // The activation function the Neural Network was trained with.
+    ActivationFunc activate;
+    // The orientation of the nodes of the Neural Network.
+    NodeOrientation nodeOrient;
+} QuantizedNetwork;
+
+/** @brief The scratch memory of quantized inference. */
+typedef struct QuantBuffers {
+    // The quantized inputs of the current layer.
+    uint8_t *inputs;
+    // The integer sums of the current layer.
+    int32_t *sums;
+    // The resulting matrix from the output layer.
+    Matrix out;
+} QuantBuffers;
+
+/** @brief Quantizes a trained Neural Network to int8 weights.
+ *
+ *  The calibration set is forward propagated through the Network,
+ *  to find the range of the inputs of each layer, which their
+ *  scale and zero point are fitted to.
+ *
+ *  @param nn The Neural Network to be quantized.
+ *  @param activate The activation function the Neural Network was
+ *  trained with (sigmoid, reLU, tanh).
+ *  @param granularity Whether each node gets its own scale, or the
+ *  nodes of a layer share one.
+ *  @param calibration A slice of the training set, which should
+ *  be prepared the same way as the data the Network is fed.
+ *  @param size The size of the calibration set.
+ *  @return The quantized Neural Network.
+ */
+QuantizedNetwork quantizeNeuralNet(NeuralNetwork nn, ActivationFunc activate, QuantGranularity granularity, Data calibration[], int size);
+/** @brief Creates the buffers that quantized inference works in.
+ *
+ *  @param qnn The quantized Neural Network the buffers are for.
+ *  @return The buffers.
+ */
+QuantBuffers createQuantBuffers(QuantizedNetwork qnn);
+/** @brief Forward propagates the data through the layers of the
+ *  quantized Network, with integer kernels.
+ *
+ *  Each layer multiplies its uint8 inputs with its int8 weights
+ *  into int32 sums, which are dequantized, added to the biases,
+ *  activated, and requantized as the inputs of the next layer.
+ *
+ *  @param data The data to be propagated through the Network.
+ *  @param qnn The quantized Neural Network.
+ *  @param buffers The buffers created by createQuantBuffers.
+ *  @return A view of the resulting matrix from the output layer,
+ *  stored in the buffers.
+ */
+Matrix quantizedForwardPropagateInto(Data data, QuantizedNetwork qnn, QuantBuffers buffers);
+/** @brief Tests a quantized Neural Network based on a given dataset.
+ *
+ *  @param qnn The quantized Neural Network to be tested.
+ *  @param dataset The dataset that the Network has to test against.
+ *  @param size The size of the dataset.
+ *  @return The accuracy of the quantized Network's prediction
+ *  in decimal.
+ */
+double quantizedNetworkTest(QuantizedNetwork qnn, Data dataset[], int size);
+/** @brief Returns the number of bytes the parameters of the
+ *  quantized Network take up.
+ *
+ *  @param qnn The quantized Neural Network.
+ *  @return The size of its weights, scales, and biases in bytes.
+ */
+long getQuantizedNetBytes(QuantizedNetwork qnn);
+/** @brief Frees the buffers of quantized inference.
+ *
+ *  @param buffers A pointer to the buffers to be freed.
+ *  @return Void.
+ */
+void freeQuantBuffers(QuantBuffers *buffers);
+/** @brief Frees the quantized Neural Network from memory.
+ *
+ *  @param qnn A pointer to the quantized Neural Network to be freed.
+ *  @return Void.
+ */
+void freeQuantizedNet(QuantizedNetwork *qnn);
+
+/** @brief Multiplies uint8 inputs with the int8 weights of each node,
+ *  and accumulates the products into int32 sums.
+ *
+ *  Runs on AVX-512 VNNI, AVX-VNNI, or AVX2 if the selected instruction
+ *  set of the simd library allows it, and on scalar code otherwise.
+ *
+ *  @param nodes The number of nodes.
+ *  @param stride The number of inputs, and the distance between the
+ *  weights of two adjacent nodes, which should be a multiple of
+ *  QUANT_ALIGNMENT.
+ *  @param inputs The quantized inputs.
+ *  @param weights The quantized weights, one node after another.
+ *  @param sums The destination of the sum of each node.
+ *  @return Void.
+ */
+void int8Gemv(int nodes, int stride, const uint8_t *inputs, const int8_t *weights, int32_t *sums);
@@ -0,0 +1,25 @@
+/** @file real.h
+ *  @brief The element type of the libraries.
+ *
+ *  This contains the type that the entries of matrices,
+ *  layers, and data are stored as. It is double by default,
+ *  and float when compiled with REAL_FLOAT32 defined, which
+ *  halves the memory traffic and doubles the number of entries
+ *  per vector register.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#ifdef REAL_FLOAT32
+/** @brief The element type, a single-precision float. */
+typedef float Real;
+/** @brief The name of the element type. */
+#define REAL_NAME "float32"
+#else
+/** @brief The element type, a double-precision float. */
+typedef double Real;
+/** @brief The name of the element type. */
+#define REAL_NAME "float64"
+#endif
@@ -0,0 +1,149 @@
+/** @file rng.h
+ *  @brief Function prototypes for the random number generator library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the random number generator library.
+ *
+ *  DEPENDENCIES: simd
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "real.h"
+
+/** @brief The seed that every generator is derived from, until
+ *  another one is set with setRngSeed.
+ */
+#define RNG_DEFAULT_SEED 0x5eedULL
+
+/** @brief The streams of the generators, which never overlap for
+ *  the same seed. Each takes an id, e.g. the position of the layer
+ *  whose weights are initialized, or the index of a task of a
+ *  parallel loop.
+ */
+#define RNG_WEIGHTS_STREAM(id) ((1ULL << 32) | (uint32_t) (id))
+#define RNG_SHUFFLE_STREAM(id) ((2ULL << 32) | (uint32_t) (id))
+#define RNG_TASK_STREAM(id) ((3ULL << 32) | (uint32_t) (id))
+#define RNG_THREAD_STREAM(id) ((4ULL << 32) | (uint32_t) (id))
+
+/** @brief Structure of a counter-based random number generator
+ *  (Philox4x32-10).
+ *
+ *  Each block of four random words is a function of the seed, the
+ *  stream, and the index of the block alone, thus any number of
+ *  generators can draw from their own streams at once, and blocks
+ *  are generated in bulk without any state carried between them.
+ */
+typedef struct Rng {
+    // The seed, as the two words of the key.
+    uint32_t key[2];
+    // The stream, and the index of the next block of the stream.
+    uint64_t stream;
+    uint64_t block;
+    // The words of the last block, of which the ones from used on
+    // have not been drawn yet.
+    uint32_t words[4];
+    int used;
+} Rng;
+
+/** @brief Creates a generator at the start of a stream.
+ *
+ *  @param seed The seed.
+ *  @param stream The stream, e.g. RNG_WEIGHTS_STREAM(pos).
+ *  @return A generator.
+ */
+Rng createRng(uint64_t seed, uint64_t stream);
+/** @brief Sets the seed that the generators of each thread, and
+ *  the default options of Neural Networks, are derived from.
+ *
+ *  The generator of each thread starts over on its next use, where
+ *  the threads get their streams in the order they first use one,
+ *  and the shuffles start over from the first shuffle stream.
+ *
+ *  @param seed The seed.
+ *  @return Void.
+ */
+void setRngSeed(uint64_t seed);
+/** @brief Returns the seed set with setRngSeed.
+ *
+ *  @return The seed, or RNG_DEFAULT_SEED if none was set.
+ */
+uint64_t getRngSeed();
+/** @brief Returns the generator of the calling thread, which is
+ *  derived from the seed set with setRngSeed.
+ *
+ *  Threads get their streams in the order that they first call this,
+ *  thus results are only reproducible from a single thread. Parallel
+ *  loops should create a generator per task with RNG_TASK_STREAM.
+ *
+ *  @return A pointer to the generator of the calling thread.
+ */
+Rng *getThreadRng();
+/** @brief Creates the generator of the next shuffle, e.g. of the
+ *  samples of an epoch, derived from the seed set with setRngSeed.
+ *
+ *  Each call gets the next shuffle stream, counted from the last
+ *  call to setRngSeed, thus the shuffles only depend on the seed and
+ *  on how many were drawn before them, and not on the other numbers
+ *  drawn, nor on which thread draws them.
+ *
+ *  @return A generator at the start of its stream.
+ */
+Rng createShuffleRng();
+/** @brief Draws the next random word of a generator.
+ *
+ *  @param rng A pointer to the generator.
+ *  @return A random integer within [0, 2^32).
+ */
+uint32_t rngNext(Rng *rng);
+/** @brief Draws a uniformly distributed random number.
+ *
+ *  @param rng A pointer to the generator.
+ *  @return A random number within (0, 1).
+ */
+double rngUniform(Rng *rng);
+/** @brief Draws a uniformly distributed random integer, without
+ *  the bias of taking the remainder of a random word.
+ *
+ *  @param rng A pointer to the generator.
+ *  @param n The number of integers to choose from.
+ *  @return A random integer within [0, n).
+ */
+int rngBelow(Rng *rng, int n);
+/** @brief Fills an array with uniformly distributed random numbers.
+ *
+ *  The blocks of the generator are generated in bulk on the vector
+ *  kernels of the selected instruction set of the simd library, which
+ *  draw the same numbers as drawing them one at a time would.
+ *
+ *  @param rng A pointer to the generator.
+ *  @param arr The destination array.
+ *  @param size The size of the array.
+ *  @param min The lower bound of the numbers.
+ *  @param max The upper bound of the numbers.
+ *  @return Void.
+ */
+void rngUniformArr(Rng *rng, Real arr[], long size, double min, double max);
+/** @brief Fills an array with normally distributed random numbers,
+ *  with the Box-Muller transform of bulk uniform numbers.
+ *
+ *  @param rng A pointer to the generator.
+ *  @param arr The destination array.
+ *  @param size The size of the array.
+ *  @param mean The mean of the numbers.
+ *  @param stddev The standard deviation of the numbers.
+ *  @return Void.
+ */
+void rngNormalArr(Rng *rng, Real arr[], long size, double mean, double stddev);
+/** @brief Shuffles an array of integers, such that every order is
+ *  equally likely (Fisher-Yates).
+ *
+ *  @param rng A pointer to the generator.
+ *  @param arr The array to be shuffled in place.
+ *  @param size The size of the array.
+ *  @return Void.
+ */
+void rngShuffle(Rng *rng, int arr[], int size);
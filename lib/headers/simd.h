@@ -0,0 +1,189 @@
+/** @file simd.h
+ *  @brief Function prototypes for the simd library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the simd library.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include "real.h"
+
+/** @brief The instruction sets that the vector kernels are implemented in,
+ *  from the most portable to the widest.
+ */
+typedef enum SimdIsa { SCALAR, SSE2, AVX2, AVX512 } SimdIsa;
+
+/** @brief The activations that the vector kernels implement. */
+typedef enum Activation { IDENTITY, RELU, SIGMOID, TANH } Activation;
+
+/** @brief Returns the instruction set that the vector kernels run on.
+ *
+ *  On the first call, the widest instruction set supported by
+ *  the CPU (and enabled by the OS) is detected and selected.
+ *
+ *  @return The selected instruction set.
+ */
+SimdIsa getSimdIsa();
+/** @brief Overrides the instruction set that the vector kernels run on,
+ *  which is useful for benchmarking or testing a narrower instruction set.
+ *
+ *  @param isa The instruction set to be used, which should be supported.
+ *  @return Void.
+ */
+void setSimdIsa(SimdIsa isa);
+/** @brief Checks if an instruction set can be run on the CPU.
+ *
+ *  @param isa The instruction set to be checked.
+ *  @return 1 - If the instruction set is supported. 0 - If it is not.
+ */
+int isSimdIsaSupported(SimdIsa isa);
+/** @brief Returns the name of an instruction set.
+ *
+ *  @param isa The instruction set.
+ *  @return The name of the instruction set.
+ */
+const char *getSimdIsaName(SimdIsa isa);
+
+/** @brief Adds two arrays together, out = a + b.
+ *
+ *  @param a Addend array.
+ *  @param b Addend array.
+ *  @param out The destination array, which may be one of the operands.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecAdd(const Real *a, const Real *b, Real *out, int size);
+/** @brief Subtracts two arrays, out = min - sub.
+ *
+ *  @param min Minuend array.
+ *  @param sub Subtrahend array.
+ *  @param out The destination array, which may be one of the operands.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecSubtract(const Real *min, const Real *sub, Real *out, int size);
+/** @brief Scales the values of an array, out = val * a.
+ *
+ *  @param a The array to be scaled.
+ *  @param val The factor the array should be scaled by.
+ *  @param out The destination array, which may be the scaled array.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecScale(const Real *a, Real val, Real *out, int size);
+/** @brief Multiplies two arrays entry by entry, out = a * b.
+ *
+ *  @param a Factor array.
+ *  @param b Factor array.
+ *  @param out The destination array, which may be one of the operands.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecMultiply(const Real *a, const Real *b, Real *out, int size);
+/** @brief Accumulates a scaled array onto another array,
+ *  y = alpha * x + y.
+ *
+ *  @param alpha The factor x is scaled by.
+ *  @param x The array to be accumulated.
+ *  @param y The array accumulated onto.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecAxpy(Real alpha, const Real *x, Real *y, int size);
+/** @brief Fills an array with a value.
+ *
+ *  @param out The array to be filled.
+ *  @param val The value to fill the array with.
+ *  @param size The size of the array.
+ *  @return Void.
+ */
+void vecFill(Real *out, Real val, int size);
+/** @brief Takes a step of gradient descent with momentum on an array
+ *  of parameters, in a single pass over the arrays,
+ *  velocity = momentum * velocity + grad, and
+ *  params -= lr * velocity, or for Nesterov,
+ *  params -= lr * (grad + momentum * velocity).
+ *
+ *  @param params The parameters to be updated.
+ *  @param grad The gradients of the parameters.
+ *  @param velocity The velocity of the parameters, which is updated.
+ *  @param lr The learning rate.
+ *  @param momentum The decay of the velocity.
+ *  @param nesterov Non-zero for Nesterov's accelerated gradient.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecMomentumStep(Real *params, const Real *grad, Real *velocity, Real lr, Real momentum, int nesterov, int size);
+/** @brief Takes a step of Adam on an array of parameters, in a single
+ *  pass over the arrays,
+ *  mean = beta1 * mean + (1 - beta1) * grad,
+ *  variance = beta2 * variance + (1 - beta2) * grad^2, and
+ *  params -= stepSize * mean / (sqrt(variance) + epsilon).
+ *
+ *  The bias corrections of the moments are folded into the step size
+ *  and epsilon by the caller, as they are the same for every parameter.
+ *
+ *  @param params The parameters to be updated.
+ *  @param grad The gradients of the parameters.
+ *  @param mean The first moment of the gradients, which is updated.
+ *  @param variance The second moment of the gradients, which is updated.
+ *  @param beta1 The decay of the first moment.
+ *  @param beta2 The decay of the second moment.
+ *  @param stepSize The bias corrected learning rate.
+ *  @param epsilon The bias corrected term that guards the division.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecAdamStep(Real *params, const Real *grad, Real *mean, Real *variance, Real beta1, Real beta2, Real stepSize, Real epsilon, int size);
+/** @brief Computes the exponential of the values of an array,
+ *  out = exp(a), with a fast polynomial approximation.
+ *
+ *  The argument is reduced to r = a - n ln2 with |r| <= ln2 / 2,
+ *  exp(r) is evaluated as a Taylor polynomial (degree 13 for double,
+ *  and 6 for float) by Estrin's scheme, and scaled by 2^n through the
+ *  exponent bits. The relative error against libm is below 5e-16 for
+ *  double, and 3e-7 for float (2 to 3 units in the last place), for every input
+ *  whose exponential is a normal number. Inputs past that range are
+ *  clamped, thus they never overflow into infinity, nor underflow
+ *  into subnormals.
+ *
+ *  @param a The array of exponents.
+ *  @param out The destination array, which may be the exponents.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecExp(const Real *a, Real *out, int size);
+/** @brief Applies an activation to the values of an array,
+ *  out = activation(a).
+ *
+ *  Sigmoid and tanh are built on top of vecExp. Sigmoid has a
+ *  relative error below 1e-15 for double, and 4e-7 for float, while
+ *  tanh, computed as 1 - 2 / (exp(2a) + 1), has an absolute error 
+ *  below 1e-15 for double, and 4e-7 for float. ReLU is exact.
+ *
+ *  @param activation The activation (IDENTITY, RELU, SIGMOID, TANH).
+ *  @param a The array to be activated.
+ *  @param out The destination array, which may be the activated array.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecActivate(Activation activation, const Real *a, Real *out, int size);
+/** @brief Applies the derivative of an activation to the values of
+ *  an array, out = activation'(a).
+ *
+ *  The derivatives are taken with respect to the values before
+ *  they are activated. The one of sigmoid has a relative error
+ *  below 1e-15 for double, and 5e-7 for float, which stays relative
+ *  even for large values, while the one of tanh has an absolute
+ *  error below 1e-15 for double, and 4e-7 for float.
+ *
+ *  @param activation The activation (IDENTITY, RELU, SIGMOID, TANH).
+ *  @param a The array of values before activation.
+ *  @param out The destination array, which may be the given array.
+ *  @param size The size of the arrays.
+ *  @return Void.
+ */
+void vecActivatePrime(Activation activation, const Real *a, Real *out, int size);
@@ -0,0 +1,122 @@
+/** @file sparse.h
+ *  @brief Function prototypes for the sparse matrix library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the sparse matrix library.
+ *
+ *  DEPENDENCIES: simd, matrix
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+#include "real.h"
+#include "matrix.h"
+
+/** @brief Structure of a matrix that only stores its nonzero entries,
+ *  in the compressed sparse row (CSR) format.
+ *
+ *  The nonzero entries of each row are stored one row after another,
+ *  along with the columns they are at. A zeroed sparse matrix is empty.
+ */
+typedef struct SparseMatrix {
+    int row;
+    int col;
+    // The number of nonzero entries.
+    int nnz;
+    // The nonzero entries of a row r are at [rowStarts[r], rowStarts[r + 1]),
+    // thus there are row + 1 of them.
+    int *rowStarts;
+    // The column of each nonzero entry.
+    int *colIndices;
+    // The value of each nonzero entry.
+    Real *values;
+} SparseMatrix;
+
+/** @brief Creates a sparse matrix out of the nonzero entries of a
+ *  dense matrix.
+ *
+ *  @param m The dense matrix.
+ *  @return A SparseMatrix with the dimensions of m.
+ */
+SparseMatrix createSparseMatrix(Matrix m);
+/** @brief Checks if a sparse matrix holds a matrix, rather than
+ *  being empty.
+ *
+ *  @param s The sparse matrix to be checked.
+ *  @return 1 - If it is not empty. 0 - If it is.
+ */
+int isSparseMatrix(SparseMatrix s);
+/** @brief Returns the fraction of the entries of a sparse matrix
+ *  that are nonzero.
+ *
+ *  @param s The sparse matrix.
+ *  @return The density, within [0, 1].
+ */
+double getSparseDensity(SparseMatrix s);
+/** @brief Dot multiplies a sparse matrix with a dense matrix,
+ *  and stores the result in a destination matrix, out = a . b.
+ *
+ *  Each row of the result only adds up the rows of b that a
+ *  nonzero entry of a is at, thus the work is proportional to
+ *  the nonzero entries of a.
+ *
+ *  @param a Sparse factor matrix.
+ *  @param b Dense factor matrix, with as many rows as a has columns.
+ *  @param out The destination matrix (a.row x b.col), which should
+ *  not share entries with b.
+ *  @return Void.
+ */
+void sparseDotInto(SparseMatrix a, Matrix b, Matrix out);
+/** @brief Dot multiplies a dense matrix with the transpose of a
+ *  sparse matrix, and stores the result in a destination matrix,
+ *  out = a . transpose(b).
+ *
+ *  Each entry of the result only gathers the columns of a that
+ *  a nonzero entry of b is at.
+ *
+ *  @param a Dense factor matrix, with as many columns as b.
+ *  @param b Sparse factor matrix.
+ *  @param out The destination matrix (a.row x b.row), which should
+ *  not share entries with a.
+ *  @return Void.
+ */
+void dotSparseTransInto(Matrix a, SparseMatrix b, Matrix out);
+/** @brief Adds a scaled dot product of the transpose of a sparse
+ *  matrix with a dense matrix onto a destination matrix,
+ *  out += alpha * transpose(a) . b.
+ *
+ *  Only the rows of out that a nonzero entry of a is at are
+ *  touched, e.g. the gradient of the weights of row nodes is only
+ *  updated for the inputs that are not zero.
+ *
+ *  @param alpha The factor the product is scaled by.
+ *  @param a Sparse factor matrix.
+ *  @param b Dense factor matrix, with as many rows as a.
+ *  @param out The destination matrix (a.col x b.col), which should
+ *  not share entries with b.
+ *  @return Void.
+ */
+void sparseTransDotAxpy(double alpha, SparseMatrix a, Matrix b, Matrix out);
+/** @brief Adds a scaled dot product of a dense matrix with a sparse
+ *  matrix onto a destination matrix, out += alpha * a . b.
+ *
+ *  Only the columns of out that a nonzero entry of b is at are
+ *  touched, e.g. the gradient of the weights of column nodes is
+ *  only updated for the inputs that are not zero.
+ *
+ *  @param alpha The factor the product is scaled by.
+ *  @param a Dense factor matrix, with as many columns as b has rows.
+ *  @param b Sparse factor matrix.
+ *  @param out The destination matrix (a.row x b.col), which should
+ *  not share entries with a.
+ *  @return Void.
+ */
+void dotSparseAxpy(double alpha, Matrix a, SparseMatrix b, Matrix out);
+/** @brief Frees a sparse matrix from memory.
+ *
+ *  @param s A pointer to the sparse matrix to be freed.
+ *  @return Void.
+ */
+void freeSparseMatrix(SparseMatrix *s);
@@ -4,6 +4,8 @@
  *  This contains the prototypes, type definitions,
  *  constants, and globals for the stats library.
  * 
+ *  DEPENDENCIES: rng
+ * 
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No known bugs.
  */
@@ -11,9 +13,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "real.h"
+
+/** @brief The largest value of an 8-bit pixel. */
+#define PIXEL_MAX 255
 
 /** @brief Type definition for Array Transforming functions. */
-typedef void (*TransformFunc)(double arr[], int size);
+typedef void (*TransformFunc)(Real arr[], int size);
 
 /** @brief Checks if two doubles are equal.
  * 
@@ -29,21 +35,21 @@ int isDoubleEq(double x, double y);
  * @param size The size of the array.
  * @return The minimum value of an array.
  */
-double min(double arr[], int size);
+double min(Real arr[], int size);
 /** @brief Returns the maximum value in an array.
  * 
  * @param arr An array of values.
  * @param size The size of the array.
  * @return The maximum value of an array.
  */
-double max(double arr[], int size);
+double max(Real arr[], int size);
 /** @brief Calculates the average value of an array.
  * 
  * @param arr An array of values.
  * @param size The size of the array.
  * @return The average value of an array.
  */
-double average(double arr[], int size);
+double average(Real arr[], int size);
 /** @brief Calculates the standard deviation of
  * the values in an array.
  * 
@@ -51,8 +57,9 @@ double average(double arr[], int size);
  * @param size The size of the array.
  * @return The standard deviation of an array.
  */
-double stddev(double arr[], int size);
-/** @brief Returns a random number within the range [min, max].
+double stddev(Real arr[], int size);
+/** @brief Returns a random number within the range [min, max], drawn
+ * from the generator of the calling thread (see rng.h).
  * 
  * @param min The minimum possible random number.
  * @param max The maximum possible random number.
@@ -69,7 +76,7 @@ double randn(double min, double max);
  * @param size The size of the array.
  * @return Void.
  */
-void normalize(double arr[], int size);
+void normalize(Real arr[], int size);
 /** @brief Standardizes the values in an array.
  * 
  * This is calculated by subtracting the mean
@@ -81,4 +88,15 @@ void normalize(double arr[], int size);
  * @param size The size of the array.
  * @return Void.
  */
-void standardize(double arr[], int size);
\ No newline at end of file
+void standardize(Real arr[], int size);
+/** @brief Scales 8-bit pixels in an array into [0, 1].
+ * 
+ * Unlike normalize, every array is divided by the same 
+ * PIXEL_MAX, thus it can be folded into the weights of
+ * a first layer that is fed the raw pixels instead.
+ * 
+ * @param arr An array containing all the pixels to scale.
+ * @param size The size of the array.
+ * @return Void.
+ */
+void scalePixels(Real arr[], int size);
\ No newline at end of file
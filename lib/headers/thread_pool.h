@@ -0,0 +1,58 @@
+/** @file thread_pool.h
+ *  @brief Function prototypes for the thread pool library.
+ *
+ *  This contains the prototypes, type definitions,
+ *  constants, and globals for the thread pool library.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No known bugs.
+ */
+#pragma once
+
+/** @brief The function that runs a single task of a parallel loop.
+ *
+ *  @param arg The argument shared by every task of the loop.
+ *  @param task The index of the task, within [0, tasks).
+ *  @return Void.
+ */
+typedef void (*TaskFunc)(void *arg, int task);
+
+/** @brief Returns the number of threads that parallel loops run on,
+ *  which includes the thread that calls them.
+ *
+ *  Defaults to the number of online cores, and is resolved on first use.
+ *
+ *  @return The number of threads.
+ */
+int getThreadCount();
+/** @brief Sets the number of threads that parallel loops run on.
+ *
+ *  The workers of the pool are stopped, and count - 1 new ones are
+ *  started, thus it should not be called while a loop is running.
+ *  A count of 1 runs every loop on the calling thread alone.
+ *
+ *  @param count The number of threads, which includes the calling thread.
+ *  @return Void.
+ */
+void setThreadCount(int count);
+/** @brief Runs the tasks of a loop across the threads of the pool, and
+ *  waits for all of them to finish.
+ *
+ *  The calling thread runs tasks too. The threads take the next task
+ *  that is left as soon as they are done with one, thus tasks of uneven
+ *  sizes are balanced out. A loop started from within a task, or while
+ *  another thread has a loop running, runs on the calling thread alone.
+ *
+ *  @param tasks The number of tasks.
+ *  @param func The function that runs a task.
+ *  @param arg The argument passed to every task.
+ *  @return Void.
+ */
+void parallelFor(int tasks, TaskFunc func, void *arg);
+/** @brief Stops the workers of the pool, and frees them from memory.
+ *
+ *  The pool starts them again on the next loop.
+ *
+ *  @return Void.
+ */
+void freeThreadPool();
@@ -72,7 +72,7 @@ Image bufferToImage(char *buffer)
 
     for(row = 0; row < img.inputValues.row; row++) {
         for(col = 0; col < img.inputValues.col; col++) {
-            img.inputValues.entries[row][col] = atoi(strtok(NULL, ","));
+            MATRIX_AT(img.inputValues, row, col) = atoi(strtok(NULL, ","));
         }
     }
 
@@ -85,6 +85,7 @@ void freeImageSet(Image imgs[], int size)
     for(idx = 0; idx < size; idx++) {
         imgs[idx].expVal = 0;
         freeMatrix(&imgs[idx].inputValues);
+        freeSparseMatrix(&imgs[idx].sparseInputs);
     }
 }
 
@@ -0,0 +1,381 @@
+/** @file inference.c
+ *  @brief A library made for serving trained neural networks
+ *  from many threads at once.
+ *
+ *  This library contains a model, which is a read-only copy of
+ *  a trained neural network, and contexts, which hold the scratch
+ *  memory of each thread that runs it. Networks are compiled into
+ *  plans, which run batches through each layer as a single matrix
+ *  multiplication, with no allocation, nor traversal, per batch.
+ *
+ *  DEPENDENCIES: simd, matrix, sparse, stats, neural_net, ml
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/simd.h"
+#include "headers/matrix.h"
+#include "headers/sparse.h"
+#include "headers/stats.h"
+#include "headers/neural_net.h"
+#include "headers/ml.h"
+#include "headers/inference.h"
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwMallocFailed() { fprintf(stderr, "Memory Allocation Failed."); exit(1); }
+#define SHOULD_NOT_BE_NULL "It should not be a null value."
+#define throwMismatchedDimensions(msg) { fprintf(stderr, "Matrix Dimensions Mismatched. %s", msg); exit(1); }
+#define SHOULD_BE_NON_NEGATIVE "It should be a non-negative integer."
+#define SHOULD_BE_POSITIVE "It should be a positive integer."
+
+InferenceModel createInferenceModel(NeuralNetwork nn, ActivationFunc activate, TransformFunc transform)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    InferenceModel model = { copyNeuralNet(nn), activate, transform, 1, 0 };
+
+    return model;
+}
+
+InferenceModel createDeployModel(NeuralNetwork nn, ActivationFunc activate, double scale, double offset)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    InferenceModel model = { copyNeuralNet(nn), activate, NULL, 1, 1 };
+    Layer layer = getLayer(model.nn, 2);
+    int row, col;
+
+    // the offset of each input adds its share of the unscaled weights onto the bias
+    for(row = 0; row < layer.weights.row; row++) {
+        for(col = 0; col < layer.weights.col; col++) {
+            if(model.nn.options.nodeOrient == COL) {
+                MATRIX_AT(layer.bias, row, 0) += offset * MATRIX_AT(layer.weights, row, col);
+            } else {
+                MATRIX_AT(layer.bias, 0, col) += offset * MATRIX_AT(layer.weights, row, col);
+            }
+        }
+    }
+    scaleInPlace(layer.weights, scale);
+
+    return model;
+}
+
+InferenceModel shareInferenceModel(NeuralNetwork nn, ActivationFunc activate, TransformFunc transform)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    InferenceModel model = { nn, activate, transform, 0, 0 };
+
+    return model;
+}
+
+InferencePlan compileInferencePlan(NeuralNetwork nn, ActivationFunc activate, int maxBatch)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(maxBatch <= 0) throwInvalidArgs("maxBatch", SHOULD_BE_POSITIVE);
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    InferencePlan plan = { NULL, nn.layers.size - 1, maxBatch, nn.options.nodeOrient, activate };
+    PlanStep *step;
+    int pos, maxNodes;
+
+    plan.steps = (PlanStep *) malloc(plan.size * sizeof(PlanStep));
+    if(plan.steps == NULL) throwMallocFailed();
+
+    maxNodes = 0;
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        step = plan.steps + pos - 2;
+        step->layer = getLayer(nn, pos);
+        step->inputs = getLayer(nn, pos - 1).nodes;
+        step->nodes = step->layer.nodes;
+
+        // only the first layer is fed the inputs, which may be sparse, while
+        // a column bias would not be broadcasted onto a batch of column nodes
+        step->kernel = pos == 2 && plan.nodeOrient == ROW ? PLAN_SPARSE : PLAN_DENSE;
+        step->epilogue = (GemmEpilogue) { NULL, NULL, toGemmActivation(activate), activate };
+        if(plan.nodeOrient == COL) {
+            step->epilogue.colBias = step->layer.bias.entries;
+        } else {
+            step->epilogue.rowBias = step->layer.bias.entries;
+        }
+
+        if(step->nodes > maxNodes) {
+            maxNodes = step->nodes;
+        }
+    }
+
+    plan.buffers[0] = plan.nodeOrient == COL ? createMatrix(maxNodes, maxBatch) : createMatrix(maxBatch, maxNodes);
+    plan.buffers[1] = plan.nodeOrient == COL ? createMatrix(maxNodes, maxBatch) : createMatrix(maxBatch, maxNodes);
+
+    return plan;
+}
+
+// Runs the results of the layer before the first step through the steps from
+// there on, and returns a view of the results of the output layer.
+static Matrix runPlanSteps(InferencePlan *plan, Matrix res, const SparseMatrix *sparseInputs, int first, int batch)
+{
+    const PlanStep *step;
+    Matrix out, buffer;
+    int idx;
+
+    for(idx = first; idx < plan->size; idx++) {
+        step = plan->steps + idx;
+        // each layer writes into the buffer that the previous one did not
+        buffer = plan->buffers[idx % 2];
+
+        if(plan->nodeOrient == COL) {
+            out = createMatrixView(buffer.entries, step->nodes, batch, buffer.stride);
+            gemmFused(NO_TRANS, NO_TRANS, step->nodes, batch, step->inputs, step->layer.weights.entries, step->layer.weights.stride,
+                res.entries, res.stride, out.entries, out.stride, step->epilogue);
+        } else if(step->kernel == PLAN_SPARSE && sparseInputs != NULL) {
+            out = createMatrixView(buffer.entries, batch, step->nodes, buffer.stride);
+            sparseForwardInto(*sparseInputs, step->layer, plan->activate, plan->nodeOrient, out);
+        } else {
+            out = createMatrixView(buffer.entries, batch, step->nodes, buffer.stride);
+            gemmFused(NO_TRANS, NO_TRANS, batch, step->nodes, step->inputs, res.entries, res.stride, 
+                step->layer.weights.entries, step->layer.weights.stride, out.entries, out.stride, step->epilogue);
+        }
+
+        res = out;
+    }
+
+    return res;
+}
+
+Matrix runInferencePlan(InferencePlan *plan, Matrix inputs, const SparseMatrix *sparseInputs)
+{
+    if(plan == NULL || plan->steps == NULL) throwInvalidArgs("plan", SHOULD_NOT_BE_NULL);
+    if(!isValidMatrix(inputs) || isZeroMatrix(inputs)) throwInvalidArgs("inputs", "It should be a non-empty matrix.");
+
+    int batch;
+
+    batch = plan->nodeOrient == COL ? inputs.col : inputs.row;
+    if(batch > plan->maxBatch) throwInvalidArgs("inputs", "It should not hold more inputs than the largest batch of the plan.");
+    if((plan->nodeOrient == COL ? inputs.row : inputs.col) != plan->steps[0].inputs) {
+        throwMismatchedDimensions("Inputs can't be fed to the first layer.");
+    }
+    if(sparseInputs != NULL && (sparseInputs->row != batch || sparseInputs->col != plan->steps[0].inputs)) {
+        throwMismatchedDimensions("Sparse inputs should be shaped like the inputs.");
+    }
+
+    return runPlanSteps(plan, inputs, sparseInputs, 0, batch);
+}
+
+// Feeds raw pixels to the first layer, where each image starts off as the
+// bias, and only the weights of its nonzero pixels are added onto it.
+static void pixelForwardInto(const PlanStep *step, const uint8_t *pixels, int batch, ActivationFunc activate, NodeOrientation orient, Matrix out)
+{
+    Activation activation;
+    int img, idx, node, isBuiltIn, nnz;
+    int indices[step->inputs];
+    Real values[step->inputs];
+    const uint8_t *image;
+    Real *dest, sum;
+
+    isBuiltIn = toActivation(activate, &activation);
+    for(img = 0; img < batch; img++) {
+        image = pixels + (long) img * step->inputs;
+
+        if(orient == COL) {
+            // the weights of a node are a row, thus the nonzero pixels are 
+            // gathered once, and dotted with the row of every node
+            nnz = 0;
+            for(idx = 0; idx < step->inputs; idx++) {
+                if(image[idx] != 0) {
+                    indices[nnz] = idx;
+                    values[nnz++] = image[idx];
+                }
+            }
+            for(node = 0; node < step->nodes; node++) {
+                sum = MATRIX_AT(step->layer.bias, node, 0);
+                for(idx = 0; idx < nnz; idx++) {
+                    sum += values[idx] * MATRIX_AT(step->layer.weights, node, indices[idx]);
+                }
+                MATRIX_AT(out, node, img) = activate(sum);
+            }
+        } else {
+            dest = out.entries + (long) img * out.stride;
+            memcpy(dest, step->layer.bias.entries, step->nodes * sizeof(Real));
+            for(idx = 0; idx < step->inputs; idx++) {
+                if(image[idx] != 0) {
+                    vecAxpy(image[idx], step->layer.weights.entries + (long) idx * step->layer.weights.stride, dest, step->nodes);
+                }
+            }
+
+            if(isBuiltIn) {
+                vecActivate(activation, dest, dest, step->nodes);
+            } else {
+                for(node = 0; node < step->nodes; node++) {
+                    dest[node] = activate(dest[node]);
+                }
+            }
+        }
+    }
+}
+
+Matrix runInferencePlanOnPixels(InferencePlan *plan, const uint8_t *pixels, int batch)
+{
+    if(plan == NULL || plan->steps == NULL) throwInvalidArgs("plan", SHOULD_NOT_BE_NULL);
+    if(pixels == NULL) throwInvalidArgs("pixels", SHOULD_NOT_BE_NULL);
+    if(batch <= 0) throwInvalidArgs("batch", SHOULD_BE_POSITIVE);
+    if(batch > plan->maxBatch) throwInvalidArgs("batch", "It should not be larger than the largest batch of the plan.");
+
+    const PlanStep *step = plan->steps;
+    Matrix out;
+
+    out = plan->nodeOrient == COL
+        ? createMatrixView(plan->buffers[0].entries, step->nodes, batch, plan->buffers[0].stride)
+        : createMatrixView(plan->buffers[0].entries, batch, step->nodes, plan->buffers[0].stride);
+    pixelForwardInto(step, pixels, batch, plan->activate, plan->nodeOrient, out);
+
+    return runPlanSteps(plan, out, NULL, 1, batch);
+}
+
+void freeInferencePlan(InferencePlan *plan)
+{
+    if(plan == NULL) throwInvalidArgs("plan", SHOULD_NOT_BE_NULL);
+
+    free(plan->steps);
+    freeMatrix(plan->buffers);
+    freeMatrix(plan->buffers+1);
+    *plan = (InferencePlan) { 0 };
+}
+
+InferenceContext createInferenceContext(const InferenceModel *model)
+{
+    if(model == NULL) throwInvalidArgs("model", SHOULD_NOT_BE_NULL);
+
+    InferenceContext ctx;
+    int inputs;
+
+    inputs = getLayer(model->nn, 1).nodes;
+
+    ctx.model = model;
+    ctx.plan = compileInferencePlan(model->nn, model->activate, PREDICT_BATCH);
+    ctx.sparseInputs = (SparseMatrix) { 0, 0, 0, NULL, NULL, NULL };
+    ctx.pixels = createMatrix(1, inputs);
+    ctx.inputs = model->nn.options.nodeOrient == COL ? createMatrix(inputs, PREDICT_BATCH) : createMatrix(PREDICT_BATCH, inputs);
+
+    // the sparse inputs can hold a batch where every input is nonzero, while
+    // deployed models are fed the pixels themselves
+    if(ctx.plan.steps[0].kernel == PLAN_SPARSE && !model->feedsPixels) {
+        ctx.sparseInputs = (SparseMatrix) { PREDICT_BATCH, inputs, 0, NULL, NULL, NULL };
+        ctx.sparseInputs.rowStarts = (int *) malloc((PREDICT_BATCH + 1) * sizeof(int));
+        ctx.sparseInputs.colIndices = (int *) malloc((size_t) PREDICT_BATCH * inputs * sizeof(int));
+        ctx.sparseInputs.values = (Real *) malloc((size_t) PREDICT_BATCH * inputs * sizeof(Real));
+        if(ctx.sparseInputs.rowStarts == NULL || ctx.sparseInputs.colIndices == NULL || ctx.sparseInputs.values == NULL) {
+            throwMallocFailed();
+        }
+    }
+
+    return ctx;
+}
+
+// Formats the pixels of a batch of images into the inputs of a context, the
+// way prepData would, and returns a view of the inputs of the batch. The 
+// nonzero inputs are gathered as well, if the context has room for them.
+static Matrix loadBatch(InferenceContext *ctx, const uint8_t *pixels, int size)
+{
+    const InferenceModel *model = ctx->model;
+    SparseMatrix *sparse = &ctx->sparseInputs;
+    int img, idx, inputs;
+    Matrix dest;
+
+    inputs = ctx->pixels.col;
+    sparse->nnz = 0;
+    for(img = 0; img < size; img++) {
+        // row inputs are formatted in place, while column inputs are formatted
+        // in a row first, since the transform takes contiguous values
+        dest = model->nn.options.nodeOrient == COL ? ctx->pixels : getSubMatrix(ctx->inputs, img, 0, 1, inputs);
+        for(idx = 0; idx < inputs; idx++) {
+            dest.entries[idx] = pixels[(long) img * inputs + idx];
+        }
+
+        if(model->transform != NULL) {
+            model->transform(dest.entries, inputs);
+        }
+        if(model->nn.options.nodeOrient == COL) {
+            transposeInto(ctx->pixels, getSubMatrix(ctx->inputs, 0, img, inputs, 1));
+        }
+
+        if(isSparseMatrix(*sparse)) {
+            sparse->rowStarts[img] = sparse->nnz;
+            for(idx = 0; idx < inputs; idx++) {
+                if(dest.entries[idx] != 0) {
+                    sparse->colIndices[sparse->nnz] = idx;
+                    sparse->values[sparse->nnz++] = dest.entries[idx];
+                }
+            }
+            sparse->rowStarts[img + 1] = sparse->nnz;
+        }
+    }
+    if(isSparseMatrix(*sparse)) {
+        sparse->row = size;
+    }
+
+    return model->nn.options.nodeOrient == COL
+        ? getSubMatrix(ctx->inputs, 0, 0, inputs, size)
+        : getSubMatrix(ctx->inputs, 0, 0, size, inputs);
+}
+
+void predict(InferenceContext *ctx, const uint8_t *pixels, int n, int *labels)
+{
+    if(ctx == NULL || ctx->model == NULL) throwInvalidArgs("ctx", SHOULD_NOT_BE_NULL);
+    if(n < 0) throwInvalidArgs("n", SHOULD_BE_NON_NEGATIVE);
+    if(n > 0 && pixels == NULL) throwInvalidArgs("pixels", SHOULD_NOT_BE_NULL);
+    if(n > 0 && labels == NULL) throwInvalidArgs("labels", SHOULD_NOT_BE_NULL);
+
+    NodeOrientation orient = ctx->plan.nodeOrient;
+    const SparseMatrix *sparse;
+    Matrix inputs, res;
+    int start, size, img;
+
+    for(start = 0; start < n; start += PREDICT_BATCH) {
+        size = n - start < PREDICT_BATCH ? n - start : PREDICT_BATCH;
+        if(ctx->model->feedsPixels) {
+            res = runInferencePlanOnPixels(&ctx->plan, pixels + (long) start * ctx->pixels.col, size);
+        } else {
+            inputs = loadBatch(ctx, pixels + (long) start * ctx->pixels.col, size);
+            sparse = isSparseMatrix(ctx->sparseInputs) && ctx->sparseInputs.nnz <= SPARSE_INPUT_MAX_DENSITY * size * ctx->pixels.col
+                ? &ctx->sparseInputs
+                : NULL;
+            res = runInferencePlan(&ctx->plan, inputs, sparse);
+        }
+
+        for(img = 0; img < size; img++) {
+            labels[start + img] = orient == COL
+                ? evalResult(getSubMatrix(res, 0, img, res.row, 1))
+                : evalResult(getSubMatrix(res, img, 0, 1, res.col));
+        }
+    }
+}
+
+void freeInferenceContext(InferenceContext *ctx)
+{
+    if(ctx == NULL) throwInvalidArgs("ctx", SHOULD_NOT_BE_NULL);
+
+    freeMatrix(&ctx->inputs);
+    freeMatrix(&ctx->pixels);
+    freeSparseMatrix(&ctx->sparseInputs);
+    freeInferencePlan(&ctx->plan);
+    ctx->model = NULL;
+}
+
+void freeInferenceModel(InferenceModel *model)
+{
+    if(model == NULL) throwInvalidArgs("model", SHOULD_NOT_BE_NULL);
+
+    if(model->ownsNet) {
+        freeNeuralNet(&model->nn);
+    }
+    model->nn = (NeuralNetwork) { 0 };
+    model->activate = NULL;
+    model->transform = NULL;
+    model->feedsPixels = 0;
+}
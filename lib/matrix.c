@@ -5,13 +5,20 @@
  *  users to create, and manipulate matrices through various
  *  operations (e.g., add, dot, scale, transpose, etc.). 
  *
+ *  DEPENDENCIES: arena, gemm, simd, rng
+ *
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No know bugs.
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
+#include "headers/arena.h"
+#include "headers/gemm.h"
+#include "headers/simd.h"
+#include "headers/rng.h"
 #include "headers/matrix.h"
 
 #define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
@@ -20,45 +27,189 @@
 #define SHOULD_BE_POSITIVE "It should be a positive integer."
 #define SHOULD_BE_NON_NEGATIVE "It should be a non-negative integer."
 #define NOT_A_MATRIX "Argument is not a valid matrix."
+#define OUT_OF_BOUNDS "It should be within the dimensions of the matrix."
+
+// side of the square tiles transposes are done in, so that a tile 
+// of both the source and the destination fits in the L1 cache
+#define TRANSPOSE_TILE 32
+// The number of entries of each row an expression is evaluated on at 
+// a time, so that the intermediate results of a chunk stay in the L1 cache.
+#define EXPR_CHUNK 256
+// The largest number of intermediate results an expression can hold at once.
+#define EXPR_MAX_DEPTH 8
+
+// number of entries that fit in one aligned chunk of memory
+#define ALIGNED_ENTRIES (MATRIX_ALIGNMENT / (int) sizeof(Real))
+
+// Rows that span at least one aligned chunk are padded to a multiple of 
+// it, so that every row starts on an aligned address. Narrower rows are
+// left unpadded to not waste memory on small vectors.
+static int paddedStride(int col)
+{
+    if(col < ALIGNED_ENTRIES) return col;
+    return (col + ALIGNED_ENTRIES - 1) / ALIGNED_ENTRIES * ALIGNED_ENTRIES;
+}
 
 Matrix createMatrix(int row, int col)
 {
     if(row <= 0) throwInvalidArgs("row", SHOULD_BE_POSITIVE);
     if(col <= 0) throwInvalidArgs("col", SHOULD_BE_POSITIVE);
     
-    Matrix m = { NULL, row, col };
-    int idx;
+    Matrix m = { NULL, row, col, paddedStride(col), NULL };
+    uintptr_t addr;
 
-    m.entries = (double **) malloc(row * sizeof(double*));
-    if(m.entries == NULL) throwMallocFailed();
-    
-    for(idx = 0; idx < row; idx++) {
-        m.entries[idx] = (double *) malloc(col * sizeof(double));
-        if(m.entries[idx] == NULL) throwMallocFailed();
-    }
+    // over-allocate, so that the entries can be shifted to an aligned address
+    m.block = malloc((size_t) row * m.stride * sizeof(Real) + MATRIX_ALIGNMENT - 1);
+    if(m.block == NULL) throwMallocFailed();
+
+    addr = ((uintptr_t) m.block + MATRIX_ALIGNMENT - 1) & ~((uintptr_t) MATRIX_ALIGNMENT - 1);
+    m.entries = (Real *) addr;
     
     return m; 
 }
 
 Matrix createZeroMatrix()
 {
-    Matrix m = { NULL, 0, 0 };
+    Matrix m = { NULL, 0, 0, 0, NULL };
+    return m;
+}
+
+Matrix createArenaMatrix(Arena *arena, int row, int col)
+{
+    if(arena == NULL) throwInvalidArgs("arena", "It should not be null.");
+    if(row <= 0) throwInvalidArgs("row", SHOULD_BE_POSITIVE);
+    if(col <= 0) throwInvalidArgs("col", SHOULD_BE_POSITIVE);
+
+    // the arena owns the entries, thus the matrix has no block of its own
+    Matrix m = { NULL, row, col, paddedStride(col), NULL };
+    m.entries = (Real *) arenaAlloc(arena, (size_t) row * m.stride * sizeof(Real), MATRIX_ALIGNMENT);
+
     return m;
 }
 
+Matrix acquireMatrix(MatrixPool *pool, int row, int col)
+{
+    if(pool == NULL) throwInvalidArgs("pool", "It should not be null.");
+
+    PoolShape *shape;
+    PoolNode *node;
+
+    for(shape = pool->shapes; shape != NULL; shape = shape->next) {
+        if(shape->row == row && shape->col == col && shape->free != NULL) {
+            node = shape->free;
+            shape->free = node->next;
+            node->next = pool->spareNodes;
+            pool->spareNodes = node;
+
+            return node->m;
+        }
+    }
+
+    return createMatrix(row, col);
+}
+
+void releaseMatrix(MatrixPool *pool, Matrix *m)
+{
+    if(pool == NULL) throwInvalidArgs("pool", "It should not be null.");
+    if(!isValidMatrix(*m) || isZeroMatrix(*m)) throwInvalidArgs("m", NOT_A_MATRIX);
+    if(m->block == NULL) throwInvalidArgs("m", "It should own its entries.");
+
+    PoolShape *shape;
+    PoolNode *node;
+
+    for(shape = pool->shapes; shape != NULL && (shape->row != m->row || shape->col != m->col); shape = shape->next) {}
+
+    if(shape == NULL) {
+        shape = (PoolShape *) malloc(sizeof(PoolShape));
+        if(shape == NULL) throwMallocFailed();
+
+        shape->row = m->row;
+        shape->col = m->col;
+        shape->free = NULL;
+        shape->next = pool->shapes;
+        pool->shapes = shape;
+    }
+
+    // reuse the node of a matrix that was acquired before, if any
+    if(pool->spareNodes != NULL) {
+        node = pool->spareNodes;
+        pool->spareNodes = node->next;
+    } else {
+        node = (PoolNode *) malloc(sizeof(PoolNode));
+        if(node == NULL) throwMallocFailed();
+    }
+
+    node->m = *m;
+    node->next = shape->free;
+    shape->free = node;
+    *m = createZeroMatrix();
+}
+
+void freeMatrixPool(MatrixPool *pool)
+{
+    if(pool == NULL) throwInvalidArgs("pool", "It should not be null.");
+
+    PoolShape *shape, *nextShape;
+    PoolNode *node, *nextNode;
+
+    for(shape = pool->shapes; shape != NULL; shape = nextShape) {
+        for(node = shape->free; node != NULL; node = nextNode) {
+            nextNode = node->next;
+            freeMatrix(&node->m);
+            free(node);
+        }
+
+        nextShape = shape->next;
+        free(shape);
+    }
+
+    for(node = pool->spareNodes; node != NULL; node = nextNode) {
+        nextNode = node->next;
+        free(node);
+    }
+
+    pool->shapes = NULL;
+    pool->spareNodes = NULL;
+}
+
+Matrix createMatrixView(Real *entries, int row, int col, int stride)
+{
+    if(entries == NULL) throwInvalidArgs("entries", "It should not be null.");
+    if(row <= 0) throwInvalidArgs("row", SHOULD_BE_POSITIVE);
+    if(col <= 0) throwInvalidArgs("col", SHOULD_BE_POSITIVE);
+    if(stride < col) throwInvalidArgs("stride", "It should not be less than col.");
+
+    Matrix m = { entries, row, col, stride, NULL };
+    return m;
+}
+
+Matrix getSubMatrix(Matrix m, int rowStart, int colStart, int row, int col)
+{
+    if(!isValidMatrix(m) || isZeroMatrix(m)) throwInvalidArgs("m", NOT_A_MATRIX);
+    if(rowStart < 0 || row <= 0 || rowStart + row > m.row) throwInvalidArgs("row", OUT_OF_BOUNDS);
+    if(colStart < 0 || col <= 0 || colStart + col > m.col) throwInvalidArgs("col", OUT_OF_BOUNDS);
+
+    return createMatrixView(&MATRIX_AT(m, rowStart, colStart), row, col, m.stride);
+}
+
+Matrix getRowRange(Matrix m, int rowStart, int row)
+{
+    return getSubMatrix(m, rowStart, 0, row, m.col);
+}
+
 void fillMatrix(Matrix m, double val)
 {
     if(!isValidMatrix(m)) throwInvalidArgs("m", NOT_A_MATRIX);
 
-    int idx;
-    double fill[m.col];
+    int row;
 
-    for(idx = 0; idx < m.col; idx++) {
-        fill[idx] = val;
+    if(isContiguousMatrix(m)) {
+        vecFill(m.entries, val, m.row * m.col);
+        return;
     }
-    
-    for(idx = 0; idx < m.row; idx++) {
-        memcpy(m.entries[idx], fill, m.col * sizeof(double));
+
+    for(row = 0; row < m.row; row++) {
+        vecFill(MATRIX_ROW(m, row), val, m.col);
     }
 }
 
@@ -66,14 +217,10 @@ void fillMatrixRandn(Matrix m, double min, double max, double mult)
 {
     if(!isValidMatrix(m)) throwInvalidArgs("m", NOT_A_MATRIX);
     
-    int row, col;
-    double boundRand, range = min - max;
+    int row;
 
     for(row = 0; row < m.row; row++) {
-        for(col = 0; col < m.col; col++) {
-            boundRand = min + ((double) (rand() % RAND_MAX) / RAND_MAX) * range;
-            m.entries[row][col] = boundRand * mult;
-        }
+        rngUniformArr(getThreadRng(), MATRIX_ROW(m, row), m.col, min * mult, max * mult);
     }
 }
 
@@ -83,10 +230,12 @@ void mapMatrix(Matrix m, MapFunc map)
     if(map == NULL) throwInvalidArgs("map", "It should not be null.");
 
     int row, col;
+    Real *entries;
 
     for(row = 0; row < m.row; row++) {
+        entries = MATRIX_ROW(m, row);
         for(col = 0; col < m.col; col++) {
-            m.entries[row][col] = map(m.entries[row][col]);
+            entries[col] = map(entries[col]);
         }
     }
 }
@@ -95,12 +244,8 @@ void freeMatrix(Matrix* m)
 {
     if(!isValidMatrix(*m)) throwInvalidArgs("m", NOT_A_MATRIX);
     
-    int row;
-    for(row = 0; row < m->row; row++) {
-        free(m->entries[row]);
-    }
-
-    free(m->entries);
+    // views don't own their entries, so only the owner frees them
+    free(m->block);
     *m = createZeroMatrix();
 }
 
@@ -111,7 +256,7 @@ void printMatrix(Matrix m)
     int row, col;
     for(row = 0; row < m.row; row++) {
         for(col = 0; col < m.col; col++) {
-            printf("%5.2lf ", m.entries[row][col]);
+            printf("%5.2lf ", MATRIX_AT(m, row, col));
         }
 
         printf("\n");
@@ -120,7 +265,9 @@ void printMatrix(Matrix m)
 
 int isValidMatrix(Matrix m)
 {
-    return (m.row > 0 && m.col > 0) || isZeroMatrix(m) ? 1 : 0;
+    int hasValidDimensions = m.row > 0 && m.col > 0 && m.stride >= m.col;
+
+    return (hasValidDimensions && m.entries != NULL) || isZeroMatrix(m) ? 1 : 0;
 }
 
 int isColumnMatrix(Matrix m)
@@ -144,21 +291,24 @@ int isZeroMatrix(Matrix m)
     return m.row == 0 && m.col == 0 ? 1 : 0;
 }
 
+int isMatrixView(Matrix m)
+{
+    return !isZeroMatrix(m) && m.block == NULL ? 1 : 0;
+}
+
+int isContiguousMatrix(Matrix m)
+{
+    if(!isValidMatrix(m)) throwInvalidArgs("m", NOT_A_MATRIX);
+
+    return m.stride == m.col || m.row <= 1 ? 1 : 0;
+}
+
 Matrix add(Matrix a, Matrix b)
 {
     if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
-    if(!isValidMatrix(b)) throwInvalidArgs("b", NOT_A_MATRIX);
-    if(a.row != b.row || a.col != b.col) throwInvalidArgs("Matrices can't be added.", "");
-
-    Matrix m;
-    int row, col;
 
-    m = createMatrix(a.row, a.col);
-    for(row = 0; row < a.row; row++) {
-        for(col = 0; col < a.col; col++) {
-            m.entries[row][col] = a.entries[row][col] + b.entries[row][col];
-        }
-    }
+    Matrix m = createMatrix(a.row, a.col);
+    addInto(a, b, m);
 
     return m;
 }
@@ -166,18 +316,9 @@ Matrix add(Matrix a, Matrix b)
 Matrix subtract(Matrix min, Matrix sub)
 {
     if(!isValidMatrix(min)) throwInvalidArgs("min", NOT_A_MATRIX);
-    if(!isValidMatrix(sub)) throwInvalidArgs("sub", NOT_A_MATRIX);
-    if(min.row != sub.row || min.col != sub.col) throwInvalidArgs("Matrices can't be subtracted.", "");
 
-    Matrix m;
-    int row, col;
-
-    m = createMatrix(min.row, min.col);
-    for(row = 0; row < min.row; row++) {
-        for(col = 0; col < min.col; col++) {
-            m.entries[row][col] = min.entries[row][col] - sub.entries[row][col];
-        }
-    }
+    Matrix m = createMatrix(min.row, min.col);
+    subtractInto(min, sub, m);
 
     return m;
 }
@@ -187,67 +328,397 @@ Matrix scale(Matrix a, double val)
     if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
     
     Matrix m = createMatrix(a.row, a.col);
-    int row, col;
-    
-    for(row = 0; row < a.row; row++) {
-        for(col = 0; col < a.col; col++) {
-            m.entries[row][col] = val * a.entries[row][col];
-        }
-    }
+    scaleInto(a, val, m);
 
     return m;
 }
 
-Matrix dot(Matrix a, Matrix b)
+// Transposes a square matrix in place. Each pair of tiles mirrored by the
+// diagonal is swapped in one pass, and the tiles on it are swapped with
+// themselves, thus no entry is ever visited twice.
+static void transposeSquareInPlace(Matrix a)
+{
+    int rowTile, colTile, row, col, rowEnd, colEnd;
+    Real tmp;
+
+    for(rowTile = 0; rowTile < a.row; rowTile += TRANSPOSE_TILE) {
+        rowEnd = rowTile + TRANSPOSE_TILE < a.row ? rowTile + TRANSPOSE_TILE : a.row;
+        for(colTile = rowTile; colTile < a.col; colTile += TRANSPOSE_TILE) {
+            colEnd = colTile + TRANSPOSE_TILE < a.col ? colTile + TRANSPOSE_TILE : a.col;
+            for(row = rowTile; row < rowEnd; row++) {
+                for(col = colTile == rowTile ? row + 1 : colTile; col < colEnd; col++) {
+                    tmp = MATRIX_AT(a, row, col);
+                    MATRIX_AT(a, row, col) = MATRIX_AT(a, col, row);
+                    MATRIX_AT(a, col, row) = tmp;
+                }
+            }
+        }
+    }
+}
+
+Matrix dot(Matrix a, Matrix b, GemmTranspose transA, GemmTranspose transB)
 {
     if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
     if(!isValidMatrix(b)) throwInvalidArgs("b", NOT_A_MATRIX);
-    if(a.col != b.row && b.col != a.row) throwMismatchedDimensions("Matrices can't be dotted.");
     
     Matrix m;
-    int row, addTrav, col;
-    double sum;
 
-    // swap a and b, if a.col != b.row, since it's possible that
-    // b.col == a.row. This is also necessary for the dot calculation
-    // to work, since it is required that a is to be traversed by row
-    // and b to be traversed by col
-    if(a.col != b.row) {
-        m = a;
-        a = b;
-        b = m;
+    m = createMatrix(transA == TRANS ? a.col : a.row, transB == TRANS ? b.row : b.col);
+    dotInto(a, b, transA, transB, m);
+
+    return m;
+}
+
+void transpose(Matrix* a)
+{
+    if(!isValidMatrix(*a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    
+    Matrix m;
+    int tmp;
+
+    // a vector with contiguous entries has the same layout as its 
+    // transpose, thus only its shape has to be flipped
+    if((a->row == 1 || a->col == 1) && isContiguousMatrix(*a)) {
+        tmp = a->row;
+        a->row = a->col;
+        a->col = tmp;
+        a->stride = a->col;
+        return;
+    }
+
+    if(a->row == a->col && a->block != NULL) {
+        transposeSquareInPlace(*a);
+        return;
+    }
+
+    m = createMatrix(a->col, a->row);
+    transposeInto(*a, m);
+
+    freeMatrix(a);
+    *a = m;
+}
+
+void addInto(Matrix a, Matrix b, Matrix out)
+{
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isValidMatrix(b)) throwInvalidArgs("b", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if((a.row != b.row && b.row != 1) || a.col != b.col) throwInvalidArgs("Matrices can't be added.", "");
+    if(out.row != a.row || out.col != a.col) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row;
+
+    if(a.row == b.row && isContiguousMatrix(a) && isContiguousMatrix(b) && isContiguousMatrix(out)) {
+        vecAdd(a.entries, b.entries, out.entries, a.row * a.col);
+        return;
     }
 
-    m = createMatrix(a.row, b.col);
+    // a single row b is broadcasted to every row of a
     for(row = 0; row < a.row; row++) {
-        for(col = 0; col < b.col; col++) {
-            sum = 0;
-            for(addTrav = 0; addTrav < a.col; addTrav++) {
-                sum += a.entries[row][addTrav] * b.entries[addTrav][col];
-            }
+        vecAdd(MATRIX_ROW(a, row), MATRIX_ROW(b, b.row == 1 ? 0 : row), MATRIX_ROW(out, row), a.col);
+    }
+}
 
-            m.entries[row][col] = sum;
-        }
+void subtractInto(Matrix min, Matrix sub, Matrix out)
+{
+    if(!isValidMatrix(min)) throwInvalidArgs("min", NOT_A_MATRIX);
+    if(!isValidMatrix(sub)) throwInvalidArgs("sub", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if((min.row != sub.row && sub.row != 1) || min.col != sub.col) throwInvalidArgs("Matrices can't be subtracted.", "");
+    if(out.row != min.row || out.col != min.col) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row;
+
+    if(min.row == sub.row && isContiguousMatrix(min) && isContiguousMatrix(sub) && isContiguousMatrix(out)) {
+        vecSubtract(min.entries, sub.entries, out.entries, min.row * min.col);
+        return;
     }
 
-    return m;
+    // a single row sub is broadcasted to every row of min
+    for(row = 0; row < min.row; row++) {
+        vecSubtract(MATRIX_ROW(min, row), MATRIX_ROW(sub, sub.row == 1 ? 0 : row), MATRIX_ROW(out, row), min.col);
+    }
 }
 
-void transpose(Matrix* a)
+void scaleInto(Matrix a, double val, Matrix out)
 {
-    if(!isValidMatrix(*a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(out.row != a.row || out.col != a.col) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row;
     
-    Matrix m = createMatrix(a->col, a->row);
-    int row, col;
+    if(isContiguousMatrix(a) && isContiguousMatrix(out)) {
+        vecScale(a.entries, val, out.entries, a.row * a.col);
+        return;
+    }
+
+    for(row = 0; row < a.row; row++) {
+        vecScale(MATRIX_ROW(a, row), val, MATRIX_ROW(out, row), a.col);
+    }
+}
+
+void scaleInPlace(Matrix a, double val)
+{
+    scaleInto(a, val, a);
+}
+
+void activateInto(Matrix a, Activation activation, Matrix out)
+{
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(out.row != a.row || out.col != a.col) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row;
     
-    for(row = 0; row < a->row; row++) {
-        for(col = 0; col < a->col; col++) {
-            m.entries[col][row] = a->entries[row][col];
+    if(isContiguousMatrix(a) && isContiguousMatrix(out)) {
+        vecActivate(activation, a.entries, out.entries, a.row * a.col);
+        return;
+    }
+
+    for(row = 0; row < a.row; row++) {
+        vecActivate(activation, MATRIX_ROW(a, row), MATRIX_ROW(out, row), a.col);
+    }
+}
+
+void activatePrimeInto(Matrix a, Activation activation, Matrix out)
+{
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(out.row != a.row || out.col != a.col) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row;
+    
+    if(isContiguousMatrix(a) && isContiguousMatrix(out)) {
+        vecActivatePrime(activation, a.entries, out.entries, a.row * a.col);
+        return;
+    }
+
+    for(row = 0; row < a.row; row++) {
+        vecActivatePrime(activation, MATRIX_ROW(a, row), MATRIX_ROW(out, row), a.col);
+    }
+}
+
+void axpy(double alpha, Matrix x, Matrix y)
+{
+    if(!isValidMatrix(x)) throwInvalidArgs("x", NOT_A_MATRIX);
+    if(!isValidMatrix(y)) throwInvalidArgs("y", NOT_A_MATRIX);
+    if(x.row != y.row || x.col != y.col) throwMismatchedDimensions("Matrices can't be accumulated.");
+
+    int row;
+
+    if(isContiguousMatrix(x) && isContiguousMatrix(y)) {
+        vecAxpy(alpha, x.entries, y.entries, x.row * x.col);
+        return;
+    }
+
+    for(row = 0; row < x.row; row++) {
+        vecAxpy(alpha, MATRIX_ROW(x, row), MATRIX_ROW(y, row), x.col);
+    }
+}
+
+// Records an operation that takes a number of operands off of the results,
+// and leaves a single one. Returns the node, for its argument to be set.
+static ExprNode *appendExprOp(MatrixExpr *e, ExprOp op, int operands)
+{
+    if(e == NULL) throwInvalidArgs("e", "It should not be null.");
+    if(e->size >= MATRIX_EXPR_MAX_OPS) throwInvalidArgs("e", "The expression has too many operations.");
+    if(e->depth < operands) throwInvalidArgs("e", "The operation is missing its operands.");
+    if(e->depth - operands + 1 > EXPR_MAX_DEPTH) throwInvalidArgs("e", "The expression holds too many results at once.");
+
+    ExprNode *node = e->ops + e->size++;
+
+    node->op = op;
+    e->depth += 1 - operands;
+
+    return node;
+}
+
+void exprLoad(MatrixExpr *e, Matrix m)
+{
+    if(!isValidMatrix(m)) throwInvalidArgs("m", NOT_A_MATRIX);
+
+    appendExprOp(e, EXPR_LOAD, 0)->m = m;
+}
+
+void exprAdd(MatrixExpr *e)
+{
+    appendExprOp(e, EXPR_ADD, 2);
+}
+
+void exprSubtract(MatrixExpr *e)
+{
+    appendExprOp(e, EXPR_SUBTRACT, 2);
+}
+
+void exprMultiply(MatrixExpr *e)
+{
+    appendExprOp(e, EXPR_MULTIPLY, 2);
+}
+
+void exprScale(MatrixExpr *e, double val)
+{
+    appendExprOp(e, EXPR_SCALE, 1)->val = val;
+}
+
+void exprActivate(MatrixExpr *e, Activation activation)
+{
+    if(activation < IDENTITY || activation > TANH) throwInvalidArgs("activation", "");
+
+    appendExprOp(e, EXPR_ACTIVATE, 1)->activation = activation;
+}
+
+void exprActivatePrime(MatrixExpr *e, Activation activation)
+{
+    if(activation < IDENTITY || activation > TANH) throwInvalidArgs("activation", "");
+
+    appendExprOp(e, EXPR_ACTIVATE_PRIME, 1)->activation = activation;
+}
+
+// Runs the operations of an expression over a chunk of a row of out, that
+// starts at a given column. Intermediate results are kept in scratch, and
+// only the last operation writes out.
+static void evalExprChunk(const MatrixExpr *e, int row, int start, int size, Real *out)
+{
+    Real scratch[EXPR_MAX_DEPTH][EXPR_CHUNK];
+    const Real *results[EXPR_MAX_DEPTH];
+    const ExprNode *node;
+    Real *dest;
+    int idx, top;
+
+    top = 0;
+    for(idx = 0; idx < e->size; idx++) {
+        node = e->ops + idx;
+
+        // loads only point at the entries, and are never copied, where
+        // a single row is broadcasted to every row
+        if(node->op == EXPR_LOAD) {
+            results[top++] = MATRIX_ROW(node->m, node->m.row == 1 ? 0 : row) + start;
+            continue;
+        }
+
+        // the result takes the place of the first operand
+        if(node->op == EXPR_ADD || node->op == EXPR_SUBTRACT || node->op == EXPR_MULTIPLY) top--;
+        dest = idx == e->size - 1 ? out : scratch[top - 1];
+
+        switch(node->op) {
+            case EXPR_ADD: vecAdd(results[top - 1], results[top], dest, size); break;
+            case EXPR_SUBTRACT: vecSubtract(results[top - 1], results[top], dest, size); break;
+            case EXPR_MULTIPLY: vecMultiply(results[top - 1], results[top], dest, size); break;
+            case EXPR_SCALE: vecScale(results[top - 1], node->val, dest, size); break;
+            case EXPR_ACTIVATE: vecActivate(node->activation, results[top - 1], dest, size); break;
+            case EXPR_ACTIVATE_PRIME: vecActivatePrime(node->activation, results[top - 1], dest, size); break;
+            default: break;
         }
+        results[top - 1] = dest;
     }
 
-    freeMatrix(a);
-    *a = m;
+    // an expression of a single matrix is only copied
+    if(results[0] != out) {
+        memmove(out, results[0], size * sizeof(Real));
+    }
+}
+
+void evalExprInto(const MatrixExpr *e, Matrix out)
+{
+    if(e == NULL) throwInvalidArgs("e", "It should not be null.");
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(e->depth != 1) throwInvalidArgs("e", "The expression should have a single result.");
+
+    int idx, row, start, size, rowCount, rowSize;
+    Matrix m;
+
+    // matrices that are all contiguous, and not broadcasted, are walked as one long row
+    rowCount = isContiguousMatrix(out) ? 1 : out.row;
+    for(idx = 0; idx < e->size; idx++) {
+        if(e->ops[idx].op != EXPR_LOAD) continue;
+
+        m = e->ops[idx].m;
+        if((m.row != out.row && m.row != 1) || m.col != out.col) throwMismatchedDimensions("Result can't be stored in out.");
+        if(m.row != out.row || !isContiguousMatrix(m)) rowCount = out.row;
+    }
+    rowSize = rowCount == 1 ? out.row * out.col : out.col;
+
+    for(row = 0; row < rowCount; row++) {
+        for(start = 0; start < rowSize; start += EXPR_CHUNK) {
+            size = rowSize - start < EXPR_CHUNK ? rowSize - start : EXPR_CHUNK;
+            evalExprChunk(e, row, start, size, MATRIX_ROW(out, row) + start);
+        }
+    }
+}
+
+// Gets the shape of the factors of a dot operation, after they are transposed.
+static void getDotShape(Matrix a, Matrix b, GemmTranspose transA, GemmTranspose transB, int *m, int *n, int *k)
+{
+    if(transA != NO_TRANS && transA != TRANS) throwInvalidArgs("transA", "");
+    if(transB != NO_TRANS && transB != TRANS) throwInvalidArgs("transB", "");
+
+    *m = transA == TRANS ? a.col : a.row;
+    *k = transA == TRANS ? a.row : a.col;
+    *n = transB == TRANS ? b.row : b.col;
+
+    if(*k != (transB == TRANS ? b.col : b.row)) throwMismatchedDimensions("Matrices can't be dotted.");
+}
+
+void dotInto(Matrix a, Matrix b, GemmTranspose transA, GemmTranspose transB, Matrix out)
+{
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isValidMatrix(b)) throwInvalidArgs("b", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+
+    int m, n, k;
+
+    getDotShape(a, b, transA, transB, &m, &n, &k);
+    if(out.row != m || out.col != n) throwMismatchedDimensions("Result can't be stored in out.");
+
+    gemm(transA, transB, m, n, k, a.entries, a.stride, b.entries, b.stride, out.entries, out.stride);
+}
+
+void dotFusedInto(Matrix a, Matrix b, GemmTranspose transA, GemmTranspose transB, Matrix bias, GemmActivation activation, MapFunc map, Matrix out)
+{
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isValidMatrix(b)) throwInvalidArgs("b", NOT_A_MATRIX);
+    if(!isValidMatrix(bias)) throwInvalidArgs("bias", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+
+    int m, n, k;
+
+    getDotShape(a, b, transA, transB, &m, &n, &k);
+    if(out.row != m || out.col != n) throwMismatchedDimensions("Result can't be stored in out.");
+
+    GemmEpilogue epilogue = { NULL, NULL, activation, map };
+
+    if(bias.row == 1 && bias.col == out.col) {
+        epilogue.rowBias = bias.entries;
+    } else if(bias.col == 1 && bias.row == out.row) {
+        if(!isContiguousMatrix(bias)) throwInvalidArgs("bias", "A column bias should be contiguous.");
+        epilogue.colBias = bias.entries;
+    } else {
+        throwMismatchedDimensions("Bias can't be added to the result.");
+    }
+
+    gemmFused(transA, transB, m, n, k, a.entries, a.stride, b.entries, b.stride, out.entries, out.stride, epilogue);
+}
+
+void transposeInto(Matrix a, Matrix out)
+{
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(out.row != a.col || out.col != a.row) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int rowTile, colTile, row, col, rowEnd, colEnd;
+    
+    for(rowTile = 0; rowTile < a.row; rowTile += TRANSPOSE_TILE) {
+        rowEnd = rowTile + TRANSPOSE_TILE < a.row ? rowTile + TRANSPOSE_TILE : a.row;
+        for(colTile = 0; colTile < a.col; colTile += TRANSPOSE_TILE) {
+            colEnd = colTile + TRANSPOSE_TILE < a.col ? colTile + TRANSPOSE_TILE : a.col;
+            for(row = rowTile; row < rowEnd; row++) {
+                for(col = colTile; col < colEnd; col++) {
+                    MATRIX_AT(out, col, row) = MATRIX_AT(a, row, col);
+                }
+            }
+        }
+    }
 }
 
 void flatten(Matrix* a, MatrixAxis axis)
@@ -262,15 +733,14 @@ void flatten(Matrix* a, MatrixAxis axis)
             m = createMatrix(a->row * a->col, 1);
             for(row = 0; row < a->row; row++) {
                 for(col = 0; col < a->col; col++) {
-                    m.entries[row * a->col + col][0] = a->entries[row][col];
+                    MATRIX_AT(m, row * a->col + col, 0) = MATRIX_AT(*a, row, col);
                 }
             }
             break;
         case ROW:
             m = createMatrix(1, a->row * a->col);
-            col = 0;
-            for(row = 0; row < a->row; col = (++row) * a->col) {
-                memcpy(m.entries[0]+col, a->entries[row], a->col * sizeof(double));
+            for(row = 0; row < a->row; row++) {
+                memcpy(m.entries + row * a->col, MATRIX_ROW(*a, row), a->col * sizeof(Real));
             }
             break;
         default:
@@ -285,20 +755,25 @@ void copyMatrix(Matrix src, Matrix dest)
 {
     if(!isValidMatrix(src)) throwInvalidArgs("src", NOT_A_MATRIX);
     if(!isValidMatrix(dest)) throwInvalidArgs("dest", NOT_A_MATRIX);
-    if(dest.col < src.col && dest.row < src.row)
+    if(dest.col < src.col || dest.row < src.row)
         throwInvalidArgs("", "Dimensions of source matrix must be equal or less than the dimensions of the dest matrix.");
 
     int row;
 
-    for(row = 0; row < dest.row; row++) {
-        memcpy(dest.entries[row], src.entries[row], src.col * sizeof(double));
+    for(row = 0; row < src.row; row++) {
+        memmove(MATRIX_ROW(dest, row), MATRIX_ROW(src, row), src.col * sizeof(Real));
         if(src.col < dest.col) {
-            memset(dest.entries[row]+src.col, 0, (dest.col - src.col) * sizeof(double));
+            memset(MATRIX_ROW(dest, row)+src.col, 0, (dest.col - src.col) * sizeof(Real));
         }
     }
+
+    // pad the remaining rows of dest with 0s
+    for(; row < dest.row; row++) {
+        memset(MATRIX_ROW(dest, row), 0, dest.col * sizeof(Real));
+    }
 }
 
-void copyArrToMatrix(double src[], int size, Matrix dest)
+void copyArrToMatrix(Real src[], int size, Matrix dest)
 {
     if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
     if(!isValidMatrix(dest)) throwInvalidArgs("dest", NOT_A_MATRIX);
@@ -310,22 +785,22 @@ void copyArrToMatrix(double src[], int size, Matrix dest)
     row = 0;
     for(idx = 0; idx < size && idx < mSize; idx = (++row) * dest.col) {
         noOfItems = size < idx + dest.col ? size - idx : dest.col;
-        memcpy(dest.entries[row], src+idx, noOfItems * sizeof(double));
+        memcpy(MATRIX_ROW(dest, row), src+idx, noOfItems * sizeof(Real));
     }
 
     if(idx < mSize) {
         // fill remaining spaces with 0 in the row if there is any
         row = row == 0 ? 0 : row - 1;
-        memset(dest.entries[row]+noOfItems, 0, (dest.col - noOfItems) * sizeof(double));
+        memset(MATRIX_ROW(dest, row)+noOfItems, 0, (dest.col - noOfItems) * sizeof(Real));
 
         // fill remaining rows with 0 if there is any
         for(row = row + 1; row < dest.row; row++) {
-            memset(dest.entries[row], 0, dest.col * sizeof(double));
+            memset(MATRIX_ROW(dest, row), 0, dest.col * sizeof(Real));
         }
     }
 }
 
-void copyMatrixToArr(Matrix src, double dest[], int size)
+void copyMatrixToArr(Matrix src, Real dest[], int size)
 {
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
     if(dest == NULL) throwInvalidArgs("dest", "It should not be null.");
@@ -337,12 +812,12 @@ void copyMatrixToArr(Matrix src, double dest[], int size)
     row = 0;
     for(idx = 0; idx < size && idx < mSize; idx = (++row) * src.col) {
         noOfItems = size < idx + src.col ? size - idx : src.col;
-        memcpy(dest+idx, src.entries[row], noOfItems * sizeof(double));
+        memcpy(dest+idx, MATRIX_ROW(src, row), noOfItems * sizeof(Real));
     }
 
     if(idx < size) {
         // fill remaining spaces with 0
         noOfItems = size - idx;
-        memset(dest+idx, 0, noOfItems * sizeof(double));
+        memset(dest+idx, 0, noOfItems * sizeof(Real));
     }
 }
\ No newline at end of file
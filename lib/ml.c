@@ -7,28 +7,85 @@
  *  in a neural network. It also allows users to train 
  *  Neural Network based on a dataset.
  *
- *  DEPENDENCIES: matrix, stats, neural_net 
+ *  DEPENDENCIES: arena, simd, rng, thread_pool, matrix, sparse, stats, neural_net, optim 
  *  
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No know bugs.
  */
 #include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include "headers/arena.h"
+#include "headers/simd.h"
+#include "headers/rng.h"
+#include "headers/thread_pool.h"
 #include "headers/matrix.h"
+#include "headers/sparse.h"
 #include "headers/stats.h"
 #include "headers/neural_net.h"
+#include "headers/optim.h"
 #include "headers/ml.h"
 
 #define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwMallocFailed() { fprintf(stderr, "Memory Allocation Failed."); exit(1); }
 #define SHOULD_NOT_BE_NULL "It should not be a null value."
 #define SHOULD_BE_POSITIVE "It should be a positive number."
 
+// Scratch memory of each thread. The arena holds the temporaries of a 
+// single training step, and is reset after it, while the pool keeps the 
+// buffers that live through a whole call for the calls after it. Both are
+// freed when the thread exits through the destructor of the key.
+static __thread Arena stepArena;
+static __thread MatrixPool bufferPool;
+static __thread int hasScratch;
+static pthread_key_t scratchKey;
+static pthread_once_t scratchKeyOnce = PTHREAD_ONCE_INIT;
+
+static void freeScratch(void *arg)
+{
+    freeArena(&stepArena);
+    freeMatrixPool(&bufferPool);
+    hasScratch = 0;
+}
+
+static void createScratchKey()
+{
+    pthread_key_create(&scratchKey, freeScratch);
+}
+
+static void claimScratch()
+{
+    if(!hasScratch) {
+        pthread_once(&scratchKeyOnce, createScratchKey);
+        pthread_setspecific(scratchKey, &hasScratch);
+        hasScratch = 1;
+    }
+}
+
+static Arena *getStepArena()
+{
+    claimScratch();
+    return &stepArena;
+}
+
+static MatrixPool *getBufferPool()
+{
+    claimScratch();
+    return &bufferPool;
+}
+
 void prepData(Data *data, MatrixAxis axis, TransformFunc transform)
 {
     if(axis != ROW && axis != COL) throwInvalidArgs("axis", "");
     if(transform == NULL) throwInvalidArgs("transform", SHOULD_NOT_BE_NULL);
 
     flatten(&data->inputValues, ROW);
-    transform(data->inputValues.entries[0], data->inputValues.col);
+    transform(data->inputValues.entries, data->inputValues.col);
+
+    data->sparseInputs = createSparseMatrix(data->inputValues);
+    if(getSparseDensity(data->sparseInputs) > SPARSE_INPUT_MAX_DENSITY) {
+        freeSparseMatrix(&data->sparseInputs);
+    }
 
     if(axis == COL) {
         transpose(&data->inputValues);
@@ -48,151 +105,701 @@ void prepDataset(Data dataset[], int size, MatrixAxis axis, TransformFunc transf
     }
 }
 
-// Returns the resulting matrix for each layer, as opposed to foward propagate
-// which only returns the resulting matrix of the last layer
-Matrix stagForwardProp(Data data, NeuralNetwork *nn, ActivationFunc activate)
+int toActivation(ActivationFunc activate, Activation *activation)
+{
+    if(activate == reLU) *activation = RELU;
+    else if(activate == sigmoid) *activation = SIGMOID;
+    else if(activate == tanh) *activation = TANH;
+    else return 0;
+
+    return 1;
+}
+
+// Adds a bias onto a matrix, and activates it. A built-in function runs 
+// on the vector kernels along with the bias in a single pass over the 
+// matrix, otherwise the function is called on each entry after the bias.
+static void biasActivateMatrix(Matrix m, Matrix bias, ActivationFunc activate)
+{
+    MatrixExpr expr = { 0 };
+    Activation activation;
+
+    if(toActivation(activate, &activation)) {
+        exprLoad(&expr, m);
+        exprLoad(&expr, bias);
+        exprAdd(&expr);
+        exprActivate(&expr, activation);
+        evalExprInto(&expr, m);
+    } else {
+        addInto(m, bias, m);
+        mapMatrix(m, activate);
+    }
+}
+
+// Feeds the resulting matrix of the previous layer through the next layer of a
+// traversal, and returns the resulting matrix of that layer, as opposed to forward 
+// propagate which only returns the resulting matrix of the last layer. The input
+// layer returns a copy of the inputs, and a finished traversal an empty matrix.
+Matrix stagForwardProp(Data data, Matrix prevData, LayerIterator *it, ActivationFunc activate)
 {
+    if(it == NULL) throwInvalidArgs("it", SHOULD_NOT_BE_NULL);
     if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
 
-    static int isFirst;
-    static Matrix prevData;
     Layer *layer;
-    Matrix res, weighted;
+    Matrix res;
 
-    if(nn != NULL) {
-        isFirst = 1;
-    }
+    layer = travNeuralNet(it, FORWARD);
+    if(layer == NULL) return createZeroMatrix();
 
-    layer = travNeuralNet(nn, FORWARD);
-    if(isFirst) {
+    if(it->pos == 1) {
         res = createMatrix(data.inputValues.row, data.inputValues.col);
         copyMatrix(data.inputValues, res);
-        isFirst = 0;
-    } else if(layer != NULL) {
-        weighted = dot(prevData, layer->weights);
-        res = add(weighted, layer->bias);
-        mapMatrix(res, activate);
+    } else {
+        // the weights of nodes oriented by column come before the data
+        res = prevData.col == layer->weights.row 
+            ? dot(prevData, layer->weights, NO_TRANS, NO_TRANS) 
+            : dot(layer->weights, prevData, NO_TRANS, NO_TRANS);
+        biasActivateMatrix(res, layer->bias, activate);
+    }
+
+    return res;
+}
+
+// Gets the shape of a buffer that can hold the result of any layer.
+static void getActivationBufferShape(NeuralNetwork nn, int *row, int *col)
+{
+    int pos, maxNodes;
+
+    maxNodes = 0;
+    for(pos = 1; pos <= nn.layers.size; pos++) {
+        if(getLayer(nn, pos).nodes > maxNodes) {
+            maxNodes = getLayer(nn, pos).nodes;
+        }
+    }
+
+    if(maxNodes == 0) throwInvalidArgs("nn", "It should have at least one layer.");
+
+    *row = nn.options.nodeOrient == COL ? maxNodes : 1;
+    *col = nn.options.nodeOrient == COL ? 1 : maxNodes;
+}
+
+Matrix createActivationBuffer(NeuralNetwork nn)
+{
+    int row, col;
+
+    getActivationBufferShape(nn, &row, &col);
+    return createMatrix(row, col);
+}
+
+static void acquireActivationBuffers(NeuralNetwork nn, Matrix buffers[2])
+{
+    int row, col;
+
+    getActivationBufferShape(nn, &row, &col);
+    buffers[0] = acquireMatrix(getBufferPool(), row, col);
+    buffers[1] = acquireMatrix(getBufferPool(), row, col);
+}
+
+static void releaseActivationBuffers(Matrix buffers[2])
+{
+    releaseMatrix(getBufferPool(), buffers);
+    releaseMatrix(getBufferPool(), buffers+1);
+}
+
+GemmActivation toGemmActivation(ActivationFunc activate)
+{
+    if(activate == reLU) return GEMM_RELU;
+    if(activate == sigmoid) return GEMM_SIGMOID;
+    if(activate == tanh) return GEMM_TANH;
+    return GEMM_CUSTOM;
+}
+
+void denseForwardInto(Matrix input, Layer layer, ActivationFunc activate, NodeOrientation orient, Matrix out)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(orient != ROW && orient != COL) throwInvalidArgs("orient", "");
 
-        freeMatrix(&weighted);
+    // row-oriented nodes are weighted as input . W, while 
+    // column-oriented nodes are weighted as W . input
+    if(orient == COL) {
+        dotFusedInto(layer.weights, input, NO_TRANS, NO_TRANS, layer.bias, toGemmActivation(activate), activate, out);
     } else {
-        res = createZeroMatrix();
+        dotFusedInto(input, layer.weights, NO_TRANS, NO_TRANS, layer.bias, toGemmActivation(activate), activate, out);
     }
+}
 
-    // keep track of the previous data
-    // after each forward prop, since it will be used
-    // in the next forward prop
-    prevData = res;
+void sparseForwardInto(SparseMatrix input, Layer layer, ActivationFunc activate, NodeOrientation orient, Matrix out)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(orient != ROW && orient != COL) throwInvalidArgs("orient", "");
 
-    return res;
+    // the input is a row either way, thus column-oriented nodes are 
+    // weighted as W . transpose(input)
+    if(orient == COL) {
+        dotSparseTransInto(layer.weights, input, out);
+    } else {
+        sparseDotInto(input, layer.weights, out);
+    }
+
+    biasActivateMatrix(out, layer.bias, activate);
 }
 
-Matrix forwardPropagate(Data data, NeuralNetwork nn, ActivationFunc activate)
+Matrix forwardPropagateInto(Data data, NeuralNetwork nn, ActivationFunc activate, Matrix buffers[2])
 {
     if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(buffers == NULL) throwInvalidArgs("buffers", SHOULD_NOT_BE_NULL);
 
-    int isFirst = 1;
+    int curr = 0, isFirst = 1;
+    LayerIterator it;
     Layer *layer;
-    Matrix res, weighted;
+    Matrix res, out;
 
     res = data.inputValues;
-    
-    weighted = createZeroMatrix();
-    layer = travNeuralNet(&nn, FORWARD);
+    it = iterNeuralNet(&nn, FORWARD);
+    // the input layer has no weights to feed the inputs through
+    travNeuralNet(&it, FORWARD);
+
+    while((layer = travNeuralNet(&it, FORWARD))) {
+        // each layer writes into the buffer that the previous one did not
+        out = nn.options.nodeOrient == COL 
+            ? getSubMatrix(buffers[curr], 0, 0, layer->nodes, 1)
+            : getSubMatrix(buffers[curr], 0, 0, 1, layer->nodes);
+
+        // only the first layer is fed the inputs, which may be sparse
+        if(isFirst && isSparseMatrix(data.sparseInputs)) {
+            sparseForwardInto(data.sparseInputs, *layer, activate, nn.options.nodeOrient, out);
+        } else {
+            denseForwardInto(res, *layer, activate, nn.options.nodeOrient, out);
+        }
 
-    while((layer = travNeuralNet(NULL, FORWARD))) {
-        weighted = dot(res, layer->weights);
+        res = out;
+        curr = !curr;
+        isFirst = 0;
+    }
 
-        // The first run of the loop res is data.inputValues
-        // It should not be freed only the succeeding ones
-        !isFirst ? freeMatrix(&res) : !isFirst;
-        res = add(weighted, layer->bias);
+    return res;
+}
 
-        mapMatrix(res, activate);
-        
-        // free weights before the next assignment
-        freeMatrix(&weighted);
-    }
+Matrix forwardPropagate(Data data, NeuralNetwork nn, ActivationFunc activate)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+
+    Matrix buffers[2], out, res;
+
+    acquireActivationBuffers(nn, buffers);
+
+    out = forwardPropagateInto(data, nn, activate, buffers);
+    res = createMatrix(out.row, out.col);
+    copyMatrix(out, res);
+
+    releaseActivationBuffers(buffers);
 
     return res;
 }
 
+void valToMatrixInto(int val, Matrix dest)
+{
+    if(0 > val || val >= dest.row * dest.col)
+        throwInvalidArgs("val", "It should be less than the number of output layer nodes and greater than 0.")
+
+    fillMatrix(dest, 0);
+    if(dest.row == 1) {
+        MATRIX_AT(dest, 0, val) = 1;
+    } else {
+        MATRIX_AT(dest, val, 0) = 1;
+    }
+}
+
 Matrix valToMatrix(int val, int outputNodes, MatrixAxis axis)
 {
     if(axis != ROW && axis != COL) throwInvalidArgs("axis", ""); 
-    if(0 > val || val > outputNodes)
-        throwInvalidArgs("val", "It should be less than the number of output layer nodes and greater than 0.")
     
     Matrix res;
     
-    res = createMatrix(1, outputNodes);
-    fillMatrix(res, 0);
-    res.entries[0][val] = 1;
+    res = axis == COL ? createMatrix(outputNodes, 1) : createMatrix(1, outputNodes);
+    valToMatrixInto(val, res);
 
-    if(axis == COL) {
-        transpose(&res);
+    return res;
+}
+
+// Gets a matrix for the values of a layer over a batch, with one sample 
+// per row for row nodes, or one sample per column for column nodes.
+static Matrix acquireBatchMatrix(int nodes, int size, NodeOrientation orient)
+{
+    return orient == COL ? acquireMatrix(getBufferPool(), nodes, size) : acquireMatrix(getBufferPool(), size, nodes);
+}
+
+// Stacks the nonzero inputs of a batch into a single sparse matrix, with one 
+// sample per row, drawn from the step arena. The matrix is left empty if any 
+// of the data has no sparse inputs, thus the dense inputs are used instead.
+static SparseMatrix stackSparseInputs(Data *batch[], int size)
+{
+    SparseMatrix res = { 0 }, inputs;
+    int idx, nnz;
+
+    nnz = 0;
+    for(idx = 0; idx < size; idx++) {
+        if(!isSparseMatrix(batch[idx]->sparseInputs)) return res;
+        nnz += batch[idx]->sparseInputs.nnz;
+    }
+
+    res.row = size;
+    res.col = batch[0]->sparseInputs.col;
+    res.nnz = nnz;
+    res.rowStarts = (int *) arenaAlloc(getStepArena(), (size + 1) * sizeof(int), sizeof(int));
+    res.colIndices = (int *) arenaAlloc(getStepArena(), (nnz + 1) * sizeof(int), sizeof(int));
+    res.values = (Real *) arenaAlloc(getStepArena(), (nnz + 1) * sizeof(Real), MATRIX_ALIGNMENT);
+
+    res.rowStarts[0] = 0;
+    for(idx = 0; idx < size; idx++) {
+        inputs = batch[idx]->sparseInputs;
+        memcpy(res.colIndices + res.rowStarts[idx], inputs.colIndices, inputs.nnz * sizeof(int));
+        memcpy(res.values + res.rowStarts[idx], inputs.values, inputs.nnz * sizeof(Real));
+        res.rowStarts[idx + 1] = res.rowStarts[idx] + inputs.nnz;
     }
 
     return res;
 }
 
+// Adds the bias of a layer onto its values over a batch, where the bias is 
+// a row added to every row for row nodes, or a column added to every column 
+// for column nodes.
+static void addBatchBias(Matrix m, Matrix bias, NodeOrientation orient)
+{
+    int row, col;
+
+    if(orient == ROW) {
+        addInto(m, bias, m);
+        return;
+    }
+
+    for(row = 0; row < m.row; row++) {
+        for(col = 0; col < m.col; col++) {
+            MATRIX_AT(m, row, col) += MATRIX_AT(bias, row, 0);
+        }
+    }
+}
+
+// Feeds a batch through every layer, keeping the values of each layer before 
+// (z) and after (a) they are activated for the backward pass. The dense inputs 
+// are stacked one sample per row for either orientation, thus column nodes 
+// are weighted by their transpose.
+static void batchForward(NeuralNetwork nn, Activation activation, Matrix inputs, SparseMatrix sparseInputs, Matrix z[], Matrix a[])
+{
+    NodeOrientation orient = nn.options.nodeOrient;
+    GemmTranspose transPrev;
+    Matrix prev;
+    Layer layer;
+    int pos;
+
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        layer = getLayer(nn, pos);
+        prev = pos == 2 ? inputs : a[pos - 2];
+        transPrev = pos == 2 && orient == COL ? TRANS : NO_TRANS;
+
+        if(pos == 2 && isSparseMatrix(sparseInputs)) {
+            if(orient == COL) {
+                dotSparseTransInto(layer.weights, sparseInputs, z[pos - 1]);
+            } else {
+                sparseDotInto(sparseInputs, layer.weights, z[pos - 1]);
+            }
+            addBatchBias(z[pos - 1], layer.bias, orient);
+        } else if(orient == COL) {
+            dotFusedInto(layer.weights, prev, NO_TRANS, transPrev, layer.bias, GEMM_IDENTITY, NULL, z[pos - 1]);
+        } else {
+            dotFusedInto(prev, layer.weights, NO_TRANS, NO_TRANS, layer.bias, GEMM_IDENTITY, NULL, z[pos - 1]);
+        }
+
+        activateInto(z[pos - 1], activation, a[pos - 1]);
+    }
+}
+
+// Propagates the error of the outputs of a batch back through every layer, and 
+// stores the gradients of the parameters in a buffer laid out like them. The 
+// error of each layer replaces its values before activation (z), since they 
+// are no longer needed once the error of the layer before it is found.
+static void batchBackward(NeuralNetwork nn, Activation activation, Data *batch[], int size, Matrix inputs, SparseMatrix sparseInputs, Matrix z[], Matrix a[], Matrix grad)
+{
+    NodeOrientation orient = nn.options.nodeOrient;
+    MatrixExpr expr = { 0 };
+    Matrix expected, ones, prev, prevErr, delta;
+    Layer layer, gradLayer;
+    int pos, idx, outputs;
+
+    outputs = getLayer(nn, nn.layers.size).nodes;
+    expected = acquireBatchMatrix(outputs, size, orient);
+    ones = acquireMatrix(getBufferPool(), 1, size);
+    fillMatrix(expected, 0);
+    fillMatrix(ones, 1);
+    for(idx = 0; idx < size; idx++) {
+        valToMatrixInto(batch[idx]->expVal, orient == COL ? getSubMatrix(expected, 0, idx, outputs, 1) : getRowRange(expected, idx, 1));
+    }
+
+    // the error of the outputs is the derivative of the sum of squared 
+    // residuals, 2 * (a - expected) * f'(z)
+    delta = z[nn.layers.size - 1];
+    exprLoad(&expr, a[nn.layers.size - 1]);
+    exprLoad(&expr, expected);
+    exprSubtract(&expr);
+    exprScale(&expr, 2.0);
+    exprLoad(&expr, delta);
+    exprActivatePrime(&expr, activation);
+    exprMultiply(&expr);
+    evalExprInto(&expr, delta);
+
+    for(pos = nn.layers.size; pos >= 2; pos--) {
+        layer = getLayer(nn, pos);
+        gradLayer = viewLayerParams(nn, grad, pos);
+        delta = z[pos - 1];
+        prev = pos == 2 ? inputs : a[pos - 2];
+
+        // the gradient of the weights sums the outer products of every sample,
+        // as a single product of the batches of errors and inputs
+        if(pos == 2 && isSparseMatrix(sparseInputs)) {
+            fillMatrix(gradLayer.weights, 0);
+            if(orient == COL) {
+                dotSparseAxpy(1, delta, sparseInputs, gradLayer.weights);
+            } else {
+                sparseTransDotAxpy(1, sparseInputs, delta, gradLayer.weights);
+            }
+        } else if(orient == COL) {
+            dotInto(delta, prev, NO_TRANS, pos == 2 ? NO_TRANS : TRANS, gradLayer.weights);
+        } else {
+            dotInto(prev, delta, TRANS, NO_TRANS, gradLayer.weights);
+        }
+
+        // the gradient of the bias sums the errors of every sample
+        if(orient == COL) {
+            dotInto(delta, createMatrixView(ones.entries, size, 1, 1), NO_TRANS, NO_TRANS, gradLayer.bias);
+        } else {
+            dotInto(ones, delta, NO_TRANS, NO_TRANS, gradLayer.bias);
+        }
+
+        if(pos == 2) break;
+
+        // the error of the previous layer is W' . delta * f'(z)
+        prevErr = acquireBatchMatrix(getLayer(nn, pos - 1).nodes, size, orient);
+        if(orient == COL) {
+            dotInto(layer.weights, delta, TRANS, NO_TRANS, prevErr);
+        } else {
+            dotInto(delta, layer.weights, NO_TRANS, TRANS, prevErr);
+        }
+
+        expr = (MatrixExpr) { 0 };
+        exprLoad(&expr, prevErr);
+        exprLoad(&expr, z[pos - 2]);
+        exprActivatePrime(&expr, activation);
+        exprMultiply(&expr);
+        evalExprInto(&expr, z[pos - 2]);
+
+        releaseMatrix(getBufferPool(), &prevErr);
+    }
+
+    releaseMatrix(getBufferPool(), &expected);
+    releaseMatrix(getBufferPool(), &ones);
+}
+
+// Computes the gradients of the parameters over a batch, summed over every
+// sample, and stores them in a buffer laid out like the parameters.
+static void computeBatchGradient(NeuralNetwork nn, Activation activation, Data *batch[], int size, Matrix grad)
+{
+    NodeOrientation orient = nn.options.nodeOrient;
+    Matrix z[nn.layers.size], a[nn.layers.size], inputs;
+    SparseMatrix sparseInputs;
+    int pos, idx, inputNodes;
+
+    // the inputs of the batch are gathered from wherever its samples are, 
+    // and stacked into a single matrix, one sample per row, either as their 
+    // nonzero entries, or as all of them
+    inputNodes = getLayer(nn, 1).nodes;
+    inputs = createZeroMatrix();
+    sparseInputs = stackSparseInputs(batch, size);
+    if(!isSparseMatrix(sparseInputs)) {
+        inputs = acquireMatrix(getBufferPool(), size, inputNodes);
+        for(idx = 0; idx < size; idx++) {
+            copyMatrixToArr(batch[idx]->inputValues, MATRIX_ROW(inputs, idx), inputNodes);
+        }
+    }
+
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        z[pos - 1] = acquireBatchMatrix(getLayer(nn, pos).nodes, size, orient);
+        a[pos - 1] = acquireBatchMatrix(getLayer(nn, pos).nodes, size, orient);
+    }
+
+    batchForward(nn, activation, inputs, sparseInputs, z, a);
+    batchBackward(nn, activation, batch, size, inputs, sparseInputs, z, a, grad);
+
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        releaseMatrix(getBufferPool(), z + pos - 1);
+        releaseMatrix(getBufferPool(), a + pos - 1);
+    }
+    if(!isSparseMatrix(sparseInputs)) {
+        releaseMatrix(getBufferPool(), &inputs);
+    }
+
+    resetArena(getStepArena());
+}
+
+// Draws a new random order of the samples of a dataset, as pointers to them, 
+// thus the batches are gathered through it without moving the data around.
+static Data **shuffleDataset(Data dataset[], int size)
+{
+    Data **samples = (Data **) malloc(size * sizeof(Data *));
+    int *order = (int *) malloc(size * sizeof(int));
+    Rng rng = createShuffleRng();
+    int idx;
+
+    if(samples == NULL || order == NULL) throwMallocFailed();
+
+    for(idx = 0; idx < size; idx++) {
+        order[idx] = idx;
+    }
+    rngShuffle(&rng, order, size);
+    for(idx = 0; idx < size; idx++) {
+        samples[idx] = dataset + order[idx];
+    }
+
+    free(order);
+    return samples;
+}
+
+// The argument shared by the tasks that train on the shards of a batch.
+typedef struct ShardTask {
+    NeuralNetwork nn;
+    Activation activation;
+    // The samples of the batch, as pointers into the dataset.
+    Data **batch;
+    int size;
+    int shards;
+    // The gradients of each shard, one per row, where every row starts
+    // on a cache line of its own, thus the threads never share one.
+    Matrix grads;
+    // The distance between the rows that are summed, on each level of
+    // the reduction.
+    int step;
+} ShardTask;
+
+static void computeShardGradient(void *arg, int task)
+{
+    ShardTask *shard = (ShardTask *) arg;
+    int start, end;
+
+    start = (long) shard->size * task / shard->shards;
+    end = (long) shard->size * (task + 1) / shard->shards;
+    computeBatchGradient(shard->nn, shard->activation, shard->batch + start, end - start, getRowRange(shard->grads, task, 1));
+}
+
+static void reduceShardGradients(void *arg, int task)
+{
+    ShardTask *shard = (ShardTask *) arg;
+    Real *dest = MATRIX_ROW(shard->grads, task * 2 * shard->step);
+
+    vecAdd(dest, dest + (long) shard->step * shard->grads.stride, dest, shard->grads.col);
+}
+
 void networkTrain(NeuralNetwork nn, ActivationFunc activate, int batchSize, Data dataset[], int size)
 {
+    Optimizer optimizer = createOptimizer(SGD, nn);
+
+    networkTrainWithOptimizer(nn, activate, batchSize, dataset, size, &optimizer);
+    freeOptimizer(&optimizer);
+}
+
+void networkTrainWithOptimizer(NeuralNetwork nn, ActivationFunc activate, int batchSize, Data dataset[], int size, Optimizer *optimizer)
+{
+    if(optimizer == NULL) throwInvalidArgs("optimizer", SHOULD_NOT_BE_NULL);
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
+    if(batchSize <= 0) throwInvalidArgs("batchSize", SHOULD_BE_POSITIVE);
     if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
 
-    Matrix obs[batchSize], exp[batchSize];
-    Matrix diff, buffer, step;
-    Layer layer;
-    int idx, batch;
+    ShardTask shard = { .nn = nn, .size = batchSize };
+    Data **samples;
+    int start;
+
+    if(!toActivation(activate, &shard.activation)) throwInvalidArgs("activate", "It should be sigmoid, reLU, or tanh, whose derivatives are known.");
+
+    // each thread trains on a shard of every batch, unless the shards 
+    // would be too small to be worth waiting on each other for
+    shard.shards = batchSize / TRAIN_MIN_SHARD_SIZE < getThreadCount() ? batchSize / TRAIN_MIN_SHARD_SIZE : getThreadCount();
+    if(shard.shards < 1) shard.shards = 1;
 
-    // We are just updating the last set of biases for now
-    layer = getLayer(nn, nn.layers.size);
+    // the gradients are laid out like the parameters, thus the whole network
+    // is updated in a single pass, and the gaps between them stay zero
+    shard.grads = acquireMatrix(getBufferPool(), shard.shards, nn.params.col);
+    fillMatrix(shard.grads, 0);
 
-    for(batch = 1; batch <= size / batchSize; batch++) {
-        // get expected and observed values
-        for(idx = 0; idx < batchSize; idx++) {
-            obs[idx] = forwardPropagate(dataset[idx], nn, activate);
-            exp[idx] = valToMatrix(dataset[idx].expVal, layer.nodes, nn.options.nodeOrient);
+    samples = shuffleDataset(dataset, size);
+    for(start = 0; start + batchSize <= size; start += batchSize) {
+        shard.batch = samples + start;
+
+        if(shard.shards == 1) {
+            computeBatchGradient(nn, shard.activation, shard.batch, batchSize, shard.grads);
+        } else {
+            parallelFor(shard.shards, computeShardGradient, &shard);
+
+            // the gradients of the shards are summed pairwise into the first 
+            // row, in the same order whichever threads computed them
+            for(shard.step = 1; shard.step < shard.shards; shard.step *= 2) {
+                parallelFor((shard.shards + shard.step - 1) / (2 * shard.step), reduceShardGradients, &shard);
+            }
         }
 
-        // backward propagate
-        buffer = ssrPrime(obs, exp, batchSize);
-        step = scale(buffer, nn.options.lr);
-        diff = subtract(layer.bias, step);
-        // update biases
-        copyMatrix(diff, layer.bias);
-
-        // cleanup
-        freeMatrix(&buffer);
-        freeMatrix(&step);
-        freeMatrix(&diff);
-        for(idx = 0; idx < batchSize; idx++) {
-            freeMatrix(obs+idx);
-            freeMatrix(exp+idx);
+        optimizerStep(optimizer, nn.params, getRowRange(shard.grads, 0, 1));
+    }
+
+    releaseMatrix(getBufferPool(), &shard.grads);
+    free(samples);
+}
+
+// The argument shared by the workers of an asynchronous training run.
+typedef struct HogwildTask {
+    NeuralNetwork nn;
+    Activation activation;
+    // The samples of the dataset, in the order they are trained in.
+    Data **samples;
+    int batchSize;
+    int batches;
+    int maxStaleness;
+    // The next batch that is left, taken by whichever worker is free.
+    int nextBatch;
+    // The number of updates applied onto the parameters so far.
+    long updates;
+    long staleGradients;
+} HogwildTask;
+
+// Applies the gradients of a batch straight onto the shared parameters. If 
+// every sample has sparse inputs, the weights of the first layer are only 
+// written for the inputs that are nonzero in the batch, since the others have 
+// no gradient, thus workers training on different pixels rarely write onto 
+// the same cache lines.
+static void applyHogwildGradient(NeuralNetwork nn, Matrix grad, Data *batch[], int size)
+{
+    int inputs = getLayer(nn, 1).nodes;
+    int activeInputs[inputs], active, pos, idx, entry, row;
+    unsigned char isActive[inputs];
+    double lr = nn.options.lr;
+    SparseMatrix sparseInputs;
+    Layer layer, gradLayer;
+
+    active = 0;
+    memset(isActive, 0, inputs);
+    for(idx = 0; idx < size && active >= 0; idx++) {
+        sparseInputs = batch[idx]->sparseInputs;
+        if(!isSparseMatrix(sparseInputs)) {
+            active = -1;
+            break;
+        }
+
+        for(entry = 0; entry < sparseInputs.nnz; entry++) {
+            if(!isActive[sparseInputs.colIndices[entry]]) {
+                isActive[sparseInputs.colIndices[entry]] = 1;
+                activeInputs[active++] = sparseInputs.colIndices[entry];
+            }
+        }
+    }
+
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        layer = getLayer(nn, pos);
+        gradLayer = viewLayerParams(nn, grad, pos);
+        axpy(-1 * lr, gradLayer.bias, layer.bias);
+
+        if(pos > 2 || active < 0) {
+            axpy(-1 * lr, gradLayer.weights, layer.weights);
+        } else if(nn.options.nodeOrient == COL) {
+            for(row = 0; row < layer.weights.row; row++) {
+                for(idx = 0; idx < active; idx++) {
+                    MATRIX_AT(layer.weights, row, activeInputs[idx]) -= lr * MATRIX_AT(gradLayer.weights, row, activeInputs[idx]);
+                }
+            }
+        } else {
+            for(idx = 0; idx < active; idx++) {
+                vecAxpy(-1 * lr, MATRIX_ROW(gradLayer.weights, activeInputs[idx]), MATRIX_ROW(layer.weights, activeInputs[idx]), layer.nodes);
+            }
         }
     }
 }
 
+static void runHogwildWorker(void *arg, int task)
+{
+    HogwildTask *hogwild = (HogwildTask *) arg;
+    Matrix grad;
+    Data **batch;
+    long seen;
+    int index, isStale;
+
+    (void) task;
+    grad = acquireMatrix(getBufferPool(), 1, hogwild->nn.params.col);
+    fillMatrix(grad, 0);
+
+    while(1) {
+        index = __atomic_fetch_add(&hogwild->nextBatch, 1, __ATOMIC_RELAXED);
+        if(index >= hogwild->batches) break;
+        batch = hogwild->samples + (long) index * hogwild->batchSize;
+
+        // the parameters are read while the other workers write onto them,
+        // and a gradient that is too many updates behind is computed again
+        do {
+            seen = __atomic_load_n(&hogwild->updates, __ATOMIC_ACQUIRE);
+            computeBatchGradient(hogwild->nn, hogwild->activation, batch, hogwild->batchSize, grad);
+
+            isStale = hogwild->maxStaleness > 0 && __atomic_load_n(&hogwild->updates, __ATOMIC_ACQUIRE) - seen > hogwild->maxStaleness;
+            if(isStale) __atomic_add_fetch(&hogwild->staleGradients, 1, __ATOMIC_RELAXED);
+        } while(isStale);
+
+        applyHogwildGradient(hogwild->nn, grad, batch, hogwild->batchSize);
+        __atomic_add_fetch(&hogwild->updates, 1, __ATOMIC_RELEASE);
+    }
+
+    releaseMatrix(getBufferPool(), &grad);
+}
+
+long networkTrainHogwild(NeuralNetwork nn, ActivationFunc activate, int batchSize, Data dataset[], int size, int maxStaleness)
+{
+    if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
+    if(batchSize <= 0) throwInvalidArgs("batchSize", SHOULD_BE_POSITIVE);
+    if(maxStaleness < 0) throwInvalidArgs("maxStaleness", "It should be a non-negative integer.");
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    HogwildTask hogwild = {
+        .nn = nn,
+        .samples = shuffleDataset(dataset, size),
+        .batchSize = batchSize,
+        .batches = size / batchSize,
+        .maxStaleness = maxStaleness
+    };
+
+    if(!toActivation(activate, &hogwild.activation)) throwInvalidArgs("activate", "It should be sigmoid, reLU, or tanh, whose derivatives are known.");
+
+    // each thread of the pool is a worker, which trains until no batch is left
+    parallelFor(getThreadCount(), runHogwildWorker, &hogwild);
+    free(hogwild.samples);
+
+    return hogwild.staleGradients;
+}
+
 double networkTest(NeuralNetwork nn, ActivationFunc activate, Data dataset[], int size)
 {
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
     if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
     
     int idx, resVal, correctItems;
-    Matrix res;
+    Matrix res, buffers[2];
+
+    acquireActivationBuffers(nn, buffers);
 
     correctItems = 0;
     for(idx = 0; idx < size; idx++) {
-        res = forwardPropagate(dataset[idx], nn, activate);
+        res = forwardPropagateInto(dataset[idx], nn, activate, buffers);
         resVal = evalResult(res);
 
         if(resVal == dataset[idx].expVal) {
             correctItems++;
         }
-
-        freeMatrix(&res);
     }
 
+    releaseActivationBuffers(buffers);
+
     return (double) correctItems / size;
 }
 
@@ -206,7 +813,7 @@ int evalResult(Matrix m)
     maxCol = 0;
     for(row = 0; row < m.row; row++) {
         for(col = 0; col < m.col; col++) {
-            if(m.entries[row][col] > m.entries[maxRow][maxCol]) {
+            if(MATRIX_AT(m, row, col) > MATRIX_AT(m, maxRow, maxCol)) {
                 maxRow = row;
                 maxCol = col;
             }
@@ -248,25 +855,32 @@ double tanhPrime(double val)
 
 Matrix ssrPrime(Matrix obs[], Matrix exp[], int size)
 {
-    Matrix diff, sum, buffer;
-    int idx;
+    if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
 
-    sum = createZeroMatrix();
-    for(idx = 0; idx < size; idx++) {
-        diff = subtract(exp[idx], obs[idx]);
+    Matrix res = createMatrix(obs[0].row, obs[0].col);
+    ssrPrimeInto(obs, exp, size, res);
 
-        if(isZeroMatrix(sum)) {
-            sum = diff;
-        } else {
-            buffer = add(sum, diff);
-            freeMatrix(&sum);
-            sum = buffer;
-            freeMatrix(&diff);
-        }
-    }
+    return res;
+}
 
-    buffer = scale(sum, -2.0);
-    freeMatrix(&sum);
+void ssrPrimeInto(Matrix obs[], Matrix exp[], int size, Matrix out)
+{
+    if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
 
-    return buffer;
+    MatrixExpr expr;
+    int idx;
+
+    // accumulates -2 * sum(exp - obs) directly onto out, as out + 2 * (obs - exp)
+    // in a single pass per item
+    fillMatrix(out, 0);
+    for(idx = 0; idx < size; idx++) {
+        expr = (MatrixExpr) { 0 };
+        exprLoad(&expr, out);
+        exprLoad(&expr, obs[idx]);
+        exprLoad(&expr, exp[idx]);
+        exprSubtract(&expr);
+        exprScale(&expr, 2.0);
+        exprAdd(&expr);
+        evalExprInto(&expr, out);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,261 @@
+/** @file model_file.c
+ *  @brief A library made for saving neural networks into files,
+ *  and mapping them back into memory.
+ *
+ *  This library contains functions which save the options, layer
+ *  sizes, and parameters of a neural network into a versioned model
+ *  file with checksums. The files are mapped rather than read, and
+ *  the layers of the loaded neural network point straight at the
+ *  mapped parameters, thus nothing is copied when a model is loaded.
+ *
+ *  DEPENDENCIES: matrix, neural_net
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "headers/matrix.h"
+#include "headers/neural_net.h"
+#include "headers/model_file.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwInvalidModelFile(msg) { fprintf(stderr, "Invalid Model File. %s", msg); exit(1); }
+#define throwFileFailed(msg) { fprintf(stderr, "Model File Operation Failed. %s", msg); exit(1); }
+#define SHOULD_NOT_BE_NULL "It should not be a null value."
+
+#define MODEL_FILE_MAGIC "MNISTNN"
+#define MODEL_FILE_BYTE_ORDER 0x01020304u
+// The reflected polynomial of CRC-32C.
+#define CRC32C_POLY 0x82f63b78u
+
+_Static_assert(sizeof(ModelFileHeader) == 88, "The header should have no padding, so that it can be checksummed.");
+
+static uint32_t crcTable[256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+static void createCrcTable()
+{
+    uint32_t crc;
+    int byte, bit;
+
+    for(byte = 0; byte < 256; byte++) {
+        crc = byte;
+        for(bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crcTable[byte] = crc;
+    }
+}
+
+static uint32_t scalarCrc32c(uint32_t crc, const uint8_t *data, size_t size)
+{
+    size_t idx;
+
+    pthread_once(&crcTableOnce, createCrcTable);
+    for(idx = 0; idx < size; idx++) {
+        crc = crcTable[(crc ^ data[idx]) & 0xff] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+#ifdef HAS_X86_KERNELS
+#pragma GCC push_options
+#pragma GCC target("sse4.2")
+static uint32_t sse42Crc32c(uint32_t crc, const uint8_t *data, size_t size)
+{
+    uint64_t crc64 = crc, chunk;
+    size_t idx;
+
+    // eight bytes are taken at once, and the bytes left over one at a time
+    for(idx = 0; idx + 8 <= size; idx += 8) {
+        memcpy(&chunk, data + idx, 8);
+        crc64 = _mm_crc32_u64(crc64, chunk);
+    }
+    crc = (uint32_t) crc64;
+    for(; idx < size; idx++) {
+        crc = _mm_crc32_u8(crc, data[idx]);
+    }
+
+    return crc;
+}
+#pragma GCC pop_options
+#endif
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t size)
+{
+    if(data == NULL && size > 0) throwInvalidArgs("data", SHOULD_NOT_BE_NULL);
+
+    crc = ~crc;
+#ifdef HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse4.2")) {
+        return ~sse42Crc32c(crc, (const uint8_t *) data, size);
+    }
+#endif
+
+    return ~scalarCrc32c(crc, (const uint8_t *) data, size);
+}
+
+// Rounds an offset of the file up to where an aligned matrix can start.
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+}
+
+// Computes the checksum of a header, along with the node sizes that follow it.
+static uint32_t getHeaderChecksum(ModelFileHeader header, const int32_t *sizes)
+{
+    header.headerChecksum = 0;
+
+    return crc32c(crc32c(0, &header, sizeof(header)), sizes, header.layerCount * sizeof(int32_t));
+}
+
+void saveNeuralNet(NeuralNetwork nn, const char *fileName)
+{
+    if(fileName == NULL) throwInvalidArgs("fileName", SHOULD_NOT_BE_NULL);
+    if(nn.layers.size <= 0) throwInvalidArgs("nn", "It should have at least one layer.");
+
+    ModelFileHeader header = {
+        .magic = MODEL_FILE_MAGIC,
+        .version = MODEL_FILE_VERSION,
+        .byteOrder = MODEL_FILE_BYTE_ORDER,
+        .realSize = sizeof(Real),
+        .nodeOrient = nn.options.nodeOrient,
+        .distStrat = nn.options.distStrat,
+        .layerCount = nn.layers.size,
+        .distSize = nn.options.distSize,
+        .initialBias = nn.options.initialBias,
+        .lr = nn.options.lr,
+        .seed = nn.options.seed,
+        .paramCount = nn.params.col
+    };
+    char tempName[strlen(fileName) + 5], padding[MATRIX_ALIGNMENT] = { 0 };
+    int32_t sizes[nn.layers.size];
+    size_t paramBytes, paddingBytes;
+    FILE *fp;
+    int pos, isWritten;
+
+    for(pos = 1; pos <= nn.layers.size; pos++) {
+        sizes[pos - 1] = getLayer(nn, pos).nodes;
+    }
+
+    paramBytes = header.paramCount * sizeof(Real);
+    header.paramsOffset = alignOffset(sizeof(header) + sizeof(sizes));
+    header.paramsChecksum = crc32c(0, nn.params.entries, paramBytes);
+    header.headerChecksum = getHeaderChecksum(header, sizes);
+
+    sprintf(tempName, "%s.tmp", fileName);
+    fp = fopen(tempName, "wb");
+    if(fp == NULL) throwFileFailed("Unable to open file.");
+
+    // blocks are written in bytes, so that an empty one counts as written
+    paddingBytes = header.paramsOffset - sizeof(header) - sizeof(sizes);
+    isWritten = fwrite(&header, sizeof(header), 1, fp) == 1
+        && fwrite(sizes, sizeof(sizes), 1, fp) == 1
+        && fwrite(padding, 1, paddingBytes, fp) == paddingBytes
+        && (paramBytes == 0 || fwrite(nn.params.entries, 1, paramBytes, fp) == paramBytes);
+
+    if(fclose(fp) != 0 || !isWritten) {
+        remove(tempName);
+        throwFileFailed("Unable to write file.");
+    }
+    if(rename(tempName, fileName) != 0) {
+        remove(tempName);
+        throwFileFailed("Unable to replace file.");
+    }
+}
+
+MappedNeuralNet mapNeuralNet(const char *fileName, int verifyParams)
+{
+    if(fileName == NULL) throwInvalidArgs("fileName", SHOULD_NOT_BE_NULL);
+
+    MappedNeuralNet model;
+    ModelFileHeader header;
+    NeuralNetOpt opt;
+    struct stat info;
+    uint8_t *addr;
+    int32_t *sizes;
+    uint64_t paramsEnd;
+    int fd, pos;
+
+    fd = open(fileName, O_RDONLY);
+    if(fd < 0) throwFileFailed("Unable to open file.");
+    if(fstat(fd, &info) != 0) throwFileFailed("Unable to read file.");
+    if((size_t) info.st_size < sizeof(header)) throwInvalidModelFile("It is too small to hold a header.");
+
+    // the pages are private, thus writes to the parameters never reach the file
+    addr = (uint8_t *) mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED) throwFileFailed("Unable to map file.");
+
+    memcpy(&header, addr, sizeof(header));
+    if(memcmp(header.magic, MODEL_FILE_MAGIC, sizeof(header.magic)) != 0) throwInvalidModelFile("It is not a model file.");
+    if(header.byteOrder != MODEL_FILE_BYTE_ORDER) throwInvalidModelFile("It was saved on a machine with another byte order.");
+    if(header.version != MODEL_FILE_VERSION) throwInvalidModelFile("It was saved with another version of the format.");
+    if(header.realSize != sizeof(Real)) throwInvalidModelFile("It was saved with another PRECISION.");
+    if(header.layerCount == 0 || header.layerCount > (info.st_size - sizeof(header)) / sizeof(int32_t)) {
+        throwInvalidModelFile("It has an invalid number of layers.");
+    }
+
+    sizes = (int32_t *) (addr + sizeof(header));
+    if(getHeaderChecksum(header, sizes) != header.headerChecksum) throwInvalidModelFile("The checksum of its header does not match.");
+
+    opt = (NeuralNetOpt) {
+        .nodeOrient = (NodeOrientation) header.nodeOrient,
+        .distStrat = (DistStrategy) header.distStrat,
+        .distSize = header.distSize,
+        .initialBias = header.initialBias,
+        .lr = header.lr,
+        .seed = header.seed,
+        .layerSizes = (int *) sizes,
+        .neuralNetSize = header.layerCount
+    };
+    for(pos = 0; pos < opt.neuralNetSize; pos++) {
+        if(sizes[pos] <= 0) throwInvalidModelFile("It has a layer without nodes.");
+    }
+    if(!isValidNeuralNetOpt(opt) || getParamCount(opt) != (long) header.paramCount) {
+        throwInvalidModelFile("Its options do not match its parameters.");
+    }
+
+    paramsEnd = header.paramsOffset + header.paramCount * sizeof(Real);
+    if(header.paramsOffset % MATRIX_ALIGNMENT != 0 || header.paramsOffset < sizeof(header) + header.layerCount * sizeof(int32_t)) {
+        throwInvalidModelFile("Its parameters are misplaced.");
+    }
+    if(paramsEnd > (uint64_t) info.st_size) throwInvalidModelFile("It is truncated.");
+    if(verifyParams && crc32c(0, addr + header.paramsOffset, header.paramCount * sizeof(Real)) != header.paramsChecksum) {
+        throwInvalidModelFile("The checksum of its parameters does not match.");
+    }
+
+    model.addr = addr;
+    model.size = info.st_size;
+    model.nn = viewNeuralNet(opt, header.paramCount > 0
+        ? createMatrixView((Real *) (addr + header.paramsOffset), 1, header.paramCount, header.paramCount)
+        : createZeroMatrix());
+
+    return model;
+}
+
+void unmapNeuralNet(MappedNeuralNet *model)
+{
+    if(model == NULL) throwInvalidArgs("model", SHOULD_NOT_BE_NULL);
+
+    freeNeuralNet(&model->nn);
+    if(model->addr != NULL) {
+        munmap(model->addr, model->size);
+    }
+    model->addr = NULL;
+    model->size = 0;
+}
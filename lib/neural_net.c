@@ -4,9 +4,11 @@
  * 
  *  This library contains various functions which allows
  *  users to create neural networks. It also has functions
- *  for creating, deleting, and inserting layers. 
+ *  for creating, deleting, and inserting layers. The layers
+ *  are kept in an array, and their weights and biases are 
+ *  views into a single buffer of parameters.
  *  
- *  DEPENDENCIES: matrix, doubly_ll
+ *  DEPENDENCIES: matrix, rng
  * 
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No know bugs.
@@ -14,8 +16,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include "headers/matrix.h"
-#include "headers/doubly_ll.h"
+#include "headers/rng.h"
 #include "headers/neural_net.h"
 
 #define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
@@ -24,24 +27,8 @@
 #define SHOULD_BE_NON_NEGATIVE "It should be a non-negative integer."
 #define INVALID_NEURAL_NET_OPT "Neural Network Options contain invalid values."
 
-NeuralNetwork createNeuralNet(NeuralNetOpt opt)
-{
-    if(!isValidNeuralNetOpt(opt)) throwInvalidArgs("opt", INVALID_NEURAL_NET_OPT);
-    
-    int idx;
-    NeuralNetwork nn = { 
-        .options = opt,
-        .layers = createList()
-    };
-    
-    if(opt.layerSizes != NULL) {
-        for(idx = 0; idx < opt.neuralNetSize; idx++) {
-            addLayer(&nn, opt.layerSizes[idx]);
-        }
-    }
-
-    return nn; 
-}
+// number of entries that fit in one aligned chunk of memory
+#define ALIGNED_ENTRIES (MATRIX_ALIGNMENT / (int) sizeof(Real))
 
 NeuralNetOpt getDefaultOptions()
 {
@@ -52,7 +39,8 @@ NeuralNetOpt getDefaultOptions()
         .nodeOrient = ROW,
         .lr = 0.01,
         .layerSizes = NULL,
-        .neuralNetSize = 0
+        .neuralNetSize = 0,
+        .seed = getRngSeed()
     };
 
     return opt;
@@ -80,12 +68,12 @@ Matrix createEmptyBias(int nodes, NeuralNetOpt opt)
     return createMatrix(row, col);
 }
 
-void activateWeights(Matrix wts, NeuralNetOpt opt)
+void activateWeights(Matrix wts, NeuralNetOpt opt, Rng *rng)
 {
     if(!isValidNeuralNetOpt(opt)) throwInvalidArgs("opt", INVALID_NEURAL_NET_OPT);
 
     double mult, bounds;
-    int currNodes, prevNodes;
+    int currNodes, prevNodes, row;
 
     currNodes = opt.nodeOrient == COL ? wts.row : wts.col;
     prevNodes = opt.nodeOrient == COL ? wts.col : wts.row;
@@ -111,63 +99,215 @@ void activateWeights(Matrix wts, NeuralNetOpt opt)
     }
 
     if(opt.distStrat != ZERO) {
-        bounds = opt.distSize / sqrt(wts.row * wts.col);
-        fillMatrixRandn(wts, -1 * bounds, bounds, mult);
+        bounds = opt.distSize / sqrt(wts.row * wts.col) * mult;
+        for(row = 0; row < wts.row; row++) {
+            rngUniformArr(rng, MATRIX_ROW(wts, row), wts.col, -1 * bounds, bounds);
+        }
     }
 }
 
-void activateLayer(Layer *layer, int prevNodes, NeuralNetOpt opt)
+// Grows the array of layers, so that it can hold at least a given number of layers.
+static void reserveLayers(LayerArray *layers, int size)
 {
-    if(!isValidNeuralNetOpt(opt)) throwInvalidArgs("opt", INVALID_NEURAL_NET_OPT);
+    Layer *items;
+    int capacity;
+
+    if(size <= layers->capacity) return;
+
+    capacity = layers->capacity > 0 ? layers->capacity : 4;
+    while(capacity < size) {
+        capacity *= 2;
+    }
+
+    items = (Layer *) realloc(layers->items, capacity * sizeof(Layer));
+    if(items == NULL) throwMallocFailed();
+
+    layers->items = items;
+    layers->capacity = capacity;
+}
+
+// Rounds a number of entries up to a whole number of aligned chunks, so
+// that the matrix after them starts on an aligned address.
+static long alignParams(long entries)
+{
+    return (entries + ALIGNED_ENTRIES - 1) / ALIGNED_ENTRIES * ALIGNED_ENTRIES;
+}
+
+// Counts the entries of the parameters of the layers, where each matrix is
+// padded to a whole number of aligned chunks.
+static long countParams(const int *nodes, int size)
+{
+    long count;
+    int pos;
 
-    if(prevNodes < 0) {
-        throwInvalidArgs("prevNodes", SHOULD_BE_NON_NEGATIVE);
-    } else if(prevNodes == 0) {
-        layer->weights = createZeroMatrix();
-        layer->bias = createZeroMatrix();
-    } else {
-        layer->weights = createEmptyWeights(layer->nodes, prevNodes, opt);
-        activateWeights(layer->weights, opt);
-        
-        layer->bias = createEmptyBias(layer->nodes, opt);
-        fillMatrix(layer->bias, opt.initialBias); // activate bias
+    count = 0;
+    for(pos = 2; pos <= size; pos++) {
+        count += alignParams((long) nodes[pos - 1] * nodes[pos - 2]) + alignParams(nodes[pos - 1]);
     }
+
+    return count;
 }
 
-void reactivateLayer(Layer *layer, int prevNodes, NeuralNetOpt opt)
+// Points the weights and bias of a layer at the parameters that start at a 
+// given offset of a buffer, and moves the offset past them.
+static void viewLayer(Layer *layer, int prevNodes, NodeOrientation orient, Real *params, long *offset)
+{
+    layer->weights = orient == COL
+        ? createMatrixView(params + *offset, layer->nodes, prevNodes, prevNodes)
+        : createMatrixView(params + *offset, prevNodes, layer->nodes, layer->nodes);
+    *offset += alignParams((long) layer->nodes * prevNodes);
+
+    layer->bias = orient == COL
+        ? createMatrixView(params + *offset, layer->nodes, 1, 1)
+        : createMatrixView(params + *offset, 1, layer->nodes, layer->nodes);
+    *offset += alignParams(layer->nodes);
+}
+
+// Lays the parameters of every layer out in a new buffer, and points the
+// weights and biases of the layers at it. The layers within the positions 
+// [first, last] are initialized, while the others keep their values.
+static void layoutParams(NeuralNetwork *nn, int first, int last)
+{
+    Matrix params;
+    Layer *layer, old;
+    Rng rng;
+    long count, offset;
+    int pos, nodes[nn->layers.size > 0 ? nn->layers.size : 1];
+
+    for(pos = 1; pos <= nn->layers.size; pos++) {
+        nodes[pos - 1] = nn->layers.items[pos - 1].nodes;
+    }
+    count = countParams(nodes, nn->layers.size);
+    if(count > 0x7fffffff) throwInvalidArgs("nn", "It has too many parameters.");
+
+    params = count > 0 ? createMatrix(1, (int) count) : createZeroMatrix();
+    if(count > 0) {
+        fillMatrix(params, 0);
+    }
+
+    offset = 0;
+    for(pos = 1; pos <= nn->layers.size; pos++) {
+        layer = nn->layers.items + pos - 1;
+
+        // the input layer has no weights, nor biases
+        if(pos == 1) {
+            layer->weights = createZeroMatrix();
+            layer->bias = createZeroMatrix();
+            continue;
+        }
+
+        old = *layer;
+        viewLayer(layer, layer[-1].nodes, nn->options.nodeOrient, params.entries, &offset);
+
+        if(pos >= first && pos <= last) {
+            // each layer draws from its own stream, thus its weights only
+            // depend on the seed, and on where the layer is
+            rng = createRng(nn->options.seed, RNG_WEIGHTS_STREAM(pos));
+            activateWeights(layer->weights, nn->options, &rng);
+            fillMatrix(layer->bias, nn->options.initialBias);
+        } else {
+            copyMatrix(old.weights, layer->weights);
+            copyMatrix(old.bias, layer->bias);
+        }
+    }
+
+    freeMatrix(&nn->params);
+    nn->params = params;
+}
+
+NeuralNetwork createNeuralNet(NeuralNetOpt opt)
 {
-    if(prevNodes < 0) throwInvalidArgs("prevNodes", SHOULD_BE_NON_NEGATIVE);
     if(!isValidNeuralNetOpt(opt)) throwInvalidArgs("opt", INVALID_NEURAL_NET_OPT);
     
-    freeMatrix(&layer->weights);
-    freeMatrix(&layer->bias);
-    activateLayer(layer, prevNodes, opt);
+    int idx;
+    NeuralNetwork nn = { 
+        .options = opt,
+        .layers = { NULL, 0, 0 },
+        .params = createZeroMatrix()
+    };
+    
+    // the parameters of every layer are laid out, and initialized, at once
+    if(opt.layerSizes != NULL && opt.neuralNetSize > 0) {
+        reserveLayers(&nn.layers, opt.neuralNetSize);
+        for(idx = 0; idx < opt.neuralNetSize; idx++) {
+            nn.layers.items[idx] = (Layer) { opt.layerSizes[idx], createZeroMatrix(), createZeroMatrix() };
+        }
+        nn.layers.size = opt.neuralNetSize;
+        layoutParams(&nn, 1, nn.layers.size);
+    }
+
+    return nn; 
 }
 
-Layer *createLayer(int nodes, int pos, NeuralNetwork nn)
+NeuralNetwork copyNeuralNet(NeuralNetwork nn)
 {
-    if(nodes <= 0) throwInvalidArgs("nodes", SHOULD_BE_POSITIVE)
-    if(pos <= 0) throwInvalidArgs("pos", SHOULD_BE_NON_NEGATIVE);
+    int pos;
+    NeuralNetwork copy = { 
+        .options = nn.options,
+        .layers = { NULL, 0, 0 },
+        .params = createZeroMatrix()
+    };
 
-    Layer *layer; 
-    int prevNodes;
+    reserveLayers(&copy.layers, nn.layers.size);
+    copy.layers.size = nn.layers.size;
 
-    layer = (Layer *) malloc(sizeof(Layer));
-    if(layer == NULL) throwMallocFailed();
-    
-    layer->nodes = nodes;
-    prevNodes = pos == 1 ? 0 : getLayer(nn, pos - 1).nodes;
-    activateLayer(layer, prevNodes, nn.options);
+    // a network without weights has no parameters to be viewed
+    if(!isZeroMatrix(nn.params)) {
+        copy.params = createMatrix(1, nn.params.col);
+        copyMatrix(nn.params, copy.params);
+    }
 
-    return layer;
+    for(pos = 1; pos <= nn.layers.size; pos++) {
+        copy.layers.items[pos - 1] = !isZeroMatrix(copy.params) ? viewLayerParams(nn, copy.params, pos) : getLayer(nn, pos);
+    }
+
+    return copy;
+}
+
+long getParamCount(NeuralNetOpt opt)
+{
+    if(!isValidNeuralNetOpt(opt)) throwInvalidArgs("opt", INVALID_NEURAL_NET_OPT);
+
+    return opt.layerSizes != NULL ? countParams(opt.layerSizes, opt.neuralNetSize) : 0;
+}
+
+NeuralNetwork viewNeuralNet(NeuralNetOpt opt, Matrix params)
+{
+    if(!isValidNeuralNetOpt(opt)) throwInvalidArgs("opt", INVALID_NEURAL_NET_OPT);
+    if(opt.layerSizes == NULL || opt.neuralNetSize <= 0) throwInvalidArgs("opt", "It should have at least one layer.");
+    if(!isValidMatrix(params) || params.row > 1 || params.col != getParamCount(opt)) {
+        throwInvalidArgs("params", "It should be a single row with as many entries as the parameters of the layers.");
+    }
+
+    int pos;
+    long offset;
+    NeuralNetwork nn = { 
+        .options = opt,
+        .layers = { NULL, 0, 0 },
+        .params = isZeroMatrix(params) ? params : createMatrixView(params.entries, 1, params.col, params.col)
+    };
+
+    reserveLayers(&nn.layers, opt.neuralNetSize);
+    nn.layers.size = opt.neuralNetSize;
+
+    offset = 0;
+    for(pos = 1; pos <= nn.layers.size; pos++) {
+        nn.layers.items[pos - 1] = (Layer) { opt.layerSizes[pos - 1], createZeroMatrix(), createZeroMatrix() };
+        if(pos > 1) {
+            viewLayer(nn.layers.items + pos - 1, opt.layerSizes[pos - 2], opt.nodeOrient, nn.params.entries, &offset);
+        }
+    }
+
+    return nn;
 }
 
 void addLayer(NeuralNetwork *nn, int nodes)
 {
     if(nodes <= 0) throwInvalidArgs("nodes", SHOULD_BE_POSITIVE);
 
-    Layer *layer = createLayer(nodes, nn->layers.size + 1, *nn);
-    addToList(&nn->layers, layer); 
+    reserveLayers(&nn->layers, nn->layers.size + 1);
+    nn->layers.items[nn->layers.size++] = (Layer) { nodes, createZeroMatrix(), createZeroMatrix() };
+    layoutParams(nn, nn->layers.size, nn->layers.size);
 }
 
 void insertLayer(NeuralNetwork *nn, int pos, int nodes)
@@ -175,26 +315,43 @@ void insertLayer(NeuralNetwork *nn, int pos, int nodes)
     if(nodes <= 0) throwInvalidArgs("nodes", SHOULD_BE_POSITIVE);
     if(pos <= 0) throwInvalidArgs("pos", SHOULD_BE_POSITIVE);
     if(pos > nn->layers.size + 1) throwInvalidArgs("pos", "It should be lesser than or equal to the network size plus one.");
-    
-    Layer *curr, *next;
 
-    curr = createLayer(nodes, pos, *nn);
-    insertToList(&nn->layers, pos - 1, curr);
+    reserveLayers(&nn->layers, nn->layers.size + 1);
+    memmove(nn->layers.items + pos, nn->layers.items + pos - 1, (nn->layers.size - pos + 1) * sizeof(Layer));
+    nn->layers.items[pos - 1] = (Layer) { nodes, createZeroMatrix(), createZeroMatrix() };
+    nn->layers.size++;
 
     // Reinitialize succeeding layer
-    if(pos < nn->layers.size) {
-        next = (Layer *) getItemByIndex(nn->layers, pos);
-        reactivateLayer(next, curr->nodes, nn->options);
+    layoutParams(nn, pos, pos + 1);
+}
+
+LayerIterator iterNeuralNet(const NeuralNetwork *nn, TravDirection dir)
+{
+    if(nn == NULL) throwInvalidArgs("nn", "It should not be null.");
+    if(dir != FORWARD && dir != BACKWARD) throwInvalidArgs("dir", "");
+
+    LayerIterator it = { nn->layers.items, nn->layers.size, 0 };
+
+    if(dir == BACKWARD) {
+        it.pos = it.size + 1;
     }
+
+    return it;
 }
 
-Layer *travNeuralNet(NeuralNetwork *nn, TravDirection dir)
+Layer *travNeuralNet(LayerIterator *it, TravDirection dir)
 {
+    if(it == NULL) throwInvalidArgs("it", "It should not be null.");
     if(dir != FORWARD && dir != BACKWARD) throwInvalidArgs("dir", "");
 
-    NavDirection nav = dir == FORWARD ? NEXT : PREV;
-    DoublyLinkedList *ll = nn == NULL ? NULL : &nn->layers;  
-    return (Layer *) getItem(ll, nav);
+    // the position stops on either side of the layers, one step past them
+    if(dir == FORWARD && it->pos <= it->size) {
+        it->pos++;
+    } else if(dir == BACKWARD && it->pos > 0) {
+        it->pos--;
+    }
+
+    return it->pos >= 1 && it->pos <= it->size ? it->items + it->pos - 1 : NULL;
 }
 
 Layer getLayer(NeuralNetwork nn, int pos)
@@ -202,17 +359,24 @@ Layer getLayer(NeuralNetwork nn, int pos)
     if(pos <= 0) throwInvalidArgs("pos", SHOULD_BE_POSITIVE);
     if(pos > nn.layers.size) throwInvalidArgs("pos", "It should not be bigger than the layer size.");
 
-    return *(Layer *) getItemByIndex(nn.layers, pos - 1);
+    return nn.layers.items[pos - 1];
 }
 
-void freeLayer(void *item) 
+Layer viewLayerParams(NeuralNetwork nn, Matrix params, int pos)
 {
-    Layer *layer = (Layer *) item;
+    if(!isValidMatrix(params) || params.row != nn.params.row || params.col != nn.params.col) {
+        throwInvalidArgs("params", "It should have the shape of the parameters of nn.");
+    }
 
-    layer->nodes = 0;
-    freeMatrix(&layer->weights);
-    freeMatrix(&layer->bias);
-    free(layer);
+    Layer layer = getLayer(nn, pos);
+
+    // the input layer has nothing to view
+    if(pos == 1) return layer;
+
+    layer.weights.entries = params.entries + (layer.weights.entries - nn.params.entries);
+    layer.bias.entries = params.entries + (layer.bias.entries - nn.params.entries);
+
+    return layer;
 }
 
 void deleteLayer(NeuralNetwork *nn, int pos)
@@ -220,22 +384,18 @@ void deleteLayer(NeuralNetwork *nn, int pos)
     if(pos <= 0) throwInvalidArgs("pos", SHOULD_BE_POSITIVE);
     if(pos > nn->layers.size) throwInvalidArgs("pos", "It should not be bigger than the network size.");
 
-    int prevNodes;
-    Layer *curr;
+    memmove(nn->layers.items + pos - 1, nn->layers.items + pos, (nn->layers.size - pos) * sizeof(Layer));
+    nn->layers.size--;
 
-    deleteFromList(&nn->layers, pos - 1, freeLayer);
-    
     // Reinitialize previously succeeding layer
-    if(pos <= nn->layers.size) {
-        curr = (Layer *) getItemByIndex(nn->layers, pos);
-        prevNodes = pos == 1 ? 0 : getLayer(*nn, pos - 1).nodes;
-        reactivateLayer(curr, prevNodes, nn->options);
-    }
+    layoutParams(nn, pos, pos);
 }
 
 void freeNeuralNet(NeuralNetwork *nn)
 {
-    clearList(&nn->layers, freeLayer);
+    freeMatrix(&nn->params);
+    free(nn->layers.items);
+    nn->layers = (LayerArray) { NULL, 0, 0 };
     nn->options.distSize = 0;
     nn->options.distStrat = ZERO;
     nn->options.initialBias = 0;
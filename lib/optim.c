@@ -0,0 +1,128 @@
+/** @file optim.c
+ *  @brief A library made for updating the parameters of
+ *  neural networks against their gradients.
+ *
+ *  This library contains optimizers which keep the velocity,
+ *  and the moments of the gradients of every parameter in
+ *  buffers laid out like the parameters, and update both in
+ *  a single fused pass, that is vectorized by the simd library
+ *  and split across the threads of the thread pool.
+ *
+ *  DEPENDENCIES: simd, thread_pool, matrix, neural_net
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "headers/simd.h"
+#include "headers/thread_pool.h"
+#include "headers/matrix.h"
+#include "headers/neural_net.h"
+#include "headers/optim.h"
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define SHOULD_NOT_BE_NULL "It should not be a null value."
+
+// The argument shared by the tasks that update the chunks of the parameters.
+typedef struct StepTask {
+    Optimizer *optimizer;
+    Real *params;
+    const Real *grad;
+    int size;
+    // The bias corrected step size and epsilon of Adam.
+    Real stepSize;
+    Real epsilon;
+} StepTask;
+
+static void stepChunk(void *arg, int task)
+{
+    StepTask *step = (StepTask *) arg;
+    Optimizer *optimizer = step->optimizer;
+    long start = (long) task * OPTIM_CHUNK_SIZE;
+    int size = step->size - start < OPTIM_CHUNK_SIZE ? step->size - start : OPTIM_CHUNK_SIZE;
+
+    switch(optimizer->type) {
+        case SGD:
+            vecAxpy(-1 * optimizer->lr, step->grad + start, step->params + start, size);
+            break;
+        case MOMENTUM:
+        case NESTEROV:
+            vecMomentumStep(step->params + start, step->grad + start, optimizer->velocity.entries + start,
+                optimizer->lr, optimizer->momentum, optimizer->type == NESTEROV, size);
+            break;
+        case ADAM:
+            vecAdamStep(step->params + start, step->grad + start, optimizer->velocity.entries + start,
+                optimizer->variance.entries + start, optimizer->momentum, optimizer->beta2, step->stepSize, step->epsilon, size);
+            break;
+    }
+}
+
+Optimizer createOptimizer(OptimizerType type, NeuralNetwork nn)
+{
+    if(type < SGD || type > ADAM) throwInvalidArgs("type", "It should be SGD, MOMENTUM, NESTEROV, or ADAM.");
+    if(!isValidMatrix(nn.params) || isZeroMatrix(nn.params)) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    Optimizer optimizer = {
+        .type = type,
+        .lr = nn.options.lr,
+        .momentum = 0.9,
+        .beta2 = 0.999,
+        .epsilon = 1e-8,
+        .steps = 0,
+        .velocity = createZeroMatrix(),
+        .variance = createZeroMatrix()
+    };
+
+    if(type != SGD) optimizer.velocity = createMatrix(1, nn.params.col);
+    if(type == ADAM) optimizer.variance = createMatrix(1, nn.params.col);
+    resetOptimizer(&optimizer);
+
+    return optimizer;
+}
+
+void optimizerStep(Optimizer *optimizer, Matrix params, Matrix grad)
+{
+    if(optimizer == NULL) throwInvalidArgs("optimizer", SHOULD_NOT_BE_NULL);
+    if(!isValidMatrix(params) || params.row != 1) throwInvalidArgs("params", "It should be a single row of parameters.");
+    if(!isValidMatrix(grad) || grad.row != 1 || grad.col != params.col) throwInvalidArgs("grad", "It should be laid out like the parameters.");
+    if(optimizer->type != SGD && optimizer->velocity.col != params.col) throwInvalidArgs("params", "It should be laid out like the parameters the optimizer was created for.");
+
+    StepTask step = { .optimizer = optimizer, .params = params.entries, .grad = grad.entries, .size = params.col };
+    double correction1, correction2;
+    int chunks = (params.col + OPTIM_CHUNK_SIZE - 1) / OPTIM_CHUNK_SIZE;
+
+    optimizer->steps++;
+    if(optimizer->type == ADAM) {
+        // the moments are corrected for starting at zero, which is the same
+        // for every parameter, thus it is folded into the step and epsilon
+        correction1 = 1 - pow(optimizer->momentum, optimizer->steps);
+        correction2 = 1 - pow(optimizer->beta2, optimizer->steps);
+        step.stepSize = optimizer->lr * sqrt(correction2) / correction1;
+        step.epsilon = optimizer->epsilon * sqrt(correction2);
+    }
+
+    if(chunks == 1) {
+        stepChunk(&step, 0);
+    } else {
+        parallelFor(chunks, stepChunk, &step);
+    }
+}
+
+void resetOptimizer(Optimizer *optimizer)
+{
+    if(optimizer == NULL) throwInvalidArgs("optimizer", SHOULD_NOT_BE_NULL);
+
+    optimizer->steps = 0;
+    if(!isZeroMatrix(optimizer->velocity)) fillMatrix(optimizer->velocity, 0);
+    if(!isZeroMatrix(optimizer->variance)) fillMatrix(optimizer->variance, 0);
+}
+
+void freeOptimizer(Optimizer *optimizer)
+{
+    if(optimizer == NULL) throwInvalidArgs("optimizer", SHOULD_NOT_BE_NULL);
+
+    if(!isZeroMatrix(optimizer->velocity)) freeMatrix(&optimizer->velocity);
+    if(!isZeroMatrix(optimizer->variance)) freeMatrix(&optimizer->variance);
+}
@@ -0,0 +1,385 @@
+/** @file prune.c
+ *  @brief A library made for pruning the weights of trained
+ *  neural networks, and running them with sparse weights.
+ *
+ *  This library contains functions which zero the weights of
+ *  a trained neural network with the smallest magnitudes, keep
+ *  them zero while it is fine-tuned, and compile it into layers
+ *  whose nonzero weights are stored in the compressed sparse row
+ *  format, which only multiply the weights that are kept.
+ *
+ *  DEPENDENCIES: rng, matrix, sparse, neural_net, ml
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "headers/rng.h"
+#include "headers/matrix.h"
+#include "headers/sparse.h"
+#include "headers/neural_net.h"
+#include "headers/ml.h"
+#include "headers/prune.h"
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwMallocFailed() { fprintf(stderr, "Memory Allocation Failed."); exit(1); }
+#define SHOULD_BE_POSITIVE "It should be a positive integer."
+#define SHOULD_NOT_BE_NULL "It should not be a null value."
+
+static int compareMagnitudes(const void *a, const void *b)
+{
+    Real x = *(const Real *) a, y = *(const Real *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+long pruneLayer(Layer layer, double threshold, double sparsity)
+{
+    if(!isValidMatrix(layer.weights) || isZeroMatrix(layer.weights)) throwInvalidArgs("layer", "It should have weights.");
+    if(threshold < 0) throwInvalidArgs("threshold", "It should not be negative.");
+    if(sparsity < 0 || sparsity > 1) throwInvalidArgs("sparsity", "It should be within [0, 1].");
+
+    long count, target, zeroes, idx;
+    int row, col;
+    Real *magnitudes, cutoff, *weight;
+
+    count = (long) layer.weights.row * layer.weights.col;
+    target = lround(sparsity * count);
+
+    // the magnitude of the target-th smallest weight is the cutoff,
+    // below which every weight is zeroed along with the threshold
+    cutoff = -1;
+    if(target > 0) {
+        magnitudes = (Real *) malloc(count * sizeof(Real));
+        if(magnitudes == NULL) throwMallocFailed();
+
+        idx = 0;
+        for(row = 0; row < layer.weights.row; row++) {
+            for(col = 0; col < layer.weights.col; col++) {
+                magnitudes[idx++] = fabs(MATRIX_AT(layer.weights, row, col));
+            }
+        }
+        qsort(magnitudes, count, sizeof(Real), compareMagnitudes);
+        cutoff = magnitudes[target - 1];
+        free(magnitudes);
+    }
+
+    zeroes = 0;
+    for(row = 0; row < layer.weights.row; row++) {
+        for(col = 0; col < layer.weights.col; col++) {
+            weight = &MATRIX_AT(layer.weights, row, col);
+            if(fabs(*weight) < threshold || fabs(*weight) < cutoff) *weight = 0;
+            if(*weight == 0) zeroes++;
+        }
+    }
+
+    // the weights that tie with the cutoff are only zeroed until the target is met
+    for(row = 0; row < layer.weights.row && zeroes < target; row++) {
+        for(col = 0; col < layer.weights.col && zeroes < target; col++) {
+            weight = &MATRIX_AT(layer.weights, row, col);
+            if(*weight != 0 && fabs(*weight) == cutoff) {
+                *weight = 0;
+                zeroes++;
+            }
+        }
+    }
+
+    return zeroes;
+}
+
+void pruneNeuralNet(NeuralNetwork nn, double threshold, const double sparsities[])
+{
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    int pos;
+
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        pruneLayer(getLayer(nn, pos), threshold, sparsities != NULL ? sparsities[pos - 2] : 0);
+    }
+}
+
+double getLayerSparsity(Layer layer)
+{
+    if(!isValidMatrix(layer.weights) || isZeroMatrix(layer.weights)) throwInvalidArgs("layer", "It should have weights.");
+
+    long zeroes;
+    int row, col;
+
+    zeroes = 0;
+    for(row = 0; row < layer.weights.row; row++) {
+        for(col = 0; col < layer.weights.col; col++) {
+            if(MATRIX_AT(layer.weights, row, col) == 0) zeroes++;
+        }
+    }
+
+    return (double) zeroes / ((double) layer.weights.row * layer.weights.col);
+}
+
+void fineTunePrunedNet(NeuralNetwork nn, ActivationFunc activate, int batchSize, Data dataset[], int size, int rounds)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(batchSize <= 0) throwInvalidArgs("batchSize", SHOULD_BE_POSITIVE);
+    if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
+    if(rounds < 0) throwInvalidArgs("rounds", "It should be a non-negative integer.");
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    Matrix masks[nn.layers.size];
+    MatrixExpr expr;
+    Layer layer;
+    Rng rng;
+    Data *batch;
+    int *order, pos, row, col, round, start, idx;
+
+    // each weight that is kept is masked by 1, and each pruned one by 0
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        layer = getLayer(nn, pos);
+        masks[pos - 1] = createMatrix(layer.weights.row, layer.weights.col);
+        for(row = 0; row < layer.weights.row; row++) {
+            for(col = 0; col < layer.weights.col; col++) {
+                MATRIX_AT(masks[pos - 1], row, col) = MATRIX_AT(layer.weights, row, col) != 0;
+            }
+        }
+    }
+
+    batch = (Data *) malloc(batchSize * sizeof(Data));
+    order = (int *) malloc(size * sizeof(int));
+    if(batch == NULL || order == NULL) throwMallocFailed();
+
+    for(idx = 0; idx < size; idx++) {
+        order[idx] = idx;
+    }
+
+    for(round = 0; round < rounds; round++) {
+        // each round visits the batches in a new random order, where the
+        // samples of a batch are gathered into a buffer of their own, which
+        // shares the matrices of the dataset
+        rng = createShuffleRng();
+        rngShuffle(&rng, order, size);
+
+        for(start = 0; start + batchSize <= size; start += batchSize) {
+            for(idx = 0; idx < batchSize; idx++) {
+                batch[idx] = dataset[order[start + idx]];
+            }
+            networkTrain(nn, activate, batchSize, batch, batchSize);
+
+            for(pos = 2; pos <= nn.layers.size; pos++) {
+                layer = getLayer(nn, pos);
+                expr = (MatrixExpr) { 0 };
+                exprLoad(&expr, layer.weights);
+                exprLoad(&expr, masks[pos - 1]);
+                exprMultiply(&expr);
+                evalExprInto(&expr, layer.weights);
+            }
+        }
+    }
+
+    for(pos = 2; pos <= nn.layers.size; pos++) {
+        freeMatrix(masks + pos - 1);
+    }
+    free(batch);
+    free(order);
+}
+
+// Copies a layer, and compresses its weights, one input per row, if few enough of them are nonzero.
+static PrunedLayer createPrunedLayer(Layer layer, NodeOrientation orient)
+{
+    PrunedLayer pruned;
+    Matrix inputWeights;
+
+    pruned.nodes = layer.nodes;
+    pruned.inputs = orient == COL ? layer.weights.col : layer.weights.row;
+    pruned.weights = (SparseMatrix) { 0, 0, 0, NULL, NULL, NULL };
+    pruned.layer.nodes = layer.nodes;
+    pruned.layer.bias = createMatrix(layer.bias.row, layer.bias.col);
+    copyMatrix(layer.bias, pruned.layer.bias);
+
+    if(1 - getLayerSparsity(layer) > PRUNE_MAX_DENSITY) {
+        pruned.layer.weights = createMatrix(layer.weights.row, layer.weights.col);
+        copyMatrix(layer.weights, pruned.layer.weights);
+        return pruned;
+    }
+
+    // the weights of column nodes are stored one node per row, thus they are
+    // transposed first, so that the weights of each input end up together
+    if(orient == ROW) {
+        pruned.weights = createSparseMatrix(layer.weights);
+    } else {
+        inputWeights = createMatrix(layer.weights.col, layer.weights.row);
+        transposeInto(layer.weights, inputWeights);
+        pruned.weights = createSparseMatrix(inputWeights);
+        freeMatrix(&inputWeights);
+    }
+    pruned.layer.weights = createZeroMatrix();
+
+    return pruned;
+}
+
+PrunedNetwork createPrunedNet(NeuralNetwork nn, ActivationFunc activate)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    int pos;
+    PrunedNetwork pnn = {
+        .size = nn.layers.size - 1,
+        .activate = activate,
+        .nodeOrient = nn.options.nodeOrient
+    };
+
+    pnn.layers = (PrunedLayer *) malloc(pnn.size * sizeof(PrunedLayer));
+    if(pnn.layers == NULL) throwMallocFailed();
+
+    for(pos = 0; pos < pnn.size; pos++) {
+        pnn.layers[pos] = createPrunedLayer(getLayer(nn, pos + 2), nn.options.nodeOrient);
+    }
+
+    return pnn;
+}
+
+Matrix createPrunedBuffer(PrunedNetwork pnn)
+{
+    if(pnn.size <= 0 || pnn.layers == NULL) throwInvalidArgs("pnn", "It should be a pruned Neural Network.");
+
+    int pos, maxNodes;
+
+    maxNodes = 0;
+    for(pos = 0; pos < pnn.size; pos++) {
+        if(pnn.layers[pos].nodes > maxNodes) maxNodes = pnn.layers[pos].nodes;
+    }
+
+    return pnn.nodeOrient == COL ? createMatrix(maxNodes, 1) : createMatrix(1, maxNodes);
+}
+
+// Adds the nonzero weights of each nonzero input, scaled by the input, onto the
+// bias of the nodes they are at, and activates the sums. The inputs are taken
+// off of the sparse inputs instead, if there are any, thus both the blank 
+// inputs and the pruned weights are skipped. The inputs, bias, and results 
+// are rows for row nodes, or columns for column nodes.
+static void sparseLayerForwardInto(const PrunedLayer *pruned, Matrix input, const SparseMatrix *sparseInput, 
+    ActivationFunc activate, NodeOrientation orient, Matrix out)
+{
+    // the weights are read through restricted pointers, so that they are 
+    // not loaded again after every sum that is stored
+    const int *restrict rowStarts = pruned->weights.rowStarts;
+    const int *restrict colIndices = pruned->weights.colIndices;
+    const Real *restrict values = pruned->weights.values;
+    Real *restrict sums = out.entries;
+    long inputStep, biasStep, outStep;
+    int node, row, idx, weightIdx;
+    Real val;
+
+    inputStep = orient == COL ? input.stride : 1;
+    biasStep = orient == COL ? pruned->layer.bias.stride : 1;
+    outStep = orient == COL ? out.stride : 1;
+
+    for(node = 0; node < pruned->nodes; node++) {
+        sums[node * outStep] = pruned->layer.bias.entries[node * biasStep];
+    }
+
+    for(idx = 0; idx < (sparseInput != NULL ? sparseInput->nnz : pruned->inputs); idx++) {
+        row = sparseInput != NULL ? sparseInput->colIndices[idx] : idx;
+        val = sparseInput != NULL ? sparseInput->values[idx] : input.entries[idx * inputStep];
+        if(val == 0) continue;
+
+        for(weightIdx = rowStarts[row]; weightIdx < rowStarts[row + 1]; weightIdx++) {
+            sums[colIndices[weightIdx] * outStep] += val * values[weightIdx];
+        }
+    }
+
+    for(node = 0; node < pruned->nodes; node++) {
+        sums[node * outStep] = activate(sums[node * outStep]);
+    }
+}
+
+Matrix prunedForwardPropagateInto(Data data, PrunedNetwork pnn, Matrix buffers[2])
+{
+    if(pnn.size <= 0 || pnn.layers == NULL) throwInvalidArgs("pnn", "It should be a pruned Neural Network.");
+    if(buffers == NULL) throwInvalidArgs("buffers", SHOULD_NOT_BE_NULL);
+    if(data.inputValues.row * data.inputValues.col != pnn.layers[0].inputs)
+        throwInvalidArgs("data", "It should have as many input values as the input layer has nodes.");
+
+    const PrunedLayer *pruned;
+    Matrix res, out;
+    int pos;
+
+    res = data.inputValues;
+    for(pos = 0; pos < pnn.size; pos++) {
+        pruned = pnn.layers + pos;
+        // each layer writes into the buffer that the previous one did not
+        out = pnn.nodeOrient == COL
+            ? getSubMatrix(buffers[pos % 2], 0, 0, pruned->nodes, 1)
+            : getSubMatrix(buffers[pos % 2], 0, 0, 1, pruned->nodes);
+
+        // only the first layer is fed the inputs, which may be sparse
+        if(isSparseMatrix(pruned->weights)) {
+            sparseLayerForwardInto(pruned, res, pos == 0 && isSparseMatrix(data.sparseInputs) ? &data.sparseInputs : NULL,
+                pnn.activate, pnn.nodeOrient, out);
+        } else {
+            denseForwardInto(res, pruned->layer, pnn.activate, pnn.nodeOrient, out);
+        }
+
+        res = out;
+    }
+
+    return res;
+}
+
+double prunedNetworkTest(PrunedNetwork pnn, Data dataset[], int size)
+{
+    if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
+
+    int idx, correctItems;
+    Matrix buffers[2];
+
+    buffers[0] = createPrunedBuffer(pnn);
+    buffers[1] = createPrunedBuffer(pnn);
+
+    correctItems = 0;
+    for(idx = 0; idx < size; idx++) {
+        if(evalResult(prunedForwardPropagateInto(dataset[idx], pnn, buffers)) == dataset[idx].expVal) {
+            correctItems++;
+        }
+    }
+
+    freeMatrix(buffers);
+    freeMatrix(buffers+1);
+
+    return (double) correctItems / size;
+}
+
+long getPrunedNetBytes(PrunedNetwork pnn)
+{
+    const PrunedLayer *pruned;
+    long bytes = 0;
+    int pos;
+
+    for(pos = 0; pos < pnn.size; pos++) {
+        pruned = pnn.layers + pos;
+        if(isSparseMatrix(pruned->weights)) {
+            bytes += (long) pruned->weights.nnz * (sizeof(Real) + sizeof(int));
+            bytes += (long) (pruned->inputs + 1) * sizeof(int);
+        } else {
+            bytes += (long) pruned->nodes * pruned->inputs * sizeof(Real);
+        }
+        bytes += (long) pruned->nodes * sizeof(Real);
+    }
+
+    return bytes;
+}
+
+void freePrunedNet(PrunedNetwork *pnn)
+{
+    int pos;
+
+    for(pos = 0; pos < pnn->size; pos++) {
+        freeSparseMatrix(&pnn->layers[pos].weights);
+        freeMatrix(&pnn->layers[pos].layer.weights);
+        freeMatrix(&pnn->layers[pos].layer.bias);
+    }
+    free(pnn->layers);
+
+    pnn->layers = NULL;
+    pnn->size = 0;
+}
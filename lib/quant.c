@@ -0,0 +1,453 @@
+/** @file quant.c
+ *  @brief A library made for running trained neural networks
+ *  with int8 weights.
+ *
+ *  This library contains functions which quantize the weights
+ *  of a trained neural network to int8, calibrate the scales of
+ *  the inputs of its layers on a slice of the dataset, and run
+ *  inference with integer kernels. The kernels use AVX-512 VNNI,
+ *  AVX-VNNI, or AVX2, depending on what the CPU supports.
+ *
+ *  DEPENDENCIES: simd, matrix, neural_net, ml
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "headers/simd.h"
+#include "headers/matrix.h"
+#include "headers/neural_net.h"
+#include "headers/ml.h"
+#include "headers/quant.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwMallocFailed() { fprintf(stderr, "Memory Allocation Failed."); exit(1); }
+#define SHOULD_BE_POSITIVE "It should be a positive integer."
+#define SHOULD_NOT_BE_NULL "It should not be a null value."
+
+// Weights are kept within [-127, 127], so that negating them never overflows.
+#define WEIGHT_MAX 127
+#define INPUT_MAX 255
+
+typedef void (*GemvKernel)(int nodes, int stride, const uint8_t *inputs, const int8_t *weights, int32_t *sums);
+
+static void scalarGemv(int nodes, int stride, const uint8_t *inputs, const int8_t *weights, int32_t *sums)
+{
+    int node, idx;
+    int32_t sum;
+
+    for(node = 0; node < nodes; node++, weights += stride) {
+        sum = 0;
+        for(idx = 0; idx < stride; idx++) {
+            sum += (int32_t) inputs[idx] * weights[idx];
+        }
+        sums[node] = sum;
+    }
+}
+
+#ifdef HAS_X86_KERNELS
+__attribute__((target("avx2"))) static inline int32_t sumLanes(__m256i v)
+{
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+// pmaddubsw sums the two products of each pair into a saturated int16,
+// which overflows for inputs near 255 with weights near 127. The inputs
+// and weights are widened to int16 instead, whose products are summed
+// into int32 by pmaddwd without any loss.
+__attribute__((target("avx2"))) static void avx2Gemv(int nodes, int stride, const uint8_t *inputs, const int8_t *weights, int32_t *sums)
+{
+    int node, idx;
+    __m256i acc, x, w;
+
+    for(node = 0; node < nodes; node++, weights += stride) {
+        acc = _mm256_setzero_si256();
+        for(idx = 0; idx < stride; idx += 16) {
+            x = _mm256_cvtepu8_epi16(_mm_load_si128((const __m128i *) (inputs + idx)));
+            w = _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i *) (weights + idx)));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x, w));
+        }
+        sums[node] = sumLanes(acc);
+    }
+
+    _mm256_zeroupper();
+}
+
+// vpdpbusd multiplies four uint8 and int8 pairs, and accumulates their
+// sum onto an int32 lane in a single instruction.
+__attribute__((target("avx2,avxvnni"))) static void avxVnniGemv(int nodes, int stride, const uint8_t *inputs, const int8_t *weights, int32_t *sums)
+{
+    int node, idx;
+    __m256i acc;
+
+    for(node = 0; node < nodes; node++, weights += stride) {
+        acc = _mm256_setzero_si256();
+        for(idx = 0; idx < stride; idx += 32) {
+            acc = _mm256_dpbusd_avx_epi32(acc,
+                _mm256_load_si256((const __m256i *) (inputs + idx)),
+                _mm256_load_si256((const __m256i *) (weights + idx)));
+        }
+        sums[node] = sumLanes(acc);
+    }
+
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) static void avx512VnniGemv(int nodes, int stride, const uint8_t *inputs, const int8_t *weights, int32_t *sums)
+{
+    int node, idx;
+    __m512i acc;
+
+    for(node = 0; node < nodes; node++, weights += stride) {
+        acc = _mm512_setzero_si512();
+        for(idx = 0; idx < stride; idx += 64) {
+            acc = _mm512_dpbusd_epi32(acc,
+                _mm512_load_si512((const void *) (inputs + idx)),
+                _mm512_load_si512((const void *) (weights + idx)));
+        }
+        sums[node] = _mm512_reduce_add_epi32(acc);
+    }
+
+    _mm256_zeroupper();
+}
+#endif
+
+// Resolved whenever the selected instruction set of the simd library
+// changes. Racing threads resolve the same kernel, thus they can only
+// ever store the same value.
+static GemvKernel gemvKernel = NULL;
+static SimdIsa gemvIsa = SCALAR;
+
+static GemvKernel getGemvKernel()
+{
+    SimdIsa isa = getSimdIsa();
+
+    if(gemvKernel != NULL && gemvIsa == isa) return gemvKernel;
+
+    gemvKernel = scalarGemv;
+#ifdef HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if(isa >= AVX512 && __builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw")) {
+        gemvKernel = avx512VnniGemv;
+    } else if(isa >= AVX2 && __builtin_cpu_supports("avxvnni")) {
+        gemvKernel = avxVnniGemv;
+    } else if(isa >= AVX2) {
+        gemvKernel = avx2Gemv;
+    }
+#endif
+    gemvIsa = isa;
+
+    return gemvKernel;
+}
+
+void int8Gemv(int nodes, int stride, const uint8_t *inputs, const int8_t *weights, int32_t *sums)
+{
+    if(nodes <= 0) throwInvalidArgs("nodes", SHOULD_BE_POSITIVE);
+    if(stride <= 0 || stride % QUANT_ALIGNMENT != 0) throwInvalidArgs("stride", "It should be a positive multiple of QUANT_ALIGNMENT.");
+    if(inputs == NULL) throwInvalidArgs("inputs", SHOULD_NOT_BE_NULL);
+    if(weights == NULL) throwInvalidArgs("weights", SHOULD_NOT_BE_NULL);
+    if(sums == NULL) throwInvalidArgs("sums", SHOULD_NOT_BE_NULL);
+
+    getGemvKernel()(nodes, stride, inputs, weights, sums);
+}
+
+static void *allocAligned(size_t size)
+{
+    // aligned_alloc requires the size to be a multiple of the alignment
+    void *block = aligned_alloc(QUANT_ALIGNMENT, (size + QUANT_ALIGNMENT - 1) / QUANT_ALIGNMENT * QUANT_ALIGNMENT);
+    if(block == NULL) throwMallocFailed();
+
+    return block;
+}
+
+static Real getWeight(Layer layer, NodeOrientation orient, int node, int input)
+{
+    return orient == COL ? MATRIX_AT(layer.weights, node, input) : MATRIX_AT(layer.weights, input, node);
+}
+
+static QuantLayer quantizeLayer(Layer layer, NodeOrientation orient, QuantGranularity granularity)
+{
+    QuantLayer q;
+    int node, input;
+    double maxAbs, layerMaxAbs;
+    int8_t *weights;
+    long val;
+
+    q.nodes = layer.nodes;
+    q.inputs = orient == COL ? layer.weights.col : layer.weights.row;
+    q.stride = (q.inputs + QUANT_ALIGNMENT - 1) / QUANT_ALIGNMENT * QUANT_ALIGNMENT;
+    q.weights = (int8_t *) allocAligned((size_t) q.nodes * q.stride);
+    q.scales = (float *) malloc(q.nodes * sizeof(float));
+    q.weightSums = (int32_t *) malloc(q.nodes * sizeof(int32_t));
+    q.bias = (Real *) malloc(q.nodes * sizeof(Real));
+    if(q.scales == NULL || q.weightSums == NULL || q.bias == NULL) throwMallocFailed();
+
+    // the weights are mapped symmetrically, such that the
+    // biggest magnitude lands on WEIGHT_MAX
+    layerMaxAbs = 0;
+    for(node = 0; node < q.nodes; node++) {
+        maxAbs = 0;
+        for(input = 0; input < q.inputs; input++) {
+            maxAbs = fmax(maxAbs, fabs(getWeight(layer, orient, node, input)));
+        }
+        q.scales[node] = maxAbs > 0 ? maxAbs / WEIGHT_MAX : 1;
+        layerMaxAbs = fmax(layerMaxAbs, maxAbs);
+    }
+    if(granularity == PER_LAYER) {
+        for(node = 0; node < q.nodes; node++) {
+            q.scales[node] = layerMaxAbs > 0 ? layerMaxAbs / WEIGHT_MAX : 1;
+        }
+    }
+
+    for(node = 0; node < q.nodes; node++) {
+        weights = q.weights + (long) node * q.stride;
+        q.weightSums[node] = 0;
+
+        for(input = 0; input < q.inputs; input++) {
+            val = lrint(getWeight(layer, orient, node, input) / q.scales[node]);
+            val = val > WEIGHT_MAX ? WEIGHT_MAX : val < -WEIGHT_MAX ? -WEIGHT_MAX : val;
+            weights[input] = (int8_t) val;
+            q.weightSums[node] += val;
+        }
+        memset(weights + q.inputs, 0, q.stride - q.inputs);
+
+        q.bias[node] = orient == COL ? MATRIX_AT(layer.bias, node, 0) : MATRIX_AT(layer.bias, 0, node);
+    }
+
+    q.inputScale = 1;
+    q.inputZero = 0;
+
+    return q;
+}
+
+static void trackRange(Matrix m, double *min, double *max)
+{
+    int row, col;
+
+    for(row = 0; row < m.row; row++) {
+        for(col = 0; col < m.col; col++) {
+            *min = fmin(*min, MATRIX_AT(m, row, col));
+            *max = fmax(*max, MATRIX_AT(m, row, col));
+        }
+    }
+}
+
+// Fits the scale and zero point of the inputs of each layer to the range
+// they took on, while forward propagating the calibration set.
+static void calibrate(QuantizedNetwork qnn, NeuralNetwork nn, Data calibration[], int size)
+{
+    int idx, pos, curr;
+    double min[qnn.size], max[qnn.size], scale;
+    Matrix buffers[2], res, out;
+    Layer layer;
+
+    buffers[0] = createActivationBuffer(nn);
+    buffers[1] = createActivationBuffer(nn);
+
+    // zero should always be representable, since it is what the
+    // padding, and the reLU activation land on
+    for(pos = 0; pos < qnn.size; pos++) {
+        min[pos] = 0;
+        max[pos] = 0;
+    }
+
+    for(idx = 0; idx < size; idx++) {
+        res = calibration[idx].inputValues;
+        trackRange(res, min, max);
+
+        curr = 0;
+        for(pos = 0; pos < qnn.size - 1; pos++) {
+            layer = getLayer(nn, pos + 2);
+            out = nn.options.nodeOrient == COL
+                ? getSubMatrix(buffers[curr], 0, 0, layer.nodes, 1)
+                : getSubMatrix(buffers[curr], 0, 0, 1, layer.nodes);
+
+            denseForwardInto(res, layer, qnn.activate, nn.options.nodeOrient, out);
+            trackRange(out, min + pos + 1, max + pos + 1);
+
+            res = out;
+            curr = !curr;
+        }
+    }
+
+    for(pos = 0; pos < qnn.size; pos++) {
+        scale = (max[pos] - min[pos]) / INPUT_MAX;
+        qnn.layers[pos].inputScale = scale > 0 ? scale : 1;
+        qnn.layers[pos].inputZero = (int) lrint(-min[pos] / qnn.layers[pos].inputScale);
+    }
+
+    freeMatrix(buffers);
+    freeMatrix(buffers+1);
+}
+
+QuantizedNetwork quantizeNeuralNet(NeuralNetwork nn, ActivationFunc activate, QuantGranularity granularity, Data calibration[], int size)
+{
+    if(activate == NULL) throwInvalidArgs("activate", SHOULD_NOT_BE_NULL);
+    if(granularity != PER_LAYER && granularity != PER_CHANNEL) throwInvalidArgs("granularity", "");
+    if(calibration == NULL) throwInvalidArgs("calibration", SHOULD_NOT_BE_NULL);
+    if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
+    if(nn.layers.size < 2) throwInvalidArgs("nn", "It should have at least one layer after the input layer.");
+
+    int pos;
+    QuantizedNetwork qnn = {
+        .size = nn.layers.size - 1,
+        .activate = activate,
+        .nodeOrient = nn.options.nodeOrient
+    };
+
+    qnn.layers = (QuantLayer *) malloc(qnn.size * sizeof(QuantLayer));
+    if(qnn.layers == NULL) throwMallocFailed();
+
+    for(pos = 0; pos < qnn.size; pos++) {
+        qnn.layers[pos] = quantizeLayer(getLayer(nn, pos + 2), nn.options.nodeOrient, granularity);
+    }
+    calibrate(qnn, nn, calibration, size);
+
+    return qnn;
+}
+
+QuantBuffers createQuantBuffers(QuantizedNetwork qnn)
+{
+    if(qnn.size <= 0 || qnn.layers == NULL) throwInvalidArgs("qnn", "It should be a quantized Neural Network.");
+
+    int pos, maxStride, maxNodes, outNodes;
+    QuantBuffers buffers;
+
+    maxStride = 0;
+    maxNodes = 0;
+    for(pos = 0; pos < qnn.size; pos++) {
+        if(qnn.layers[pos].stride > maxStride) maxStride = qnn.layers[pos].stride;
+        if(qnn.layers[pos].nodes > maxNodes) maxNodes = qnn.layers[pos].nodes;
+    }
+
+    // every input is only ever multiplied by a zero weight past the
+    // inputs of a layer, thus the buffer only needs zeroing once
+    buffers.inputs = (uint8_t *) allocAligned(maxStride);
+    memset(buffers.inputs, 0, maxStride);
+    buffers.sums = (int32_t *) malloc(maxNodes * sizeof(int32_t));
+    if(buffers.sums == NULL) throwMallocFailed();
+
+    outNodes = qnn.layers[qnn.size - 1].nodes;
+    buffers.out = qnn.nodeOrient == COL ? createMatrix(outNodes, 1) : createMatrix(1, outNodes);
+
+    return buffers;
+}
+
+static uint8_t quantizeInput(double val, const QuantLayer *layer)
+{
+    long q = lrint(val / layer->inputScale) + layer->inputZero;
+
+    return (uint8_t) (q > INPUT_MAX ? INPUT_MAX : q < 0 ? 0 : q);
+}
+
+Matrix quantizedForwardPropagateInto(Data data, QuantizedNetwork qnn, QuantBuffers buffers)
+{
+    if(qnn.size <= 0 || qnn.layers == NULL) throwInvalidArgs("qnn", "It should be a quantized Neural Network.");
+    if(data.inputValues.row * data.inputValues.col != qnn.layers[0].inputs)
+        throwInvalidArgs("data", "It should have as many input values as the input layer has nodes.");
+
+    int pos, node, row, col, idx;
+    const QuantLayer *layer, *next;
+    double val;
+
+    idx = 0;
+    for(row = 0; row < data.inputValues.row; row++) {
+        for(col = 0; col < data.inputValues.col; col++) {
+            buffers.inputs[idx++] = quantizeInput(MATRIX_AT(data.inputValues, row, col), qnn.layers);
+        }
+    }
+
+    for(pos = 0; pos < qnn.size; pos++) {
+        layer = qnn.layers + pos;
+        next = pos + 1 < qnn.size ? layer + 1 : NULL;
+
+        int8Gemv(layer->nodes, layer->stride, buffers.inputs, layer->weights, buffers.sums);
+
+        // the sums are requantized as the inputs of the next
+        // layer, once all of them have been computed
+        for(node = 0; node < layer->nodes; node++) {
+            val = (double) layer->inputScale * layer->scales[node]
+                * (buffers.sums[node] - layer->inputZero * layer->weightSums[node])
+                + layer->bias[node];
+            val = qnn.activate(val);
+
+            if(next != NULL) {
+                buffers.inputs[node] = quantizeInput(val, next);
+            } else {
+                buffers.out.entries[node] = val;
+            }
+        }
+    }
+
+    return buffers.out;
+}
+
+double quantizedNetworkTest(QuantizedNetwork qnn, Data dataset[], int size)
+{
+    if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
+
+    int idx, correctItems;
+    QuantBuffers buffers = createQuantBuffers(qnn);
+
+    correctItems = 0;
+    for(idx = 0; idx < size; idx++) {
+        if(evalResult(quantizedForwardPropagateInto(dataset[idx], qnn, buffers)) == dataset[idx].expVal) {
+            correctItems++;
+        }
+    }
+
+    freeQuantBuffers(&buffers);
+
+    return (double) correctItems / size;
+}
+
+long getQuantizedNetBytes(QuantizedNetwork qnn)
+{
+    int pos;
+    long bytes = 0;
+
+    for(pos = 0; pos < qnn.size; pos++) {
+        bytes += (long) qnn.layers[pos].nodes * qnn.layers[pos].stride;
+        bytes += (long) qnn.layers[pos].nodes * (sizeof(float) + sizeof(int32_t) + sizeof(Real));
+    }
+
+    return bytes;
+}
+
+void freeQuantBuffers(QuantBuffers *buffers)
+{
+    free(buffers->inputs);
+    free(buffers->sums);
+    freeMatrix(&buffers->out);
+    buffers->inputs = NULL;
+    buffers->sums = NULL;
+}
+
+void freeQuantizedNet(QuantizedNetwork *qnn)
+{
+    int pos;
+
+    for(pos = 0; pos < qnn->size; pos++) {
+        free(qnn->layers[pos].weights);
+        free(qnn->layers[pos].scales);
+        free(qnn->layers[pos].weightSums);
+        free(qnn->layers[pos].bias);
+    }
+    free(qnn->layers);
+
+    qnn->layers = NULL;
+    qnn->size = 0;
+}
@@ -0,0 +1,344 @@
+/** @file rng.c
+ *  @brief A library made for generating random numbers from
+ *  many threads at once, reproducibly.
+ *
+ *  This library contains a counter-based random number generator
+ *  (Philox4x32-10), where every block of random words is computed
+ *  from the seed, a stream, and the index of the block, rather than
+ *  from the block before it. Thus streams can be given to each layer,
+ *  thread, or task, and blocks are generated in bulk on the AVX2 or
+ *  AVX-512 kernels, depending on what the CPU supports.
+ *
+ *  DEPENDENCIES: simd
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "headers/simd.h"
+#include "headers/rng.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define SHOULD_BE_POSITIVE "It should be a positive integer."
+#define SHOULD_NOT_BE_NULL "It should not be a null value."
+
+// The multipliers, and the key increments (the golden ratio, and sqrt(3) - 1),
+// of Philox4x32, which are run for 10 rounds.
+#define PHILOX_M0 0xd2511f53u
+#define PHILOX_M1 0xcd9e8d57u
+#define PHILOX_W0 0x9e3779b9u
+#define PHILOX_W1 0xbb67ae85u
+#define PHILOX_ROUNDS 10
+// The number of blocks generated at once when filling an array.
+#define BULK_BLOCKS 64
+// 2^-32, which maps a random word into (0, 1) after adding a half.
+#define WORD_SCALE (1.0 / 4294967296.0)
+
+typedef void (*PhiloxKernel)(const uint32_t key[2], uint64_t stream, uint64_t block, int blocks, uint32_t *words);
+
+static void philoxBlock(const uint32_t key[2], uint64_t stream, uint64_t block, uint32_t words[4])
+{
+    uint32_t c0 = (uint32_t) block, c1 = (uint32_t) (block >> 32);
+    uint32_t c2 = (uint32_t) stream, c3 = (uint32_t) (stream >> 32);
+    uint32_t k0 = key[0], k1 = key[1];
+    uint64_t p0, p1;
+    int round;
+
+    for(round = 0; round < PHILOX_ROUNDS; round++) {
+        p0 = (uint64_t) PHILOX_M0 * c0;
+        p1 = (uint64_t) PHILOX_M1 * c2;
+        c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t) p1;
+        c3 = (uint32_t) p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    words[0] = c0;
+    words[1] = c1;
+    words[2] = c2;
+    words[3] = c3;
+}
+
+static void scalarPhilox(const uint32_t key[2], uint64_t stream, uint64_t block, int blocks, uint32_t *words)
+{
+    int idx;
+
+    for(idx = 0; idx < blocks; idx++) {
+        philoxBlock(key, stream, block + idx, words + 4L * idx);
+    }
+}
+
+#ifdef HAS_X86_KERNELS
+// Each 64-bit lane holds a 32-bit word of a different block, since pmuludq
+// multiplies the low halves of the lanes into their full 64-bit products.
+#define PHILOX_VEC_ROUNDS(mul, srli, and, xor, add) { \
+    for(round = 0; round < PHILOX_ROUNDS; round++) { \
+        p0 = mul(c0, m0); \
+        p1 = mul(c2, m1); \
+        c0 = xor(xor(srli(p1, 32), c1), k0); \
+        c2 = xor(xor(srli(p0, 32), c3), k1); \
+        c1 = and(p1, low); \
+        c3 = and(p0, low); \
+        k0 = and(add(k0, w0), low); \
+        k1 = and(add(k1, w1), low); \
+    } \
+}
+
+__attribute__((target("avx2"))) static void avx2Philox(const uint32_t key[2], uint64_t stream, uint64_t block, int blocks, uint32_t *words)
+{
+    const __m256i m0 = _mm256_set1_epi64x(PHILOX_M0), m1 = _mm256_set1_epi64x(PHILOX_M1);
+    const __m256i w0 = _mm256_set1_epi64x(PHILOX_W0), w1 = _mm256_set1_epi64x(PHILOX_W1);
+    const __m256i low = _mm256_set1_epi64x(0xffffffff), lanes = _mm256_set_epi64x(3, 2, 1, 0);
+    __m256i c0, c1, c2, c3, k0, k1, p0, p1, blocks01, blocks23, lo, hi;
+    int idx, round;
+
+    for(idx = 0; idx + 4 <= blocks; idx += 4) {
+        c0 = _mm256_add_epi64(_mm256_set1_epi64x(block + idx), lanes);
+        c1 = _mm256_srli_epi64(c0, 32);
+        c0 = _mm256_and_si256(c0, low);
+        c2 = _mm256_set1_epi64x(stream & 0xffffffff);
+        c3 = _mm256_set1_epi64x(stream >> 32);
+        k0 = _mm256_set1_epi64x(key[0]);
+        k1 = _mm256_set1_epi64x(key[1]);
+
+        PHILOX_VEC_ROUNDS(_mm256_mul_epu32, _mm256_srli_epi64, _mm256_and_si256, _mm256_xor_si256, _mm256_add_epi64);
+
+        // the words of each block are packed in pairs, and the pairs of the
+        // four blocks are interleaved, so that each block is stored in order
+        blocks01 = _mm256_or_si256(c0, _mm256_slli_epi64(c1, 32));
+        blocks23 = _mm256_or_si256(c2, _mm256_slli_epi64(c3, 32));
+        lo = _mm256_unpacklo_epi64(blocks01, blocks23);
+        hi = _mm256_unpackhi_epi64(blocks01, blocks23);
+        _mm256_storeu_si256((__m256i *) (words + 4L * idx), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *) (words + 4L * idx + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    scalarPhilox(key, stream, block + idx, blocks - idx, words + 4L * idx);
+
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx512f"))) static void avx512Philox(const uint32_t key[2], uint64_t stream, uint64_t block, int blocks, uint32_t *words)
+{
+    const __m512i m0 = _mm512_set1_epi64(PHILOX_M0), m1 = _mm512_set1_epi64(PHILOX_M1);
+    const __m512i w0 = _mm512_set1_epi64(PHILOX_W0), w1 = _mm512_set1_epi64(PHILOX_W1);
+    const __m512i low = _mm512_set1_epi64(0xffffffff), lanes = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512i firstHalf = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+    const __m512i secondHalf = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+    __m512i c0, c1, c2, c3, k0, k1, p0, p1, blocks01, blocks23;
+    int idx, round;
+
+    for(idx = 0; idx + 8 <= blocks; idx += 8) {
+        c0 = _mm512_add_epi64(_mm512_set1_epi64(block + idx), lanes);
+        c1 = _mm512_srli_epi64(c0, 32);
+        c0 = _mm512_and_si512(c0, low);
+        c2 = _mm512_set1_epi64(stream & 0xffffffff);
+        c3 = _mm512_set1_epi64(stream >> 32);
+        k0 = _mm512_set1_epi64(key[0]);
+        k1 = _mm512_set1_epi64(key[1]);
+
+        PHILOX_VEC_ROUNDS(_mm512_mul_epu32, _mm512_srli_epi64, _mm512_and_si512, _mm512_xor_si512, _mm512_add_epi64);
+
+        blocks01 = _mm512_or_si512(c0, _mm512_slli_epi64(c1, 32));
+        blocks23 = _mm512_or_si512(c2, _mm512_slli_epi64(c3, 32));
+        _mm512_storeu_si512((void *) (words + 4L * idx), _mm512_permutex2var_epi64(blocks01, firstHalf, blocks23));
+        _mm512_storeu_si512((void *) (words + 4L * idx + 16), _mm512_permutex2var_epi64(blocks01, secondHalf, blocks23));
+    }
+    scalarPhilox(key, stream, block + idx, blocks - idx, words + 4L * idx);
+
+    _mm256_zeroupper();
+}
+#endif
+
+// Resolved whenever the selected instruction set of the simd library
+// changes. Racing threads resolve the same kernel, thus they can only
+// ever store the same value.
+static PhiloxKernel philoxKernel = NULL;
+static SimdIsa philoxIsa = SCALAR;
+
+static PhiloxKernel getPhiloxKernel()
+{
+    SimdIsa isa = getSimdIsa();
+
+    if(philoxKernel != NULL && philoxIsa == isa) return philoxKernel;
+
+    philoxKernel = scalarPhilox;
+#ifdef HAS_X86_KERNELS
+    if(isa >= AVX512) {
+        philoxKernel = avx512Philox;
+    } else if(isa >= AVX2) {
+        philoxKernel = avx2Philox;
+    }
+#endif
+    philoxIsa = isa;
+
+    return philoxKernel;
+}
+
+static uint64_t rngSeed = RNG_DEFAULT_SEED;
+// Bumped whenever the seed is set, so that each thread starts over.
+static int seedGeneration = 0;
+static int threadStreams = 0;
+// The number of shuffles drawn since the seed was set.
+static int shuffleStreams = 0;
+static __thread Rng threadRng;
+static __thread int threadGeneration = -1;
+
+Rng createRng(uint64_t seed, uint64_t stream)
+{
+    Rng rng = {
+        .key = { (uint32_t) seed, (uint32_t) (seed >> 32) },
+        .stream = stream,
+        .block = 0,
+        .words = { 0 },
+        .used = 4
+    };
+
+    return rng;
+}
+
+void setRngSeed(uint64_t seed)
+{
+    rngSeed = seed;
+    __atomic_store_n(&threadStreams, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&shuffleStreams, 0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&seedGeneration, 1, __ATOMIC_RELEASE);
+}
+
+uint64_t getRngSeed()
+{
+    return rngSeed;
+}
+
+Rng *getThreadRng()
+{
+    int generation = __atomic_load_n(&seedGeneration, __ATOMIC_ACQUIRE);
+
+    if(threadGeneration != generation) {
+        threadRng = createRng(rngSeed, RNG_THREAD_STREAM(__atomic_fetch_add(&threadStreams, 1, __ATOMIC_RELAXED)));
+        threadGeneration = generation;
+    }
+
+    return &threadRng;
+}
+
+Rng createShuffleRng()
+{
+    return createRng(rngSeed, RNG_SHUFFLE_STREAM(__atomic_fetch_add(&shuffleStreams, 1, __ATOMIC_RELAXED)));
+}
+
+uint32_t rngNext(Rng *rng)
+{
+    if(rng == NULL) throwInvalidArgs("rng", SHOULD_NOT_BE_NULL);
+
+    if(rng->used == 4) {
+        philoxBlock(rng->key, rng->stream, rng->block++, rng->words);
+        rng->used = 0;
+    }
+
+    return rng->words[rng->used++];
+}
+
+double rngUniform(Rng *rng)
+{
+    return (rngNext(rng) + 0.5) * WORD_SCALE;
+}
+
+int rngBelow(Rng *rng, int n)
+{
+    if(n <= 0) throwInvalidArgs("n", SHOULD_BE_POSITIVE);
+
+    uint64_t product;
+    uint32_t threshold;
+
+    // the high word of a word times n is within [0, n), where the low words
+    // below 2^32 mod n are rejected, since they are taken by one more value
+    product = (uint64_t) rngNext(rng) * (uint32_t) n;
+    if((uint32_t) product < (uint32_t) n) {
+        threshold = -(uint32_t) n % (uint32_t) n;
+        while((uint32_t) product < threshold) {
+            product = (uint64_t) rngNext(rng) * (uint32_t) n;
+        }
+    }
+
+    return (int) (product >> 32);
+}
+
+void rngUniformArr(Rng *rng, Real arr[], long size, double min, double max)
+{
+    if(rng == NULL) throwInvalidArgs("rng", SHOULD_NOT_BE_NULL);
+    if(size > 0 && arr == NULL) throwInvalidArgs("arr", SHOULD_NOT_BE_NULL);
+
+    uint32_t words[4 * BULK_BLOCKS];
+    double scale = (max - min) * WORD_SCALE, offset = min + 0.5 * scale;
+    PhiloxKernel kernel = getPhiloxKernel();
+    long idx, word, count;
+    int blocks;
+
+    // the words left over from the last block are drawn first, and the ones
+    // past the last whole block after, so that the numbers drawn are the
+    // same as if they were drawn one at a time
+    for(idx = 0; idx < size && rng->used < 4; idx++) {
+        arr[idx] = offset + rngNext(rng) * scale;
+    }
+
+    while(size - idx >= 4) {
+        blocks = (size - idx) / 4 < BULK_BLOCKS ? (size - idx) / 4 : BULK_BLOCKS;
+        kernel(rng->key, rng->stream, rng->block, blocks, words);
+        rng->block += blocks;
+
+        count = 4L * blocks;
+        for(word = 0; word < count; word++) {
+            arr[idx + word] = offset + words[word] * scale;
+        }
+        idx += count;
+    }
+
+    for(; idx < size; idx++) {
+        arr[idx] = offset + rngNext(rng) * scale;
+    }
+}
+
+void rngNormalArr(Rng *rng, Real arr[], long size, double mean, double stddev)
+{
+    if(rng == NULL) throwInvalidArgs("rng", SHOULD_NOT_BE_NULL);
+    if(size > 0 && arr == NULL) throwInvalidArgs("arr", SHOULD_NOT_BE_NULL);
+
+    long idx;
+    double radius, angle;
+
+    // every pair of uniform numbers is turned into a pair of normal ones
+    rngUniformArr(rng, arr, size, 0, 1);
+    for(idx = 0; idx < size; idx += 2) {
+        radius = stddev * sqrt(-2 * log(arr[idx] > 0 ? arr[idx] : WORD_SCALE));
+        angle = 2 * M_PI * (idx + 1 < size ? arr[idx + 1] : rngUniform(rng));
+
+        arr[idx] = mean + radius * cos(angle);
+        if(idx + 1 < size) {
+            arr[idx + 1] = mean + radius * sin(angle);
+        }
+    }
+}
+
+void rngShuffle(Rng *rng, int arr[], int size)
+{
+    if(rng == NULL) throwInvalidArgs("rng", SHOULD_NOT_BE_NULL);
+    if(size > 0 && arr == NULL) throwInvalidArgs("arr", SHOULD_NOT_BE_NULL);
+
+    int idx, other, temp;
+
+    for(idx = size - 1; idx > 0; idx--) {
+        other = rngBelow(rng, idx + 1);
+        temp = arr[idx];
+        arr[idx] = arr[other];
+        arr[other] = temp;
+    }
+}
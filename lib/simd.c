@@ -0,0 +1,284 @@
+/** @file simd.c
+ *  @brief A library made for running vectorized kernels
+ *  over arrays.
+ *
+ *  This library contains elementwise kernels implemented for
+ *  SSE2, AVX2, and AVX-512, along with a portable scalar
+ *  fallback. The widest instruction set that the CPU supports
+ *  is detected at runtime, so that one binary runs everywhere.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define SHOULD_BE_NON_NEGATIVE "It should be a non-negative integer."
+
+/** @brief The kernels of a single instruction set. */
+typedef struct SimdKernels {
+    void (*add)(const Real *a, const Real *b, Real *out, int size);
+    void (*subtract)(const Real *min, const Real *sub, Real *out, int size);
+    void (*scale)(const Real *a, Real val, Real *out, int size);
+    void (*multiply)(const Real *a, const Real *b, Real *out, int size);
+    void (*axpy)(Real alpha, const Real *x, Real *y, int size);
+    void (*fill)(Real *out, Real val, int size);
+    void (*momentumStep)(Real *params, const Real *grad, Real *velocity, Real lr, Real momentum, int nesterov, int size);
+    void (*adamStep)(Real *params, const Real *grad, Real *mean, Real *variance, Real beta1, Real beta2, Real stepSize, Real epsilon, int size);
+    void (*exp)(const Real *a, Real *out, int size);
+    void (*activate)(Activation activation, const Real *a, Real *out, int size);
+    void (*activatePrime)(Activation activation, const Real *a, Real *out, int size);
+} SimdKernels;
+
+// The constants of the exponential. The argument is rounded to a multiple
+// n of ln2 by adding a shifter, which leaves n in the low bits of the sum.
+// ln2 is split in two, where n * EXP_LN2_HI is exact for every n in range.
+#ifdef REAL_FLOAT32
+#define EXP_DEGREE 6
+#define EXP_MIN -87.0f
+#define EXP_MAX 88.0f
+#define EXP_SHIFTER 0x1.8p23f
+#define EXP_LN2_HI 0x1.62e400p-1f
+#define EXP_LN2_LO 0x1.7f7d1cp-20f
+#define EXP_BIAS 127
+#define EXP_MANTISSA_BITS 23
+#else
+#define EXP_DEGREE 13
+#define EXP_MIN -708.0
+#define EXP_MAX 709.0
+#define EXP_SHIFTER 0x1.8p52
+#define EXP_LN2_HI 0x1.62e42fee00000p-1
+#define EXP_LN2_LO 0x1.a39ef35793c76p-33
+#define EXP_BIAS 1023
+#define EXP_MANTISSA_BITS 52
+#endif
+#define EXP_LOG2E ((Real) 1.44269504088896340736)
+
+// The coefficients 1/k! of the Taylor polynomial of the exponential,
+// up to EXP_DEGREE.
+static const Real expCoefficients[] = {
+    1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+    1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600,
+    1.0 / 6227020800
+};
+
+// Leaving AVX code with dirty upper halves of the vector registers slows
+// down the SSE code that runs after it. The compiler only clears them
+// on its own when optimizing for speed, thus it is done explicitly.
+#define AVX_LEAVE() __builtin_ia32_vzeroupper()
+#define NO_LEAVE() ((void) 0)
+
+// The vector extensions have no square root, thus the instruction of each
+// width is called directly. The scalar kernels take it one lane at a time.
+#ifdef REAL_FLOAT32
+#define SSE2_SQRT(x) _mm_sqrt_ps((__m128) (x))
+#define AVX2_SQRT(x) _mm256_sqrt_ps((__m256) (x))
+#define AVX512_SQRT(x) _mm512_sqrt_ps((__m512) (x))
+#else
+#define SSE2_SQRT(x) _mm_sqrt_pd((__m128d) (x))
+#define AVX2_SQRT(x) _mm256_sqrt_pd((__m256d) (x))
+#define AVX512_SQRT(x) _mm512_sqrt_pd((__m512d) (x))
+#endif
+
+#define SIMD_WIDTH 8
+#define SIMD_NAME(name) scalar##name
+#define SIMD_LEAVE NO_LEAVE
+#include "simd_kernels.inc"
+#undef SIMD_LEAVE
+#undef SIMD_NAME
+#undef SIMD_WIDTH
+
+#ifdef HAS_X86_KERNELS
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#define SIMD_WIDTH 16
+#define SIMD_NAME(name) sse2##name
+#define SIMD_SQRT SSE2_SQRT
+#define SIMD_LEAVE NO_LEAVE
+#include "simd_kernels.inc"
+#undef SIMD_SQRT
+#undef SIMD_LEAVE
+#undef SIMD_NAME
+#undef SIMD_WIDTH
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define SIMD_WIDTH 32
+#define SIMD_NAME(name) avx2##name
+#define SIMD_SQRT AVX2_SQRT
+#define SIMD_LEAVE AVX_LEAVE
+#include "simd_kernels.inc"
+#undef SIMD_SQRT
+#undef SIMD_LEAVE
+#undef SIMD_NAME
+#undef SIMD_WIDTH
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#define SIMD_WIDTH 64
+#define SIMD_NAME(name) avx512##name
+#define SIMD_SQRT AVX512_SQRT
+#define SIMD_LEAVE AVX_LEAVE
+#include "simd_kernels.inc"
+#undef SIMD_SQRT
+#undef SIMD_LEAVE
+#undef SIMD_NAME
+#undef SIMD_WIDTH
+#pragma GCC pop_options
+#endif
+
+static const SimdKernels *kernelsByIsa[] = {
+    [SCALAR] = &scalarKernels,
+#ifdef HAS_X86_KERNELS
+    [SSE2] = &sse2Kernels,
+    [AVX2] = &avx2Kernels,
+    [AVX512] = &avx512Kernels
+#endif
+};
+
+// Resolved on first use. Racing threads resolve the same instruction set,
+// thus they can only ever store the same value.
+static const SimdKernels *kernels = NULL;
+static SimdIsa selectedIsa = SCALAR;
+
+static SimdIsa detectSimdIsa()
+{
+    SimdIsa isa;
+
+    for(isa = AVX512; isa > SCALAR && !isSimdIsaSupported(isa); isa--) {}
+
+    return isa;
+}
+
+static const SimdKernels *getKernels()
+{
+    if(kernels == NULL) {
+        setSimdIsa(detectSimdIsa());
+    }
+
+    return kernels;
+}
+
+SimdIsa getSimdIsa()
+{
+    getKernels();
+    return selectedIsa;
+}
+
+void setSimdIsa(SimdIsa isa)
+{
+    if(!isSimdIsaSupported(isa)) throwInvalidArgs("isa", "It is not supported by this CPU.");
+
+    selectedIsa = isa;
+    kernels = kernelsByIsa[isa];
+}
+
+int isSimdIsaSupported(SimdIsa isa)
+{
+    switch(isa) {
+        case SCALAR:
+            return 1;
+#ifdef HAS_X86_KERNELS
+        case SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2") ? 1 : 0;
+        case AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? 1 : 0;
+        case AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") ? 1 : 0;
+#endif
+        default:
+            return 0;
+    }
+}
+
+const char *getSimdIsaName(SimdIsa isa)
+{
+    switch(isa) {
+        case SCALAR: return "scalar";
+        case SSE2: return "sse2";
+        case AVX2: return "avx2";
+        case AVX512: return "avx512";
+        default: throwInvalidArgs("isa", "");
+    }
+}
+
+void vecAdd(const Real *a, const Real *b, Real *out, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->add(a, b, out, size);
+}
+
+void vecSubtract(const Real *min, const Real *sub, Real *out, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->subtract(min, sub, out, size);
+}
+
+void vecScale(const Real *a, Real val, Real *out, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->scale(a, val, out, size);
+}
+
+void vecMultiply(const Real *a, const Real *b, Real *out, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->multiply(a, b, out, size);
+}
+
+void vecAxpy(Real alpha, const Real *x, Real *y, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->axpy(alpha, x, y, size);
+}
+
+void vecFill(Real *out, Real val, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->fill(out, val, size);
+}
+
+void vecMomentumStep(Real *params, const Real *grad, Real *velocity, Real lr, Real momentum, int nesterov, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->momentumStep(params, grad, velocity, lr, momentum, nesterov, size);
+}
+
+void vecAdamStep(Real *params, const Real *grad, Real *mean, Real *variance, Real beta1, Real beta2, Real stepSize, Real epsilon, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->adamStep(params, grad, mean, variance, beta1, beta2, stepSize, epsilon, size);
+}
+
+void vecExp(const Real *a, Real *out, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    getKernels()->exp(a, out, size);
+}
+
+void vecActivate(Activation activation, const Real *a, Real *out, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    if(activation < IDENTITY || activation > TANH) throwInvalidArgs("activation", "");
+    getKernels()->activate(activation, a, out, size);
+}
+
+void vecActivatePrime(Activation activation, const Real *a, Real *out, int size)
+{
+    if(size < 0) throwInvalidArgs("size", SHOULD_BE_NON_NEGATIVE);
+    if(activation < IDENTITY || activation > TANH) throwInvalidArgs("activation", "");
+    getKernels()->activatePrime(activation, a, out, size);
+}
@@ -0,0 +1,187 @@
+/** @file sparse.c
+ *  @brief A library made for working with sparse matrices.
+ *
+ *  This library contains a compressed sparse row matrix, and
+ *  kernels that multiply it with dense matrices. The kernels
+ *  only visit the nonzero entries of the sparse matrix, and
+ *  run on the vectorized kernels of the simd library whenever
+ *  the rows of the dense matrix are walked.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "headers/simd.h"
+#include "headers/matrix.h"
+#include "headers/sparse.h"
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwMallocFailed() { fprintf(stderr, "Memory Allocation Failed."); exit(1); }
+#define throwMismatchedDimensions(msg) { fprintf(stderr, "Matrix Dimensions Mismatched. %s", msg); exit(1); }
+#define NOT_A_MATRIX "Argument is not a valid matrix."
+#define NOT_A_SPARSE_MATRIX "Argument is not a valid sparse matrix."
+
+SparseMatrix createSparseMatrix(Matrix m)
+{
+    if(!isValidMatrix(m) || isZeroMatrix(m)) throwInvalidArgs("m", NOT_A_MATRIX);
+
+    SparseMatrix s = { m.row, m.col, 0, NULL, NULL, NULL };
+    int row, col, idx;
+
+    for(row = 0; row < m.row; row++) {
+        for(col = 0; col < m.col; col++) {
+            if(MATRIX_AT(m, row, col) != 0) s.nnz++;
+        }
+    }
+
+    s.rowStarts = (int *) malloc((m.row + 1) * sizeof(int));
+    // an empty row still gets an allocation, so that a NULL array means no matrix
+    s.colIndices = (int *) malloc((s.nnz > 0 ? s.nnz : 1) * sizeof(int));
+    s.values = (Real *) malloc((s.nnz > 0 ? s.nnz : 1) * sizeof(Real));
+    if(s.rowStarts == NULL || s.colIndices == NULL || s.values == NULL) throwMallocFailed();
+
+    idx = 0;
+    for(row = 0; row < m.row; row++) {
+        s.rowStarts[row] = idx;
+        for(col = 0; col < m.col; col++) {
+            if(MATRIX_AT(m, row, col) != 0) {
+                s.colIndices[idx] = col;
+                s.values[idx] = MATRIX_AT(m, row, col);
+                idx++;
+            }
+        }
+    }
+    s.rowStarts[m.row] = idx;
+
+    return s;
+}
+
+int isSparseMatrix(SparseMatrix s)
+{
+    return s.row > 0 && s.col > 0 && s.rowStarts != NULL ? 1 : 0;
+}
+
+double getSparseDensity(SparseMatrix s)
+{
+    if(!isSparseMatrix(s)) throwInvalidArgs("s", NOT_A_SPARSE_MATRIX);
+
+    return (double) s.nnz / ((double) s.row * s.col);
+}
+
+void sparseDotInto(SparseMatrix a, Matrix b, Matrix out)
+{
+    if(!isSparseMatrix(a)) throwInvalidArgs("a", NOT_A_SPARSE_MATRIX);
+    if(!isValidMatrix(b)) throwInvalidArgs("b", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(a.col != b.row) throwMismatchedDimensions("Matrices can't be dotted.");
+    if(out.row != a.row || out.col != b.col) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row, idx;
+    Real *outRow;
+
+    for(row = 0; row < a.row; row++) {
+        outRow = MATRIX_ROW(out, row);
+        vecFill(outRow, 0, out.col);
+
+        for(idx = a.rowStarts[row]; idx < a.rowStarts[row + 1]; idx++) {
+            vecAxpy(a.values[idx], MATRIX_ROW(b, a.colIndices[idx]), outRow, out.col);
+        }
+    }
+}
+
+void dotSparseTransInto(Matrix a, SparseMatrix b, Matrix out)
+{
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isSparseMatrix(b)) throwInvalidArgs("b", NOT_A_SPARSE_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(a.col != b.col) throwMismatchedDimensions("Matrices can't be dotted.");
+    if(out.row != a.row || out.col != b.row) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row, bRow, idx, col;
+    const Real *aRow;
+    Real sum, sums[4], val;
+
+    // four rows of a are gathered at once, so that each index and value
+    // of b is loaded once per four rows
+    for(row = 0; row + 4 <= a.row; row += 4) {
+        aRow = MATRIX_ROW(a, row);
+        for(bRow = 0; bRow < b.row; bRow++) {
+            sums[0] = sums[1] = sums[2] = sums[3] = 0;
+            for(idx = b.rowStarts[bRow]; idx < b.rowStarts[bRow + 1]; idx++) {
+                col = b.colIndices[idx];
+                val = b.values[idx];
+                sums[0] += aRow[col] * val;
+                sums[1] += aRow[a.stride + col] * val;
+                sums[2] += aRow[2L * a.stride + col] * val;
+                sums[3] += aRow[3L * a.stride + col] * val;
+            }
+            MATRIX_AT(out, row, bRow) = sums[0];
+            MATRIX_AT(out, row + 1, bRow) = sums[1];
+            MATRIX_AT(out, row + 2, bRow) = sums[2];
+            MATRIX_AT(out, row + 3, bRow) = sums[3];
+        }
+    }
+
+    for(; row < a.row; row++) {
+        aRow = MATRIX_ROW(a, row);
+        for(bRow = 0; bRow < b.row; bRow++) {
+            sum = 0;
+            for(idx = b.rowStarts[bRow]; idx < b.rowStarts[bRow + 1]; idx++) {
+                sum += aRow[b.colIndices[idx]] * b.values[idx];
+            }
+            MATRIX_AT(out, row, bRow) = sum;
+        }
+    }
+}
+
+void sparseTransDotAxpy(double alpha, SparseMatrix a, Matrix b, Matrix out)
+{
+    if(!isSparseMatrix(a)) throwInvalidArgs("a", NOT_A_SPARSE_MATRIX);
+    if(!isValidMatrix(b)) throwInvalidArgs("b", NOT_A_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(a.row != b.row) throwMismatchedDimensions("Matrices can't be dotted.");
+    if(out.row != a.col || out.col != b.col) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row, idx;
+
+    // the nonzero entry of a at (row, col) adds its share of the row of b
+    // onto the row col of out, thus the other rows of out are never read
+    for(row = 0; row < a.row; row++) {
+        for(idx = a.rowStarts[row]; idx < a.rowStarts[row + 1]; idx++) {
+            vecAxpy(alpha * a.values[idx], MATRIX_ROW(b, row), MATRIX_ROW(out, a.colIndices[idx]), out.col);
+        }
+    }
+}
+
+void dotSparseAxpy(double alpha, Matrix a, SparseMatrix b, Matrix out)
+{
+    if(!isValidMatrix(a)) throwInvalidArgs("a", NOT_A_MATRIX);
+    if(!isSparseMatrix(b)) throwInvalidArgs("b", NOT_A_SPARSE_MATRIX);
+    if(!isValidMatrix(out)) throwInvalidArgs("out", NOT_A_MATRIX);
+    if(a.col != b.row) throwMismatchedDimensions("Matrices can't be dotted.");
+    if(out.row != a.row || out.col != b.col) throwMismatchedDimensions("Result can't be stored in out.");
+
+    int row, bRow, idx;
+    Real scalar, *outRow;
+
+    for(row = 0; row < a.row; row++) {
+        outRow = MATRIX_ROW(out, row);
+        for(bRow = 0; bRow < b.row; bRow++) {
+            scalar = alpha * MATRIX_AT(a, row, bRow);
+            for(idx = b.rowStarts[bRow]; idx < b.rowStarts[bRow + 1]; idx++) {
+                outRow[b.colIndices[idx]] += scalar * b.values[idx];
+            }
+        }
+    }
+}
+
+void freeSparseMatrix(SparseMatrix *s)
+{
+    if(s == NULL) throwInvalidArgs("s", "It should not be null.");
+
+    free(s->rowStarts);
+    free(s->colIndices);
+    free(s->values);
+    *s = (SparseMatrix) { 0, 0, 0, NULL, NULL, NULL };
+}
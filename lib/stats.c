@@ -6,11 +6,14 @@
  *  operations on arrays, such as min, max, standard deviation,
  *  averaging, and data transformation.
  *
+ *  DEPENDENCIES: rng
+ *
  *  @author Jonh Alexis Buot (LaplaceXD)
  *  @bug No know bugs.
  */
 #include <stdio.h>
 #include <math.h>
+#include "headers/rng.h"
 #include "headers/stats.h"
 
 #define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
@@ -21,7 +24,7 @@ int isDoubleEq(double x, double y)
     return fabs(x - y) <= __DBL_EPSILON__ ? 1 : 0;
 }
 
-double min(double arr[], int size)
+double min(Real arr[], int size)
 {
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
     
@@ -38,7 +41,7 @@ double min(double arr[], int size)
     return minimum;
 }
 
-double max(double arr[], int size)
+double max(Real arr[], int size)
 {
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
     
@@ -55,7 +58,7 @@ double max(double arr[], int size)
     return maximum;
 }
 
-double average(double arr[], int size)
+double average(Real arr[], int size)
 {
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
     
@@ -70,7 +73,7 @@ double average(double arr[], int size)
     return sum / size;
 }
 
-double stddev(double arr[], int size)
+double stddev(Real arr[], int size)
 {
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
     
@@ -90,10 +93,10 @@ double stddev(double arr[], int size)
 double randn(double min, double max) 
 {
     double range = max - min; 
-    return min + ((double) rand() / RAND_MAX) * range;
+    return min + rngUniform(getThreadRng()) * range;
 }
 
-void normalize(double arr[], int size)
+void normalize(Real arr[], int size)
 {
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
     
@@ -111,7 +114,7 @@ void normalize(double arr[], int size)
     }
 }
 
-void standardize(double arr[], int size)
+void standardize(Real arr[], int size)
 {
     if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
     
@@ -127,3 +130,14 @@ void standardize(double arr[], int size)
         }
     }
 }
+
+void scalePixels(Real arr[], int size)
+{
+    if(size <= 0) throwInvalidArgs("size", SHOULD_BE_POSITIVE);
+    
+    int idx;
+    
+    for(idx = 0; idx < size; idx++) {
+        arr[idx] /= PIXEL_MAX;
+    }
+}
@@ -0,0 +1,198 @@
+/** @file thread_pool.c
+ *  @brief A library made for running loops across threads.
+ *
+ *  This library contains a pool of worker threads, which are
+ *  started once and put to sleep between loops, thus a loop
+ *  only pays for waking them up. The tasks of a loop are handed
+ *  out one at a time through a shared counter, and the thread
+ *  that starts the loop works on them alongside the pool.
+ *
+ *  @author Jonh Alexis Buot (LaplaceXD)
+ *  @bug No know bugs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "headers/thread_pool.h"
+
+#define throwInvalidArgs(arg, msg) { fprintf(stderr, "Invalid %s Argument. %s", arg, msg); exit(1); }
+#define throwMallocFailed() { fprintf(stderr, "Memory Allocation Failed."); exit(1); }
+#define throwThreadFailed() { fprintf(stderr, "Thread Creation Failed."); exit(1); }
+#define SHOULD_BE_POSITIVE "It should be a positive integer."
+#define SHOULD_BE_NON_NEGATIVE "It should be a non-negative integer."
+#define SHOULD_NOT_BE_NULL "It should not be null."
+
+/** @brief Structure of a loop that runs on the pool. */
+typedef struct ParallelLoop {
+    TaskFunc func;
+    void *arg;
+    int tasks;
+    // The next task that is yet to be taken by a thread.
+    int next;
+} ParallelLoop;
+
+// Guards the state of the pool below, which the workers sleep on.
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loopStarted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t loopFinished = PTHREAD_COND_INITIALIZER;
+// Held by the thread whose loop runs on the pool, thus one loop runs at a time.
+static pthread_mutex_t loopLock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t *workers = NULL;
+static int workerCount = 0;
+static int threadCount = 0;
+static ParallelLoop *currentLoop = NULL;
+static unsigned long loopId = 0;
+static int busyWorkers = 0;
+static int isStopping = 0;
+
+static __thread int isInTask = 0;
+
+static void runTasks(ParallelLoop *loop)
+{
+    int task;
+
+    isInTask = 1;
+    while((task = __atomic_fetch_add(&loop->next, 1, __ATOMIC_RELAXED)) < loop->tasks) {
+        loop->func(loop->arg, task);
+    }
+    isInTask = 0;
+}
+
+static void *runWorker(void *arg)
+{
+    unsigned long seenLoop;
+    ParallelLoop *loop;
+
+    pthread_mutex_lock(&poolLock);
+    seenLoop = loopId;
+
+    while(1) {
+        // a loop that finished before the worker woke up is skipped
+        while(!isStopping && (currentLoop == NULL || loopId == seenLoop)) {
+            pthread_cond_wait(&loopStarted, &poolLock);
+        }
+        if(isStopping) break;
+
+        seenLoop = loopId;
+        loop = currentLoop;
+        busyWorkers++;
+        pthread_mutex_unlock(&poolLock);
+
+        runTasks(loop);
+
+        pthread_mutex_lock(&poolLock);
+        if(--busyWorkers == 0) {
+            pthread_cond_broadcast(&loopFinished);
+        }
+    }
+
+    pthread_mutex_unlock(&poolLock);
+
+    return NULL;
+}
+
+// Should be called while holding the loopLock.
+static void startWorkers(int count)
+{
+    workers = (pthread_t *) malloc(count * sizeof(pthread_t));
+    if(workers == NULL) throwMallocFailed();
+
+    for(workerCount = 0; workerCount < count; workerCount++) {
+        if(pthread_create(workers + workerCount, NULL, runWorker, NULL) != 0) throwThreadFailed();
+    }
+}
+
+// Should be called while holding the loopLock.
+static void stopWorkers()
+{
+    int idx;
+
+    pthread_mutex_lock(&poolLock);
+    isStopping = 1;
+    pthread_cond_broadcast(&loopStarted);
+    pthread_mutex_unlock(&poolLock);
+
+    for(idx = 0; idx < workerCount; idx++) {
+        pthread_join(workers[idx], NULL);
+    }
+
+    free(workers);
+    workers = NULL;
+    workerCount = 0;
+    isStopping = 0;
+}
+
+int getThreadCount()
+{
+    long cores;
+
+    // racing threads resolve the same count, thus they can only ever store the same value
+    if(threadCount == 0) {
+        cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = cores > 0 ? (int) cores : 1;
+    }
+
+    return threadCount;
+}
+
+void setThreadCount(int count)
+{
+    if(count <= 0) throwInvalidArgs("count", SHOULD_BE_POSITIVE);
+
+    pthread_mutex_lock(&loopLock);
+    if(workers != NULL) {
+        stopWorkers();
+    }
+    threadCount = count;
+    pthread_mutex_unlock(&loopLock);
+}
+
+void parallelFor(int tasks, TaskFunc func, void *arg)
+{
+    if(tasks < 0) throwInvalidArgs("tasks", SHOULD_BE_NON_NEGATIVE);
+    if(func == NULL) throwInvalidArgs("func", SHOULD_NOT_BE_NULL);
+
+    ParallelLoop loop = { func, arg, tasks, 0 };
+    int task;
+
+    // loops started from a task, or while the pool is taken, run serially
+    if(tasks <= 1 || isInTask || getThreadCount() == 1 || pthread_mutex_trylock(&loopLock) != 0) {
+        for(task = 0; task < tasks; task++) {
+            func(arg, task);
+        }
+        return;
+    }
+
+    if(workers == NULL) {
+        startWorkers(getThreadCount() - 1);
+    }
+
+    pthread_mutex_lock(&poolLock);
+    currentLoop = &loop;
+    loopId++;
+    pthread_cond_broadcast(&loopStarted);
+    pthread_mutex_unlock(&poolLock);
+
+    runTasks(&loop);
+
+    // every task has been taken, thus only the ones still running are waited on
+    pthread_mutex_lock(&poolLock);
+    currentLoop = NULL;
+    while(busyWorkers > 0) {
+        pthread_cond_wait(&loopFinished, &poolLock);
+    }
+    pthread_mutex_unlock(&poolLock);
+
+    pthread_mutex_unlock(&loopLock);
+}
+
+void freeThreadPool()
+{
+    pthread_mutex_lock(&loopLock);
+    if(workers != NULL) {
+        stopWorkers();
+    }
+    pthread_mutex_unlock(&loopLock);
+}
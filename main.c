@@ -2,35 +2,68 @@
 #include <math.h>
 #include <time.h>
 #include "lib/headers/stats.h"
+#include "lib/headers/rng.h"
 #include "lib/headers/image_set.h"
 #include "lib/headers/neural_net.h"
 #include "lib/headers/ml.h"
+#include "lib/headers/quant.h"
+#include "lib/headers/prune.h"
+#include "lib/headers/model_file.h"
+
+#define MODEL_FILE "mnist.model"
+#define CALIBRATION_SIZE 1000
+#define PRUNE_SPARSITY 0.8
 
 int main(int argc, char **argv)
 {
-    srand((unsigned int) time(NULL)); // initialize randomizer
+    setRngSeed((uint64_t) time(NULL)); // initialize randomizer
 
     int layerSizes[] = { IMG_SIZE, 16, 16, 10 };
+    MappedNeuralNet model = { 0 };
+    NeuralNetwork nn;
     
-    NeuralNetOpt opt = getDefaultOptions();
-    opt.layerSizes = layerSizes;
-    opt.neuralNetSize = sizeof(layerSizes) / sizeof(int);
-    
-    NeuralNetwork nn = createNeuralNet(opt);
+    // a model file passed as an argument is mapped instead of being trained
+    if(argc > 1) {
+        model = mapNeuralNet(argv[1], 1);
+        nn = model.nn;
+    } else {
+        NeuralNetOpt opt = getDefaultOptions();
+        opt.layerSizes = layerSizes;
+        opt.neuralNetSize = sizeof(layerSizes) / sizeof(int);
+        nn = createNeuralNet(opt);
+    }
 
     /* =============== TRAINING ================== */
     ImageSetMetadata metadata = getMetadata(TRAINING);
-    int imagesetSize = metadata.noOfImages;
+    // a mapped model only needs the slice that the int8 network is calibrated on
+    int imagesetSize = argc > 1 ? CALIBRATION_SIZE : metadata.noOfImages;
 
     Image trainImgs[imagesetSize];
     readImageSet(trainImgs, imagesetSize, metadata);
     prepDataset(trainImgs, imagesetSize, nn.options.nodeOrient, normalize);
 
     int epoch;
-    for(epoch = 1; epoch <= 20; epoch++) {
+    for(epoch = 1; argc <= 1 && epoch <= 20; epoch++) {
         printf("EPOCH: %d\n", epoch);
         networkTrain(nn, reLU, 20, trainImgs, imagesetSize);
     }
+    if(argc <= 1) {
+        saveNeuralNet(nn, MODEL_FILE);
+        printf("Saved the model to %s.\n", MODEL_FILE);
+    }
+
+    /* =============== QUANTIZATION ================== */
+    // calibrate the int8 network on a slice of the training set
+    QuantizedNetwork qnn = quantizeNeuralNet(nn, reLU, PER_CHANNEL, trainImgs, CALIBRATION_SIZE);
+
+    /* =============== PRUNING ================== */
+    // the hidden layers are pruned, and the weights that are kept are fine-tuned
+    double sparsities[] = { PRUNE_SPARSITY, PRUNE_SPARSITY, 0 };
+    NeuralNetwork pruned = copyNeuralNet(nn);
+    pruneNeuralNet(pruned, 0, sparsities);
+    fineTunePrunedNet(pruned, reLU, 20, trainImgs, imagesetSize, 1);
+    PrunedNetwork pnn = createPrunedNet(pruned, reLU);
+    freeNeuralNet(&pruned);
 
     freeImageSet(trainImgs, imagesetSize);
     /* =========== END OF TRAINING ============== */
@@ -46,10 +79,22 @@ int main(int argc, char **argv)
     double acc = networkTest(nn, reLU, testImgs, imagesetSize);
     printf("\nAccuracy: %.2lf percent.", acc * 100);
 
+    double quantAcc = quantizedNetworkTest(qnn, testImgs, imagesetSize);
+    printf("\nInt8 Accuracy: %.2lf percent (%.2lf percent drop).", quantAcc * 100, (acc - quantAcc) * 100);
+
+    double prunedAcc = prunedNetworkTest(pnn, testImgs, imagesetSize);
+    printf("\nPruned Accuracy: %.2lf percent (%.2lf percent drop).", prunedAcc * 100, (acc - prunedAcc) * 100);
+
     freeImageSet(testImgs, imagesetSize);
     /* =========== END OF TESTING ============== */
 
-    freeNeuralNet(&nn);
+    freeQuantizedNet(&qnn);
+    freePrunedNet(&pnn);
+    if(argc > 1) {
+        unmapNeuralNet(&model);
+    } else {
+        freeNeuralNet(&nn);
+    }
 
     return 0;
 }